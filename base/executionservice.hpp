@@ -38,6 +38,12 @@ class ExecutionOrder {
   // Get the product
   const T &GetProduct() const;
 
+  // Get the trace context of the chain this event belongs to
+  const TraceContext &GetTrace() const;
+
+  // Set the trace context of the chain this event belongs to
+  void SetTrace(const TraceContext &_trace);
+
   // Get the order ID
   const string &GetOrderId() const;
 
@@ -61,7 +67,8 @@ class ExecutionOrder {
   PricingSide GetSide() const;
 
  private:
-  T product;
+  ProductHandle<T> product;
+  TraceContext trace;
   PricingSide side;
   string orderId;
   OrderType orderType;
@@ -98,7 +105,7 @@ ExecutionOrder<T>::ExecutionOrder(const T &_product,
                                   double _hiddenQuantity,
                                   string _parentOrderId,
                                   bool _isChildOrder) :
-    product(_product) {
+    product(&_product) {
   side = _side;
   orderId = _orderId;
   orderType = _orderType;
@@ -111,7 +118,17 @@ ExecutionOrder<T>::ExecutionOrder(const T &_product,
 
 template<typename T>
 const T &ExecutionOrder<T>::GetProduct() const {
-  return product;
+  return *product;
+}
+
+template<typename T>
+const TraceContext &ExecutionOrder<T>::GetTrace() const {
+  return trace;
+}
+
+template<typename T>
+void ExecutionOrder<T>::SetTrace(const TraceContext &_trace) {
+  trace = _trace;
 }
 
 template<typename T>
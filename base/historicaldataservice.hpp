@@ -13,14 +13,15 @@
  * Service for processing and persisting historical data to a persistent store.
  * Keyed on some persistent key.
  * Type T is the data type to persist.
+ * Type K is the persistent key type.
  */
-template<typename T>
+template<typename T, typename K = string>
 class HistoricalDataService : Service<string, T> {
 
  public:
 
   virtual // Persist data to a store
-  void PersistData(string persistKey, const T &data) = 0;
+  void PersistData(K persistKey, const T &data) = 0;
 
 };
 
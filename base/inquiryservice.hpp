@@ -49,7 +49,7 @@ class Inquiry {
 
  private:
   string inquiryId;
-  T product;
+  ProductHandle<T> product;
   Side side;
   long quantity;
   double price;
@@ -82,7 +82,7 @@ Inquiry<T>::Inquiry(string _inquiryId,
                     long _quantity,
                     double _price,
                     InquiryState _state) :
-    product(_product) {
+    product(&_product) {
   inquiryId = _inquiryId;
   side = _side;
   quantity = _quantity;
@@ -97,7 +97,7 @@ const string &Inquiry<T>::GetInquiryId() const {
 
 template<typename T>
 const T &Inquiry<T>::GetProduct() const {
-  return product;
+  return *product;
 }
 
 template<typename T>
@@ -7,9 +7,12 @@
 #ifndef MARKET_DATA_SERVICE_HPP
 #define MARKET_DATA_SERVICE_HPP
 
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
 #include <string>
-#include <vector>
 #include "soa.hpp"
+#include "ticks.hpp"
 
 using namespace std;
 
@@ -24,10 +27,10 @@ class Order {
  public:
 
   // ctor for an order
-  Order(double _price, long _quantity, PricingSide _side);
+  Order(Ticks _price, long _quantity, PricingSide _side);
 
   // Get the price on the order
-  double GetPrice() const;
+  Ticks GetPrice() const;
 
   // Get the quantity on the order
   long GetQuantity() const;
@@ -36,7 +39,7 @@ class Order {
   PricingSide GetSide() const;
 
  private:
-  double price;
+  Ticks price;
   long quantity;
   PricingSide side;
 
@@ -64,31 +67,96 @@ class BidOffer {
 
 };
 
+// Price levels an order book holds per side unless told otherwise
+constexpr size_t DEFAULT_BOOK_DEPTH = 5;
+
+// How a book message changes the stored book: replaces it whole, or adds,
+// modifies or deletes one level of one side
+enum class BookAction { SNAPSHOT, ADD, MODIFY, DELETE };
+
 /**
- * Order book with a bid and offer stack.
+ * The part of a book a message changed: every level for a snapshot, otherwise
+ * one level of one side.
+ */
+struct BookChange {
+  BookAction action = BookAction::SNAPSHOT;
+  PricingSide side = BID;
+  size_t level = 0;
+
+  // Whether the best bid or offer may have moved
+  bool TouchesTop() const { return action == BookAction::SNAPSHOT || level == 0; }
+};
+
+/**
+ * Order book with a bid and offer stack of up to Depth levels each.
+ * Each side keeps its prices and quantities in arrays of their own inside the
+ * book, so the book owns no heap storage, copies with memcpy, and loops over a
+ * side's levels run over contiguous values.
+ * As a message, a book is either a snapshot or a delta: a delta holds just the
+ * changed level, at the top of its side, to be applied to the stored book.
  * Type T is the product type.
  */
-template<typename T>
+template<typename T, size_t Depth = DEFAULT_BOOK_DEPTH>
 class OrderBook {
 
  public:
 
-  // ctor for the order book
-  OrderBook(const T &_product, const vector<Order> &_bidStack, const vector<Order> &_offerStack);
+  // Levels each side can hold
+  static constexpr size_t DEPTH = Depth;
+
+  // ctor for an order book with empty stacks
+  explicit OrderBook(const T &_product);
 
   // Get the product
   const T &GetProduct() const;
 
-  // Get the bid stack
-  const vector<Order> &GetBidStack() const;
+  // Get the trace context of the chain this event belongs to
+  const TraceContext &GetTrace() const;
+
+  // Set the trace context of the chain this event belongs to
+  void SetTrace(const TraceContext &_trace);
+
+  // Get the number of levels on the stack of a side
+  size_t GetDepth(PricingSide side) const;
 
-  // Get the offer stack
-  const vector<Order> &GetOfferStack() const;
+  // Get the Depth prices of a side, best first; those past GetDepth(side) are zero
+  const Ticks *GetPrices(PricingSide side) const;
+
+  // Get the Depth quantities of a side, best first; those past GetDepth(side) are zero
+  const long *GetQuantities(PricingSide side) const;
+
+  // Get the order at a level of a side
+  Order GetOrder(PricingSide side, size_t level) const;
+
+  // Get the change this book carries as a message, or last had applied when stored
+  const BookChange &GetChange() const;
+
+  // Empty both stacks for a new product; levels past a side's depth are zero
+  void Reset(const T &_product);
+
+  // Add a level below the others on a side; throws when the side is full
+  void AddLevel(PricingSide side, Ticks price, long quantity);
+
+  // Add an order below the others on the stack of its side
+  void AddOrder(const Order &order);
+
+  // Make this book a delta message for a product; DELETE ignores price and quantity
+  void SetDelta(const T &_product, BookAction action, PricingSide side, size_t level, Ticks price, long quantity);
+
+  // Apply a delta message to this book, taking its trace; throws for a level the side does not have
+  void Apply(const OrderBook &delta);
 
  private:
-  T product;
-  vector<Order> bidStack;
-  vector<Order> offerStack;
+  struct Stack {
+    Ticks prices[Depth];
+    long quantities[Depth];
+    size_t depth;
+  };
+
+  ProductHandle<T> product;
+  TraceContext trace;
+  BookChange change;
+  Stack stacks[2];
 
 };
 
@@ -103,20 +171,20 @@ class MarketDataService : public Service<string, OrderBook<T> > {
  public:
 
   // Get the best bid/offer order
-  virtual const BidOffer &GetBestBidOffer(const string &productId) = 0;
+  virtual BidOffer GetBestBidOffer(const string &productId) = 0;
 
-  // Aggregate the order book
-  virtual const OrderBook<T> &AggregateDepth(const string &productId) = 0;
+  // Aggregate the order book into a single level per side of aggregate
+  virtual void AggregateDepth(const string &productId, OrderBook<T> &aggregate) = 0;
 
 };
 
-Order::Order(double _price, long _quantity, PricingSide _side) {
+Order::Order(Ticks _price, long _quantity, PricingSide _side) {
   price = _price;
   quantity = _quantity;
   side = _side;
 }
 
-double Order::GetPrice() const {
+Ticks Order::GetPrice() const {
   return price;
 }
 
@@ -140,24 +208,127 @@ const Order &BidOffer::GetOfferOrder() const {
   return offerOrder;
 }
 
-template<typename T>
-OrderBook<T>::OrderBook(const T &_product, const vector<Order> &_bidStack, const vector<Order> &_offerStack) :
-    product(_product), bidStack(_bidStack), offerStack(_offerStack) {
+template<typename T, size_t Depth>
+OrderBook<T, Depth>::OrderBook(const T &_product) : product(&_product), trace(), change(), stacks() {
 }
 
-template<typename T>
-const T &OrderBook<T>::GetProduct() const {
-  return product;
+template<typename T, size_t Depth>
+const T &OrderBook<T, Depth>::GetProduct() const {
+  return *product;
 }
 
-template<typename T>
-const vector<Order> &OrderBook<T>::GetBidStack() const {
-  return bidStack;
+template<typename T, size_t Depth>
+const TraceContext &OrderBook<T, Depth>::GetTrace() const {
+  return trace;
 }
 
-template<typename T>
-const vector<Order> &OrderBook<T>::GetOfferStack() const {
-  return offerStack;
+template<typename T, size_t Depth>
+void OrderBook<T, Depth>::SetTrace(const TraceContext &_trace) {
+  trace = _trace;
+}
+
+template<typename T, size_t Depth>
+size_t OrderBook<T, Depth>::GetDepth(PricingSide side) const {
+  return stacks[side].depth;
+}
+
+template<typename T, size_t Depth>
+const Ticks *OrderBook<T, Depth>::GetPrices(PricingSide side) const {
+  return stacks[side].prices;
+}
+
+template<typename T, size_t Depth>
+const long *OrderBook<T, Depth>::GetQuantities(PricingSide side) const {
+  return stacks[side].quantities;
+}
+
+template<typename T, size_t Depth>
+Order OrderBook<T, Depth>::GetOrder(PricingSide side, size_t level) const {
+  return Order(stacks[side].prices[level], stacks[side].quantities[level], side);
+}
+
+template<typename T, size_t Depth>
+const BookChange &OrderBook<T, Depth>::GetChange() const {
+  return change;
+}
+
+template<typename T, size_t Depth>
+void OrderBook<T, Depth>::Reset(const T &_product) {
+  product = &_product;
+  change = BookChange();
+  stacks[BID] = Stack();
+  stacks[OFFER] = Stack();
+}
+
+template<typename T, size_t Depth>
+void OrderBook<T, Depth>::AddLevel(PricingSide side, Ticks price, long quantity) {
+  Stack &stack = stacks[side];
+  if (stack.depth == Depth) {
+    throw std::runtime_error("Order book side is full at " + std::to_string(Depth) + " levels");
+  }
+  stack.prices[stack.depth] = price;
+  stack.quantities[stack.depth] = quantity;
+  stack.depth++;
+}
+
+template<typename T, size_t Depth>
+void OrderBook<T, Depth>::AddOrder(const Order &order) {
+  AddLevel(order.GetSide(), order.GetPrice(), order.GetQuantity());
+}
+
+template<typename T, size_t Depth>
+void OrderBook<T, Depth>::SetDelta(const T &_product, BookAction action, PricingSide side, size_t level, Ticks price,
+                                   long quantity) {
+  Reset(_product);
+  change = BookChange{action, side, level};
+  if (action != BookAction::DELETE) {
+    AddLevel(side, price, quantity);
+  }
+}
+
+template<typename T, size_t Depth>
+void OrderBook<T, Depth>::Apply(const OrderBook &delta) {
+  const BookChange &deltaChange = delta.GetChange();
+  Stack &stack = stacks[deltaChange.side];
+  size_t level = deltaChange.level;
+  // An add may go just below the last level; a modify or delete needs the level to exist.
+  bool valid = deltaChange.action == BookAction::ADD ? level <= stack.depth && level < Depth
+                                                     : deltaChange.action != BookAction::SNAPSHOT && level < stack.depth;
+  if (!valid) {
+    throw std::runtime_error("Cannot apply book delta at level " + std::to_string(level) + " of a side with " +
+                             std::to_string(stack.depth) + " levels");
+  }
+  switch (deltaChange.action) {
+    case BookAction::ADD: {
+      // The levels below move down one; a full side drops its last level.
+      size_t last = std::min(stack.depth, Depth - 1);
+      for (size_t i = last; i > level; --i) {
+        stack.prices[i] = stack.prices[i - 1];
+        stack.quantities[i] = stack.quantities[i - 1];
+      }
+      stack.depth = last + 1;
+      stack.prices[level] = delta.GetPrices(deltaChange.side)[0];
+      stack.quantities[level] = delta.GetQuantities(deltaChange.side)[0];
+      break;
+    }
+    case BookAction::MODIFY:
+      stack.prices[level] = delta.GetPrices(deltaChange.side)[0];
+      stack.quantities[level] = delta.GetQuantities(deltaChange.side)[0];
+      break;
+    case BookAction::DELETE:
+      for (size_t i = level; i + 1 < stack.depth; ++i) {
+        stack.prices[i] = stack.prices[i + 1];
+        stack.quantities[i] = stack.quantities[i + 1];
+      }
+      stack.depth--;
+      stack.prices[stack.depth] = Ticks();
+      stack.quantities[stack.depth] = 0;
+      break;
+    case BookAction::SNAPSHOT:
+      break;
+  }
+  change = deltaChange;
+  trace = delta.GetTrace();
 }
 
 #endif
@@ -29,6 +29,12 @@ class Position {
   // Get the product
   const T &GetProduct() const;
 
+  // Get the trace context of the chain this event belongs to
+  const TraceContext &GetTrace() const;
+
+  // Set the trace context of the chain this event belongs to
+  void SetTrace(const TraceContext &_trace);
+
   // Get the position quantity
   long GetPosition(string &book);
 
@@ -37,8 +43,15 @@ class Position {
 
   // Updates the position after a new trade.
   void UpdatePosition(const Trade<T> &trade);
+
+  // Get the positions of every book
+  const map<string, long> &GetPositions() const;
+
+  // Set the position in a book, e.g. when restoring a snapshot
+  void SetPosition(const string &book, long quantity);
  private:
-  T product;
+  ProductHandle<T> product;
+  TraceContext trace;
   map<string, long> positions;
 
 };
@@ -60,12 +73,22 @@ class PositionService : public Service<string, Position<T> > {
 
 template<typename T>
 Position<T>::Position(const T &_product) :
-    product(_product) {
+    product(&_product) {
 }
 
 template<typename T>
 const T &Position<T>::GetProduct() const {
-  return product;
+  return *product;
+}
+
+template<typename T>
+const TraceContext &Position<T>::GetTrace() const {
+  return trace;
+}
+
+template<typename T>
+void Position<T>::SetTrace(const TraceContext &_trace) {
+  trace = _trace;
 }
 
 template<typename T>
@@ -92,4 +115,14 @@ void Position<T>::UpdatePosition(const Trade<T> &trade) {
   }
 }
 
+template<typename T>
+const map<string, long> &Position<T>::GetPositions() const {
+  return positions;
+}
+
+template<typename T>
+void Position<T>::SetPosition(const string &book, long quantity) {
+  positions[book] = quantity;
+}
+
 #endif
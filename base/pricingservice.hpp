@@ -9,6 +9,7 @@
 
 #include <string>
 #include "soa.hpp"
+#include "ticks.hpp"
 
 /**
  * A price object consisting of mid and bid/offer spread.
@@ -20,21 +21,21 @@ class Price {
  public:
 
   // ctor for a price
-  Price(const T &_product, double _mid, double _bidOfferSpread);
+  Price(const T &_product, Ticks _mid, Ticks _bidOfferSpread);
 
   // Get the product
   const T &GetProduct() const;
 
   // Get the mid price
-  double GetMid() const;
+  Ticks GetMid() const;
 
   // Get the bid/offer spread around the mid
-  double GetBidOfferSpread() const;
+  Ticks GetBidOfferSpread() const;
 
  private:
-  const T &product;
-  double mid;
-  double bidOfferSpread;
+  ProductHandle<T> product;
+  Ticks mid;
+  Ticks bidOfferSpread;
 
 };
 
@@ -48,24 +49,24 @@ class PricingService : public Service<string, Price<T> > {
 };
 
 template<typename T>
-Price<T>::Price(const T &_product, double _mid, double _bidOfferSpread) :
-    product(_product) {
+Price<T>::Price(const T &_product, Ticks _mid, Ticks _bidOfferSpread) :
+    product(&_product) {
   mid = _mid;
   bidOfferSpread = _bidOfferSpread;
 }
 
 template<typename T>
 const T &Price<T>::GetProduct() const {
-  return product;
+  return *product;
 }
 
 template<typename T>
-double Price<T>::GetMid() const {
+Ticks Price<T>::GetMid() const {
   return mid;
 }
 
 template<typename T>
-double Price<T>::GetBidOfferSpread() const {
+Ticks Price<T>::GetBidOfferSpread() const {
   return bidOfferSpread;
 }
 
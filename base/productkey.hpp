@@ -0,0 +1,229 @@
+/**
+ * productkey.hpp
+ * Defines a compact 64-bit key for CUSIP and ISIN product identifiers.
+ *
+ * CUSIPs (9 characters) and ISINs (12 characters) are drawn from the digits, the
+ * upper-case letters and the CUSIP private placement symbols '*', '@' and '#'.
+ * With a zero for "no character" that is a 40-symbol alphabet, and 40^12 fits in
+ * 64 bits, so any such identifier packs into a single integer. Characters are
+ * packed most significant first, so keys order the same way as their text.
+ */
+#ifndef PRODUCT_KEY_HPP
+#define PRODUCT_KEY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+/**
+ * Product identifier packed into 64 bits.
+ */
+class ProductKey {
+
+ public:
+
+  // Longest identifier a key can hold
+  static constexpr size_t MAX_LENGTH = 12;
+
+  // ctor for the empty key
+  constexpr ProductKey() : value(0) {}
+
+  // ctor from a packed value
+  constexpr explicit ProductKey(uint64_t _value) : value(_value) {}
+
+  // Pack an identifier of up to MAX_LENGTH characters; throws on any other input
+  static ProductKey FromString(string_view id);
+
+  // Pack an identifier; returns false, leaving the key untouched, on invalid input
+  static bool TryParse(string_view id, ProductKey &key);
+
+  // Pack a CUSIP or an ISIN, throwing unless its length and check digit are valid
+  static ProductKey FromCusip(string_view cusip);
+  static ProductKey FromIsin(string_view isin);
+
+  // Check the length, alphabet and check digit of an identifier
+  static bool IsValidCusip(string_view cusip);
+  static bool IsValidIsin(string_view isin);
+
+  // Get the packed value
+  constexpr uint64_t Value() const { return value; }
+
+  constexpr bool IsEmpty() const { return value == 0; }
+
+  // Write the identifier to out, which must hold MAX_LENGTH characters. Returns its length.
+  size_t Format(char *out) const;
+
+  // Get the identifier as text
+  string ToString() const;
+
+  constexpr bool operator==(ProductKey other) const { return value == other.value; }
+  constexpr bool operator!=(ProductKey other) const { return value != other.value; }
+  constexpr bool operator<(ProductKey other) const { return value < other.value; }
+
+  // Print the identifier
+  friend ostream &operator<<(ostream &output, const ProductKey &key);
+
+ private:
+  uint64_t value;
+
+};
+
+namespace std {
+
+template <>
+struct hash<ProductKey> {
+  size_t operator()(ProductKey key) const noexcept {
+    return static_cast<size_t>(key.Value());
+  }
+};
+
+}  // namespace std
+
+namespace productkey_detail {
+
+constexpr uint64_t RADIX = 40;
+constexpr char SYMBOLS[RADIX + 1] = "\0" "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ*@#";
+
+// Symbol of a character, 1 to 39, or 0 if it cannot appear in an identifier
+constexpr uint64_t SymbolOf(char c) {
+  if (c >= '0' && c <= '9') return static_cast<uint64_t>(c - '0') + 1;
+  if (c >= 'A' && c <= 'Z') return static_cast<uint64_t>(c - 'A') + 11;
+  if (c == '*') return 37;
+  if (c == '@') return 38;
+  if (c == '#') return 39;
+  return 0;
+}
+
+// Value a character contributes to a check digit: digits are 0-9, letters 10-35, then '*', '@', '#'
+constexpr int CheckValueOf(char c) {
+  return static_cast<int>(SymbolOf(c)) - 1;
+}
+
+// Luhn check digit over the digits of values, doubling every other digit starting with the last
+inline int LuhnCheckDigit(string_view digits) {
+  int sum = 0;
+  bool doubled = true;
+  for (auto it = digits.rbegin(); it != digits.rend(); ++it) {
+    int digit = *it - '0';
+    if (doubled) {
+      digit *= 2;
+    }
+    sum += digit / 10 + digit % 10;
+    doubled = !doubled;
+  }
+  return (10 - sum % 10) % 10;
+}
+
+}  // namespace productkey_detail
+
+bool ProductKey::TryParse(string_view id, ProductKey &key) {
+  if (id.empty() || id.size() > MAX_LENGTH) {
+    return false;
+  }
+  uint64_t packed = 0;
+  for (size_t i = 0; i < MAX_LENGTH; ++i) {
+    uint64_t symbol = 0;
+    if (i < id.size()) {
+      symbol = productkey_detail::SymbolOf(id[i]);
+      if (symbol == 0) {
+        return false;
+      }
+    }
+    packed = packed * productkey_detail::RADIX + symbol;
+  }
+  key = ProductKey(packed);
+  return true;
+}
+
+ProductKey ProductKey::FromString(string_view id) {
+  ProductKey key;
+  if (!TryParse(id, key)) {
+    throw std::runtime_error("Invalid product identifier: " + string(id));
+  }
+  return key;
+}
+
+ProductKey ProductKey::FromCusip(string_view cusip) {
+  if (!IsValidCusip(cusip)) {
+    throw std::runtime_error("Invalid CUSIP: " + string(cusip));
+  }
+  return FromString(cusip);
+}
+
+ProductKey ProductKey::FromIsin(string_view isin) {
+  if (!IsValidIsin(isin)) {
+    throw std::runtime_error("Invalid ISIN: " + string(isin));
+  }
+  return FromString(isin);
+}
+
+bool ProductKey::IsValidCusip(string_view cusip) {
+  if (cusip.size() != 9 || cusip[8] < '0' || cusip[8] > '9') {
+    return false;
+  }
+  int sum = 0;
+  for (size_t i = 0; i < 8; ++i) {
+    int v = productkey_detail::CheckValueOf(cusip[i]);
+    if (v < 0) {
+      return false;
+    }
+    if (i % 2 == 1) {
+      v *= 2;
+    }
+    sum += v / 10 + v % 10;
+  }
+  return (10 - sum % 10) % 10 == cusip[8] - '0';
+}
+
+bool ProductKey::IsValidIsin(string_view isin) {
+  if (isin.size() != 12 || isin[0] < 'A' || isin[0] > 'Z' || isin[1] < 'A' || isin[1] > 'Z' ||
+      isin[11] < '0' || isin[11] > '9') {
+    return false;
+  }
+  // Letters expand to two digits each, so 11 characters give at most 22 digits.
+  char digits[22];
+  size_t length = 0;
+  for (size_t i = 0; i < 11; ++i) {
+    int v = productkey_detail::CheckValueOf(isin[i]);
+    if (v < 0 || v > 35) {
+      return false;
+    }
+    if (v >= 10) {
+      digits[length++] = static_cast<char>('0' + v / 10);
+    }
+    digits[length++] = static_cast<char>('0' + v % 10);
+  }
+  return productkey_detail::LuhnCheckDigit(string_view(digits, length)) == isin[11] - '0';
+}
+
+size_t ProductKey::Format(char *out) const {
+  uint64_t packed = value;
+  char reversed[MAX_LENGTH];
+  for (size_t i = 0; i < MAX_LENGTH; ++i) {
+    reversed[i] = productkey_detail::SYMBOLS[packed % productkey_detail::RADIX];
+    packed /= productkey_detail::RADIX;
+  }
+  size_t length = 0;
+  for (size_t i = MAX_LENGTH; i > 0 && reversed[i - 1] != '\0'; --i) {
+    out[length++] = reversed[i - 1];
+  }
+  return length;
+}
+
+string ProductKey::ToString() const {
+  char id[MAX_LENGTH];
+  return string(id, Format(id));
+}
+
+ostream &operator<<(ostream &output, const ProductKey &key) {
+  char id[ProductKey::MAX_LENGTH];
+  return output.write(id, static_cast<streamsize>(key.Format(id)));
+}
+
+#endif
@@ -7,16 +7,21 @@
 #ifndef PRODUCTS_HPP
 #define PRODUCTS_HPP
 
+#include <cstdint>
 #include <iostream>
 #include <string>
 
 #include "boost/date_time/gregorian/gregorian.hpp"
+#include "productkey.hpp"
 
 using namespace std;
 using namespace boost::gregorian;
 
 enum ProductType { IRSWAP, BOND };
 
+// Product index of a product that has not been registered with a product service.
+constexpr uint32_t NO_PRODUCT_INDEX = UINT32_MAX;
+
 /**
  * Base class for a product.
  */
@@ -33,9 +38,22 @@ class Product {
   // Ge the product type
   ProductType GetProductType() const;
 
+  // Get the packed identifier, empty for products not identified by a CUSIP or ISIN
+  ProductKey GetProductKey() const;
+
+  // Get the dense index assigned when the product was registered
+  uint32_t GetProductIndex() const;
+
+  // Set the dense index of the product
+  void SetProductIndex(uint32_t _productIndex);
+
+ protected:
+  ProductKey productKey;
+
  private:
   string productId;
   ProductType productType;
+  uint32_t productIndex = NO_PRODUCT_INDEX;
 
 };
 
@@ -186,6 +204,18 @@ ProductType Product::GetProductType() const {
   return productType;
 }
 
+ProductKey Product::GetProductKey() const {
+  return productKey;
+}
+
+uint32_t Product::GetProductIndex() const {
+  return productIndex;
+}
+
+void Product::SetProductIndex(uint32_t _productIndex) {
+  productIndex = _productIndex;
+}
+
 Bond::Bond(string _productId,
            BondIdType _bondIdType,
            string _ticker,
@@ -194,6 +224,7 @@ Bond::Bond(string _productId,
            double _pv01) : Product(
     _productId,
     BOND) {
+  productKey = _bondIdType == CUSIP ? ProductKey::FromCusip(_productId) : ProductKey::FromIsin(_productId);
   bondIdType = _bondIdType;
   ticker = _ticker;
   coupon = _coupon;
@@ -201,7 +232,7 @@ Bond::Bond(string _productId,
   pv01 = _pv01;
 }
 
-Bond::Bond() : Product(0, BOND) {
+Bond::Bond() : Product("", BOND) {
 }
 
 const string &Bond::GetTicker() const {
@@ -257,7 +288,7 @@ IRSwap::IRSwap(string _productId,
   terminationDate = _terminationDate;
 }
 
-IRSwap::IRSwap() : Product(0, IRSWAP) {
+IRSwap::IRSwap() : Product("", IRSWAP) {
 }
 
 DayCountConvention IRSwap::GetFixedLegDayCountConvention() const {
@@ -25,14 +25,24 @@ class PV01 {
   // Get the product on this PV01 value
   const T &GetProduct() const;
 
+  // Get the trace context of the chain this event belongs to
+  const TraceContext &GetTrace() const;
+
+  // Set the trace context of the chain this event belongs to
+  void SetTrace(const TraceContext &_trace);
+
   // Get the PV01 value
   double GetPV01() const;
 
   // Get the quantity that this risk value is associated with
   long GetQuantity() const;
 
+  // Refill the PV01 value in place
+  void Assign(const T &_product, double _pv01, long _quantity);
+
  private:
-  T product;
+  ProductHandle<T> product;
+  TraceContext trace;
   double pv01;
   long quantity;
 
@@ -75,21 +85,31 @@ class RiskService : public Service<string, PV01<T> > {
   // Add a position that the service will risk
   virtual void AddPosition(Position<T> &position) = 0;
 
-  // Get the bucketed risk for the bucket sector
-  virtual const PV01<BucketedSector<T> > &GetBucketedRisk(const BucketedSector<T> &sector) const = 0;
+  // Get the bucketed risk for the bucket sector into risk, reusing its storage
+  virtual void GetBucketedRisk(const BucketedSector<T> &sector, PV01<BucketedSector<T> > &risk) const = 0;
 
 };
 
 template<typename T>
 PV01<T>::PV01(const T &_product, double _pv01, long _quantity) :
-    product(_product) {
+    product(&_product) {
   pv01 = _pv01;
   quantity = _quantity;
 }
 
 template<typename T>
 const T &PV01<T>::GetProduct() const {
-  return product;
+  return *product;
+}
+
+template<typename T>
+const TraceContext &PV01<T>::GetTrace() const {
+  return trace;
+}
+
+template<typename T>
+void PV01<T>::SetTrace(const TraceContext &_trace) {
+  trace = _trace;
 }
 template<typename T>
 double PV01<T>::GetPV01() const {
@@ -100,6 +120,13 @@ long PV01<T>::GetQuantity() const {
   return quantity;
 }
 
+template<typename T>
+void PV01<T>::Assign(const T &_product, double _pv01, long _quantity) {
+  product = &_product;
+  pv01 = _pv01;
+  quantity = _quantity;
+}
+
 template<typename T>
 BucketedSector<T>::BucketedSector(const vector<T> &_products, string _name) :
     products(_products) {
@@ -8,11 +8,48 @@
 #ifndef SOA_HPP
 #define SOA_HPP
 
+#include <atomic>
+#include <cstdint>
 #include <vector>
 #include <unordered_map>
 
 using namespace std;
 
+/**
+ * Handle through which data types refer to their product instead of carrying a copy.
+ * The product must outlive everything that refers to it, so bonds should come from
+ * BondProductService, whose registry never moves or frees them.
+ */
+template<typename T>
+using ProductHandle = const T *;
+
+/**
+ * Trace context carried by the events of one causal chain, e.g. from an order book
+ * to the execution order, trade, position and risk it leads to. Holds the id of the
+ * chain and the Clock tick count when its first event was read; an id of zero means
+ * the event is not traced.
+ */
+struct TraceContext {
+  std::uint64_t id = 0;
+  std::uint64_t ingestTicks = 0;
+};
+
+/**
+ * Id of the ServiceStats stage that calls to a service or listener are counted under.
+ * Resolved from the object's type name on its first timed call and kept with the object
+ * from then on. A copy starts unresolved, as it may be reported under another name.
+ */
+class StageSlot {
+ public:
+  static constexpr std::size_t UNRESOLVED = SIZE_MAX;
+
+  StageSlot() = default;
+  StageSlot(const StageSlot &) {}
+  StageSlot &operator=(const StageSlot &) { return *this; }
+
+  std::atomic<std::size_t> id{UNRESOLVED};
+};
+
 /**
  * Definition of a generic base class ServiceListener to listen to add, update, and remve
  * events on a Service. This listener should be registered on a Service for the Service
@@ -32,6 +69,9 @@ class ServiceListener {
   // Listener callback to process an update event to the Service
   virtual void ProcessUpdate(V &data) = 0;
 
+  // Stats stage of this listener's calls
+  mutable StageSlot statsStage;
+
 };
 
 /**
@@ -67,6 +107,9 @@ class Service {
     return listeners;
   }
 
+  // Stats stage of the messages Connectors deliver to this Service
+  mutable StageSlot statsStage;
+
 };
 
 /**
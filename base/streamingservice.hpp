@@ -18,13 +18,13 @@ class PriceStreamOrder {
  public:
 
   // ctor for an order
-  PriceStreamOrder(double _price, long _visibleQuantity, long _hiddenQuantity, PricingSide _side);
+  PriceStreamOrder(Ticks _price, long _visibleQuantity, long _hiddenQuantity, PricingSide _side);
 
   // The side on this order
   PricingSide GetSide() const;
 
   // Get the price on this order
-  double GetPrice() const;
+  Ticks GetPrice() const;
 
   // Get the visible quantity on this order
   long GetVisibleQuantity() const;
@@ -33,7 +33,7 @@ class PriceStreamOrder {
   long GetHiddenQuantity() const;
 
  private:
-  double price;
+  Ticks price;
   long visibleQuantity;
   long hiddenQuantity;
   PricingSide side;
@@ -62,7 +62,7 @@ class PriceStream {
   const PriceStreamOrder &GetOfferOrder() const;
 
  private:
-  T product;
+  ProductHandle<T> product;
   PriceStreamOrder bidOrder;
   PriceStreamOrder offerOrder;
 
@@ -83,14 +83,14 @@ class StreamingService : public Service<string, PriceStream<T> > {
 
 };
 
-PriceStreamOrder::PriceStreamOrder(double _price, long _visibleQuantity, long _hiddenQuantity, PricingSide _side) {
+PriceStreamOrder::PriceStreamOrder(Ticks _price, long _visibleQuantity, long _hiddenQuantity, PricingSide _side) {
   price = _price;
   visibleQuantity = _visibleQuantity;
   hiddenQuantity = _hiddenQuantity;
   side = _side;
 }
 
-double PriceStreamOrder::GetPrice() const {
+Ticks PriceStreamOrder::GetPrice() const {
   return price;
 }
 
@@ -104,12 +104,12 @@ long PriceStreamOrder::GetHiddenQuantity() const {
 
 template<typename T>
 PriceStream<T>::PriceStream(const T &_product, const PriceStreamOrder &_bidOrder, const PriceStreamOrder &_offerOrder) :
-    product(_product), bidOrder(_bidOrder), offerOrder(_offerOrder) {
+    product(&_product), bidOrder(_bidOrder), offerOrder(_offerOrder) {
 }
 
 template<typename T>
 const T &PriceStream<T>::GetProduct() const {
-  return product;
+  return *product;
 }
 
 template<typename T>
@@ -0,0 +1,133 @@
+/**
+ * ticks.hpp
+ * Defines a fixed-point price type for US Treasury fractional prices.
+ *
+ * Treasury prices are quoted in 32nds with a trailing 8th of a 32nd ("99-16+"),
+ * so every quoted price is an exact multiple of 1/256. Quotes derived from a mid
+ * and a spread (mid +/- spread/2) can land on half of that, so the count is kept
+ * in 1/512ths of a point, which keeps every price in the system exact.
+ */
+#ifndef TICKS_HPP
+#define TICKS_HPP
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string_view>
+
+using namespace std;
+
+/**
+ * Price expressed as an integer number of 1/512ths of a point.
+ */
+class Ticks {
+
+ public:
+
+  // Number of ticks in one point (a price of 1.0)
+  static constexpr int64_t PER_POINT = 512;
+
+  // Number of ticks in 1/256th of a point, the smallest quoted increment
+  static constexpr int64_t PER_256TH = PER_POINT / 256;
+
+  // ctor for a zero price
+  constexpr Ticks() : count(0) {}
+
+  // ctor from a raw tick count
+  constexpr explicit Ticks(int64_t _count) : count(_count) {}
+
+  // Build a price from whole points, 32nds and 256ths
+  static constexpr Ticks FromParts(int64_t points, int64_t thirtySeconds, int64_t twoFiftySixths) {
+    return Ticks((points * 256 + thirtySeconds * 8 + twoFiftySixths) * PER_256TH);
+  }
+
+  // Convert a decimal price, rounding to the nearest tick
+  static Ticks FromDouble(double price) {
+    return Ticks(static_cast<int64_t>(std::llround(price * PER_POINT)));
+  }
+
+  // Parse a fractional price such as "99-16+" or "100-253". Malformed input yields zero.
+  static Ticks FromFractional(std::string_view price);
+
+  // Get the raw tick count
+  constexpr int64_t Count() const { return count; }
+
+  // Get the price as a decimal number of points
+  constexpr double ToDouble() const { return static_cast<double>(count) / PER_POINT; }
+
+  constexpr Ticks operator+(Ticks other) const { return Ticks(count + other.count); }
+  constexpr Ticks operator-(Ticks other) const { return Ticks(count - other.count); }
+  constexpr Ticks operator*(int64_t factor) const { return Ticks(count * factor); }
+  // Integer division; exact whenever the result is a whole number of ticks
+  constexpr Ticks operator/(int64_t divisor) const { return Ticks(count / divisor); }
+
+  constexpr bool operator==(Ticks other) const { return count == other.count; }
+  constexpr bool operator!=(Ticks other) const { return count != other.count; }
+  constexpr bool operator<(Ticks other) const { return count < other.count; }
+  constexpr bool operator<=(Ticks other) const { return count <= other.count; }
+  constexpr bool operator>(Ticks other) const { return count > other.count; }
+  constexpr bool operator>=(Ticks other) const { return count >= other.count; }
+
+  // Print the price in decimal, honouring the stream's precision
+  friend ostream &operator<<(ostream &output, const Ticks &ticks);
+
+ private:
+  int64_t count;
+
+};
+
+namespace ticks_detail {
+
+// Value of each character as a digit, or -1 when it is not one.
+constexpr std::array<int8_t, 256> makeDigitTable() {
+  std::array<int8_t, 256> table{};
+  for (auto &entry : table) entry = -1;
+  for (int c = '0'; c <= '9'; ++c) table[c] = static_cast<int8_t>(c - '0');
+  return table;
+}
+
+// Value of the trailing 8th-of-a-32nd character: '0'-'7', with '+' meaning 4.
+constexpr std::array<int8_t, 256> makeEighthTable() {
+  std::array<int8_t, 256> table{};
+  for (auto &entry : table) entry = -1;
+  for (int c = '0'; c <= '7'; ++c) table[c] = static_cast<int8_t>(c - '0');
+  table['+'] = 4;
+  return table;
+}
+
+constexpr std::array<int8_t, 256> DIGITS = makeDigitTable();
+constexpr std::array<int8_t, 256> EIGHTHS = makeEighthTable();
+
+}
+
+Ticks Ticks::FromFractional(std::string_view price) {
+  // The fraction is always the last three characters, preceded by the dash.
+  std::size_t size = price.size();
+  if (size < 5 || price[size - 4] != '-') {
+    return Ticks();
+  }
+  const auto *text = reinterpret_cast<const unsigned char *>(price.data());
+
+  int64_t points = 0;
+  int invalid = 0;
+  for (std::size_t i = 0; i < size - 4; ++i) {
+    int digit = ticks_detail::DIGITS[text[i]];
+    invalid |= digit;
+    points = points * 10 + digit;
+  }
+  int tens = ticks_detail::DIGITS[text[size - 3]];
+  int units = ticks_detail::DIGITS[text[size - 2]];
+  int eighth = ticks_detail::EIGHTHS[text[size - 1]];
+  invalid |= tens | units | eighth;
+
+  // Every table miss is -1, so a single sign test rejects the whole string.
+  return invalid < 0 ? Ticks() : FromParts(points, tens * 10 + units, eighth);
+}
+
+ostream &operator<<(ostream &output, const Ticks &ticks) {
+  output << ticks.ToDouble();
+  return output;
+}
+
+#endif
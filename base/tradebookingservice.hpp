@@ -8,6 +8,7 @@
 #define TRADE_BOOKING_SERVICE_HPP
 
 #include <string>
+#include <utility>
 #include <vector>
 #include "soa.hpp"
 
@@ -29,6 +30,12 @@ class Trade {
   // Get the product
   const T &GetProduct() const;
 
+  // Get the trace context of the chain this event belongs to
+  const TraceContext &GetTrace() const;
+
+  // Set the trace context of the chain this event belongs to
+  void SetTrace(const TraceContext &_trace);
+
   // Get the trade ID
   const string &GetTradeId() const;
 
@@ -44,8 +51,12 @@ class Trade {
   // Get the side
   Side GetSide() const;
 
+  // Refill the trade in place, reusing the storage of its strings
+  void Assign(const T &_product, const string &_tradeId, double _price, const string &_book, long _quantity, Side _side);
+
  private:
-  T product;
+  ProductHandle<T> product;
+  TraceContext trace;
   string tradeId;
   double price;
   string book;
@@ -71,17 +82,25 @@ class TradeBookingService : public Service<string, Trade<T> > {
 
 template<typename T>
 Trade<T>::Trade(const T &_product, string _tradeId, double _price, string _book, long _quantity, Side _side) :
-    product(_product) {
-  tradeId = _tradeId;
+    product(&_product), tradeId(std::move(_tradeId)), book(std::move(_book)) {
   price = _price;
-  book = _book;
   quantity = _quantity;
   side = _side;
 }
 
 template<typename T>
 const T &Trade<T>::GetProduct() const {
-  return product;
+  return *product;
+}
+
+template<typename T>
+const TraceContext &Trade<T>::GetTrace() const {
+  return trace;
+}
+
+template<typename T>
+void Trade<T>::SetTrace(const TraceContext &_trace) {
+  trace = _trace;
 }
 
 template<typename T>
@@ -109,6 +128,17 @@ Side Trade<T>::GetSide() const {
   return side;
 }
 
+template<typename T>
+void Trade<T>::Assign(const T &_product, const string &_tradeId, double _price, const string &_book, long _quantity,
+                      Side _side) {
+  product = &_product;
+  tradeId = _tradeId;
+  price = _price;
+  book = _book;
+  quantity = _quantity;
+  side = _side;
+}
+
 template<typename T>
 void TradeBookingService<T>::BookTrade(const Trade<T> &trade) {
 }
@@ -0,0 +1,48 @@
+#ifndef BENCH_SUPPORT_HPP
+#define BENCH_SUPPORT_HPP
+
+#include "../bond/ServiceGraph.hpp"
+#include "../bond/InputGenerator.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// ------------- Declaration: Bench support -------------
+
+// Options for a graph built in the current directory, which needs an output/
+// subdirectory: wired as main.cpp wires it without "--async-tail" or "--price-ring",
+// with the connectors fed through parse() rather than from input files.
+ServiceGraphOptions benchGraphOptions();
+
+// Register the first count products of InputGenerator::Products().
+void registerProducts(std::size_t count);
+
+// The lines of text, without their newlines.
+std::vector<std::string_view> splitLines(std::string_view text);
+
+// ------------- Definition: Bench support -------------
+
+ServiceGraphOptions benchGraphOptions() {
+  ServiceGraphOptions options;
+  options.inputDirectory = ".";
+  return options;
+}
+
+void registerProducts(std::size_t count) {
+  for (Bond &bond : InputGenerator::Products(count)) {
+    BondProductService::GetInstance()->Add(bond);
+  }
+}
+
+std::vector<std::string_view> splitLines(std::string_view text) {
+  std::vector<std::string_view> lines;
+  while (!text.empty()) {
+    std::size_t end = std::min(text.find('\n'), text.size());
+    lines.push_back(text.substr(0, end));
+    text.remove_prefix(std::min(end + 1, text.size()));
+  }
+  return lines;
+}
+
+#endif
@@ -0,0 +1,419 @@
+#include "../bond/BondPricingService.hpp"
+#include "../bond/BondAlgoStreamingService.hpp"
+#include "../bond/BondStreamingService.hpp"
+#include "../bond/BondInquiryService.hpp"
+#include "../bond/BondTradeBookingService.hpp"
+#include "../bond/BondPositionService.hpp"
+#include "../bond/BondRiskService.hpp"
+#include "../bond/BondMarketDataService.hpp"
+#include "../bond/BondAlgoExecutionService.hpp"
+#include "../bond/GUIService.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Microbenchmarks for the parsers, connectors, services and formatters.
+//
+//   bond_benchmarks [--filter text] [--out benchmarks.json] [--repetitions 7] [--min-ms 50]
+//
+// Inputs are generated from fixed seeds, so two runs time the same work. Each
+// benchmark is repeated and reported as its median, with the min and max next to
+// it, in nanoseconds per operation; the JSON output is meant to be diffed.
+
+// ------------- Declaration: BenchmarkSuite -------------
+
+struct BenchmarkResult {
+  std::string name;
+  std::uint64_t operations;  // per repetition
+  double medianNanos;
+  double minNanos;
+  double maxNanos;
+};
+
+class BenchmarkSuite {
+public:
+  BenchmarkSuite(std::string filter, int repetitions, std::chrono::milliseconds minTime);
+
+  // Time batch(), which performs operationsPerBatch operations, unless the filter excludes name.
+  // The median is printed as soon as it is known.
+  template <typename F>
+  void Run(const std::string &name, std::size_t operationsPerBatch, F &&batch);
+
+  void WriteJson(std::ostream &output) const;
+
+private:
+  std::string filter;
+  int repetitions;
+  std::chrono::milliseconds minTime;
+  std::vector<BenchmarkResult> results;
+};
+
+// Keep the compiler from discarding a result the benchmark never uses.
+template <typename T>
+void doNotOptimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// ------------- Definition: BenchmarkSuite -------------
+
+BenchmarkSuite::BenchmarkSuite(std::string filter, int repetitions, std::chrono::milliseconds minTime)
+    : filter(std::move(filter)), repetitions(std::max(repetitions, 1)), minTime(minTime) {}
+
+template <typename F>
+void BenchmarkSuite::Run(const std::string &name, std::size_t operationsPerBatch, F &&batch) {
+  if (!filter.empty() && name.find(filter) == std::string::npos) {
+    return;
+  }
+  using Clock = std::chrono::steady_clock;
+  auto time = [&batch](std::uint64_t batches) {
+    auto start = Clock::now();
+    for (std::uint64_t i = 0; i < batches; ++i) {
+      batch();
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+  };
+
+  // Warm up, then grow the batch count until one repetition takes at least minTime.
+  std::uint64_t batches = 1;
+  time(batches);
+  while (time(batches) < std::chrono::duration<double, std::nano>(minTime).count()) {
+    batches *= 2;
+  }
+
+  std::vector<double> nanosPerOperation;
+  for (int i = 0; i < repetitions; ++i) {
+    nanosPerOperation.push_back(time(batches) / static_cast<double>(batches * operationsPerBatch));
+  }
+  std::sort(nanosPerOperation.begin(), nanosPerOperation.end());
+  results.push_back(BenchmarkResult{name, batches * operationsPerBatch, nanosPerOperation[nanosPerOperation.size() / 2],
+                                    nanosPerOperation.front(), nanosPerOperation.back()});
+  std::cout << std::left << std::setw(48) << name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(12) << results.back().medianNanos << " ns/op" << std::endl;
+}
+
+void BenchmarkSuite::WriteJson(std::ostream &output) const {
+  output << "{\n  \"repetitions\": " << repetitions << ",\n  \"min_time_ms\": " << minTime.count()
+         << ",\n  \"benchmarks\": [\n";
+  output << std::fixed << std::setprecision(3);
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const BenchmarkResult &result = results[i];
+    output << "    {\"name\": \"" << result.name << "\", \"operations\": " << result.operations
+           << ", \"median_ns\": " << result.medianNanos << ", \"min_ns\": " << result.minNanos
+           << ", \"max_ns\": " << result.maxNanos << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  output << "  ]\n}\n";
+}
+
+// ------------- Inputs -------------
+
+const char *const PRODUCT_IDS[] = {"91282CME8", "91282CMB4", "91282CMD0", "91282CMC2",
+                                   "91282CLW9", "912810UF3", "912810UE6"};
+
+void addProducts() {
+  static Bond bonds[] = {
+      Bond("91282CME8", CUSIP, "T", 4., date(2026, Nov, 30), 0.019063),
+      Bond("91282CMB4", CUSIP, "T", 4., date(2027, Dec, 15), 0.028002),
+      Bond("91282CMD0", CUSIP, "T", 4., date(2029, Dec, 31), 0.044902),
+      Bond("91282CMC2", CUSIP, "T", 4., date(2031, Dec, 31), 0.060510),
+      Bond("91282CLW9", CUSIP, "T", 4., date(2034, Nov, 15), 0.081718),
+      Bond("912810UF3", CUSIP, "T", 4., date(2044, Nov, 15), 0.136657),
+      Bond("912810UE6", CUSIP, "T", 4., date(2054, Nov, 15), 0.173594),
+  };
+  for (Bond &bond : bonds) {
+    BondProductService::GetInstance()->Add(bond);
+  }
+}
+
+const Bond &product(std::size_t i) {
+  return BondProductService::GetInstance()->GetData(ProductKey::FromString(PRODUCT_IDS[i % 7]));
+}
+
+std::string fractional(std::mt19937 &generator, int lowPoints, int highPoints) {
+  std::uniform_int_distribution<int> points(lowPoints, highPoints), thirtySeconds(0, 31), eighths(0, 7);
+  int first = thirtySeconds(generator), second = eighths(generator);
+  std::string price = std::to_string(points(generator)) + "-" + (first > 9 ? "" : "0") + std::to_string(first);
+  price += second == 4 ? '+' : static_cast<char>('0' + second);
+  return price;
+}
+
+std::vector<std::string> generatePrices(std::size_t count) {
+  std::mt19937 generator(42);
+  std::vector<std::string> prices;
+  for (std::size_t i = 0; i < count; ++i) {
+    prices.push_back(fractional(generator, 99, 100));
+  }
+  return prices;
+}
+
+// Lines in the formats of input/*.txt.
+std::vector<std::string> generateLines(const std::string &kind, std::size_t count) {
+  std::mt19937 generator(7);
+  std::vector<std::string> lines;
+  for (std::size_t i = 0; i < count; ++i) {
+    std::string line = PRODUCT_IDS[i % 7];
+    if (kind == "prices") {
+      line += "," + fractional(generator, 99, 100) + ",0-00" + (i % 2 == 0 ? "+" : "1");
+    } else if (kind == "trades") {
+      line += "," + std::to_string(1734889683009925 + i) + "," + (i % 2 == 0 ? "99.0" : "100.0") + ",TRSY" +
+              std::to_string(i % 3 + 1) + "," + std::to_string((i % 5 + 1) * 1000000) + "," + std::to_string(i % 2);
+    } else if (kind == "inquiries") {
+      line += "," + std::to_string(1734889683010205 + i) + "," + std::to_string(i % 2) + "," +
+              std::to_string((i % 5 + 1) * 1000000);
+    } else {
+      for (int side = 0; side < 2; ++side) {
+        for (int level = 1; level <= 5; ++level) {
+          line += "," + fractional(generator, 99, 100) + "," + std::to_string(level * 10000000);
+        }
+      }
+    }
+    lines.push_back(line);
+  }
+  return lines;
+}
+
+std::vector<Order> stack(PricingSide side, std::mt19937 &generator) {
+  std::vector<Order> orders;
+  for (int level = 1; level <= 5; ++level) {
+    orders.emplace_back(Ticks::FromFractional(fractional(generator, 99, 100)), level * 10000000, side);
+  }
+  return orders;
+}
+
+// ------------- Sinks -------------
+
+// Connected service for connector benchmarks: takes every message and does nothing with it.
+template <typename V>
+class SinkService : public Service<std::string, V> {
+public:
+  void OnMessage(V &data) override { doNotOptimize(data); }
+};
+
+// ------------- Benchmarks -------------
+
+// The splitString/std::stod parser the connectors used before the mmap read path.
+double legacyFractionalToDouble(std::string price) {
+  auto split = splitString(price, '-');
+  if (split.size() != 2) {
+    return 0.0;
+  }
+  return std::stod(split[0]) +
+         std::stod(split[1].substr(0, 2)) / 32.0 +
+         ((split[1][2] == '+') ? 4 : (split[1][2] - '0')) / 256.0;
+}
+
+void benchmarkParsers(BenchmarkSuite &suite) {
+  const std::vector<std::string> prices = generatePrices(4096);
+  // Every parser must agree on every input before any timing is reported.
+  for (const auto &price : prices) {
+    double expected = legacyFractionalToDouble(price);
+    if (fractionalToDouble(price) != expected || Ticks::FromFractional(price).ToDouble() != expected) {
+      throw std::runtime_error("Parsers disagree on " + price);
+    }
+  }
+  suite.Run("legacy splitString/stod fractional", prices.size(), [&]() {
+    for (const auto &price : prices) doNotOptimize(legacyFractionalToDouble(price));
+  });
+  suite.Run("fractionalToDouble", prices.size(), [&]() {
+    for (const auto &price : prices) doNotOptimize(fractionalToDouble(price));
+  });
+  suite.Run("Ticks::FromFractional", prices.size(), [&]() {
+    for (const auto &price : prices) doNotOptimize(Ticks::FromFractional(price).Count());
+  });
+
+  const std::vector<std::string> lines = generateLines("marketdata", 1024);
+  suite.Run("splitString marketdata line", lines.size(), [&]() {
+    for (const auto &line : lines) doNotOptimize(splitString(line, ',').size());
+  });
+  FieldSpans fields;
+  suite.Run("FieldSpans::split marketdata line", lines.size(), [&]() {
+    for (const auto &line : lines) doNotOptimize(fields.split(line, ','));
+  });
+}
+
+// Split and parse each line as InputFileConnector::read() does, minus the file.
+template <typename K, typename V>
+void benchmarkParse(BenchmarkSuite &suite, const std::string &name, InputFileConnector<K, V> &connector,
+                    const std::vector<std::string> &lines) {
+  FieldSpans fields;
+  suite.Run(name, lines.size(), [&]() {
+    for (const auto &line : lines) {
+      fields.split(line, ',');
+      connector.parse(line, fields);
+    }
+  });
+}
+
+void benchmarkConnectors(BenchmarkSuite &suite) {
+  SinkService<Price<Bond>> prices;
+  SinkService<Trade<Bond>> trades;
+  SinkService<Inquiry<Bond>> inquiries;
+  SinkService<OrderBook<Bond>> books;
+  BondPricesConnector pricesConnector("prices.txt", &prices);
+  BondTradesConnector tradesConnector("trades.txt", &trades);
+  BondInquirySubscriber inquirySubscriber("inquiries.txt", &inquiries);
+  BondMarketDataConnector marketDataConnector("marketdata.txt", &books);
+
+  benchmarkParse(suite, "BondPricesConnector::parse", pricesConnector, generateLines("prices", 1024));
+  benchmarkParse(suite, "BondTradesConnector::parse", tradesConnector, generateLines("trades", 1024));
+  benchmarkParse(suite, "BondInquirySubscriber::parse", inquirySubscriber, generateLines("inquiries", 1024));
+  const std::vector<std::string> marketData = generateLines("marketdata", 1024);
+  benchmarkParse(suite, "BondMarketDataConnector::parse", marketDataConnector, marketData);
+
+  FieldSpans fields;
+  suite.Run("BondMarketDataConnector::decode", marketData.size(), [&]() {
+    for (const auto &line : marketData) {
+      fields.split(line, ',');
+      doNotOptimize(marketDataConnector.decode(line, fields));
+    }
+  });
+}
+
+void benchmarkMarketData(BenchmarkSuite &suite) {
+  std::mt19937 generator(11);
+  const std::vector<Order> bids = stack(PricingSide::BID, generator);
+  const std::vector<Order> offers = stack(PricingSide::OFFER, generator);
+  suite.Run("OrderBook<Bond> construction", 1, [&]() {
+    OrderBook<Bond> book(product(0));
+    for (std::size_t level = 0; level < bids.size(); ++level) {
+      book.AddOrder(bids[level]);
+      book.AddOrder(offers[level]);
+    }
+    doNotOptimize(book);
+  });
+  OrderBook<Bond> recycled(product(0));
+  suite.Run("OrderBook<Bond>::Reset/AddOrder", 1, [&]() {
+    recycled.Reset(product(0));
+    for (std::size_t level = 0; level < bids.size(); ++level) {
+      recycled.AddOrder(bids[level]);
+      recycled.AddOrder(offers[level]);
+    }
+    doNotOptimize(recycled);
+  });
+
+  BondMarketDataService marketDataService;
+  for (std::size_t i = 0; i < 7; ++i) {
+    OrderBook<Bond> book(product(i));
+    for (const Order &order : stack(PricingSide::BID, generator)) book.AddOrder(order);
+    for (const Order &order : stack(PricingSide::OFFER, generator)) book.AddOrder(order);
+    marketDataService.OnMessage(book);
+  }
+  std::vector<std::string> productIds(PRODUCT_IDS, PRODUCT_IDS + 7);
+  suite.Run("BondMarketDataService::GetBestBidOffer", productIds.size(), [&]() {
+    for (const auto &productId : productIds) doNotOptimize(marketDataService.GetBestBidOffer(productId));
+  });
+  OrderBook<Bond> aggregate(product(0));
+  suite.Run("BondMarketDataService::AggregateDepth", productIds.size(), [&]() {
+    for (const auto &productId : productIds) {
+      marketDataService.AggregateDepth(productId, aggregate);
+      doNotOptimize(aggregate);
+    }
+  });
+}
+
+void benchmarkPositionsAndRisk(BenchmarkSuite &suite) {
+  std::vector<Trade<Bond>> trades;
+  for (std::size_t i = 0; i < 1024; ++i) {
+    trades.emplace_back(product(0), std::to_string(i), 99.5, "TRSY" + std::to_string(i % 3 + 1),
+                        static_cast<long>((i % 5 + 1) * 1000000), i % 2 == 0 ? BUY : SELL);
+  }
+  Position<Bond> position(product(0));
+  suite.Run("Position<Bond>::UpdatePosition", trades.size(), [&]() {
+    for (const auto &trade : trades) position.UpdatePosition(trade);
+  });
+  suite.Run("Position<Bond>::GetAggregatePosition", 1, [&]() {
+    doNotOptimize(position.GetAggregatePosition());
+  });
+
+  BondRiskService riskService;
+  std::vector<Position<Bond>> positions;
+  for (std::size_t i = 0; i < 7; ++i) {
+    positions.emplace_back(product(i));
+    positions.back().UpdatePosition(trades[i]);
+  }
+  suite.Run("BondRiskService::AddPosition", positions.size(), [&]() {
+    for (auto &held : positions) riskService.AddPosition(held);
+  });
+}
+
+void benchmarkFormatters(BenchmarkSuite &suite, const std::filesystem::path &directory) {
+  auto path = [&directory](const char *name) { return (directory / name).string(); };
+  BondExecutionOrderConnector executionConnector(path("executions.txt"));
+  BondInquiryPublisher inquiryPublisher(path("inquiries.txt"));
+  BondPositionConnector positionConnector(path("positions.txt"));
+  BondRiskConnector riskConnector(path("risk.txt"));
+  BondPriceStreamsConnector streamsConnector(path("streaming.txt"));
+  GUIConnector guiConnector(path("gui.txt"));
+
+  ExecutionOrder<Bond> order(product(0), BID, "Order_12345", MARKET, 99.515625, 10000000, 0, "", false);
+  Inquiry<Bond> inquiry("1734889683010205", product(0), BUY, 1000000, 99.515625, InquiryState::QUOTED);
+  Position<Bond> position(product(0));
+  position.UpdatePosition(Trade<Bond>(product(0), "1", 99.5, "TRSY1", 1000000, BUY));
+  position.UpdatePosition(Trade<Bond>(product(0), "2", 99.5, "TRSY2", 2000000, SELL));
+  PV01<Bond> risk(product(0), 19063.0, 1000000);
+  PriceStream<Bond> stream(product(0), PriceStreamOrder(Ticks::FromFractional("99-160"), 1000000, 2000000, BID),
+                           PriceStreamOrder(Ticks::FromFractional("99-162"), 1000000, 2000000, OFFER));
+  Price<Bond> price(product(0), Ticks::FromFractional("99-161"), Ticks::FromFractional("0-00+"));
+
+  suite.Run("BondExecutionOrderConnector::toString", 1, [&]() { doNotOptimize(executionConnector.toString(order)); });
+  suite.Run("BondInquiryPublisher::toString", 1, [&]() { doNotOptimize(inquiryPublisher.toString(inquiry)); });
+  suite.Run("BondPositionConnector::toString", 1, [&]() { doNotOptimize(positionConnector.toString(position)); });
+  suite.Run("BondRiskConnector::toString", 1, [&]() { doNotOptimize(riskConnector.toString(risk)); });
+  suite.Run("BondPriceStreamsConnector::toString", 1, [&]() { doNotOptimize(streamsConnector.toString(stream)); });
+  suite.Run("GUIConnector::toString", 1, [&]() { doNotOptimize(guiConnector.toString(price)); });
+  suite.Run("ProductKey::ToString", 1, [&]() { doNotOptimize(product(0).GetProductKey().ToString()); });
+}
+
+int main(int argc, char *argv[]) {
+  std::string filter;
+  std::string out = "benchmarks.json";
+  int repetitions = 7;
+  long minMillis = 50;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (std::strcmp(argv[i], "--filter") == 0) {
+      filter = argv[i + 1];
+    } else if (std::strcmp(argv[i], "--out") == 0) {
+      out = argv[i + 1];
+    } else if (std::strcmp(argv[i], "--repetitions") == 0) {
+      repetitions = static_cast<int>(parseLong(argv[i + 1]));
+    } else if (std::strcmp(argv[i], "--min-ms") == 0) {
+      minMillis = parseLong(argv[i + 1]);
+    } else {
+      std::cerr << "Unknown option: " << argv[i] << std::endl;
+      return 1;
+    }
+  }
+
+  addProducts();
+  // The output connectors write their files here; the formatters never publish, so they stay empty.
+  std::filesystem::path directory = std::filesystem::temp_directory_path() / "bond_benchmarks";
+  std::filesystem::create_directories(directory);
+
+  BenchmarkSuite suite(filter, repetitions, std::chrono::milliseconds(minMillis));
+  try {
+    benchmarkParsers(suite);
+    benchmarkConnectors(suite);
+    benchmarkMarketData(suite);
+    benchmarkPositionsAndRisk(suite);
+    benchmarkFormatters(suite, directory);
+  } catch (const std::exception &error) {
+    std::cerr << error.what() << std::endl;
+    return 1;
+  }
+
+  std::ofstream json(out);
+  if (!json) {
+    std::cerr << "Unable to write " << out << std::endl;
+    return 1;
+  }
+  suite.WriteJson(json);
+  std::cout << "Results written to " << out << std::endl;
+  return 0;
+}
@@ -0,0 +1,208 @@
+#include "BenchSupport.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Throughput and per-message latency of the service graph main.cpp wires, fed
+// from memory instead of files, for one or more universe sizes.
+//
+//   bond_end_to_end [--products 7,100,1000,10000] [--messages 200000] [--trades 10] [--inquiries 10]
+//                   [--order round-robin|product] [--seed 1] [--out end_to_end.json]
+//
+// Each universe gets --messages price and --messages market data lines in total,
+// split evenly across its products, so the sizes are compared on the same load;
+// trades and inquiries are per product, as in data_generator.py. A last
+// "bookdeltas" stream sends the same count of market data as one snapshot per
+// product followed by single-level deltas. Lines are
+// generated before the clock starts. A message's latency runs from splitting its
+// line to the return of the connector's parse(), which covers every synchronous
+// listener downstream, file writes included. The output files go to a scratch
+// directory under the system temp directory.
+
+// ------------- Declaration: EndToEndOptions -------------
+
+struct EndToEndOptions {
+  std::vector<std::size_t> products{7, 100, 1000, 10000};
+  std::size_t messages = 200000;
+  std::size_t tradesPerProduct = 10;
+  std::size_t inquiriesPerProduct = 10;
+  InputOrder order = InputOrder::ROUND_ROBIN;
+  std::uint64_t seed = 1;
+  std::string out = "end_to_end.json";
+
+  // Throws on an unknown option or a malformed value.
+  static EndToEndOptions Parse(int argc, char *argv[]);
+};
+
+// ------------- Declaration: StreamResult -------------
+
+// One input stream of one universe. latency.events[MESSAGE] counts its messages.
+struct StreamResult {
+  std::size_t products;
+  double seconds;
+  StageSnapshot latency;
+
+  double MessagesPerSecond() const;
+};
+
+// ------------- Definition: EndToEndOptions -------------
+
+EndToEndOptions EndToEndOptions::Parse(int argc, char *argv[]) {
+  EndToEndOptions options;
+  for (int i = 1; i < argc; i += 2) {
+    if (i + 1 >= argc) {
+      throw std::runtime_error(std::string("Missing value for ") + argv[i]);
+    }
+    std::string option = argv[i], value = argv[i + 1];
+    if (option == "--products") {
+      options.products.clear();
+      FieldSpans counts;
+      counts.split(value, ',');
+      for (std::size_t j = 0; j < counts.size(); ++j) {
+        options.products.push_back(parseLong(counts[j]));
+      }
+      // Universes are registered cumulatively, so run them smallest first.
+      std::sort(options.products.begin(), options.products.end());
+    } else if (option == "--messages") {
+      options.messages = parseLong(value);
+    } else if (option == "--trades") {
+      options.tradesPerProduct = parseLong(value);
+    } else if (option == "--inquiries") {
+      options.inquiriesPerProduct = parseLong(value);
+    } else if (option == "--order" && (value == "product" || value == "round-robin")) {
+      options.order = value == "product" ? InputOrder::BY_PRODUCT : InputOrder::ROUND_ROBIN;
+    } else if (option == "--seed") {
+      options.seed = parseLong(value);
+    } else if (option == "--out") {
+      options.out = value;
+    } else {
+      throw std::runtime_error("Unknown option: " + option + " " + value);
+    }
+  }
+  return options;
+}
+
+// ------------- Definition: StreamResult -------------
+
+double StreamResult::MessagesPerSecond() const {
+  return seconds > 0 ? static_cast<double>(latency.Count()) / seconds : 0;
+}
+
+// ------------- Feeding -------------
+
+// Split and parse every line of text as InputFileConnector::read() would, timing each one.
+template <typename K, typename V>
+StreamResult feed(const std::string &name, std::size_t products, InputFileConnector<K, V> &connector,
+                  const std::string &text) {
+  std::vector<std::string_view> lines = splitLines(text);
+  StreamResult result{products, 0, StageSnapshot{}};
+  result.latency.name = name;
+  result.latency.buckets.assign(LatencyHistogram::BUCKETS, 0);
+  FieldSpans fields;
+  std::int64_t start = Clock::MonotonicNanos();
+  for (std::string_view line : lines) {
+    std::uint64_t before = Clock::Ticks();
+    fields.split(line, ',');
+    connector.parse(line, fields);
+    auto nanos = static_cast<std::uint64_t>(Clock::TicksToNanos(Clock::Ticks() - before));
+    result.latency.buckets[LatencyHistogram::BucketOf(nanos)]++;
+    result.latency.maxNanos = std::max(result.latency.maxNanos, nanos);
+  }
+  result.seconds = static_cast<double>(Clock::MonotonicNanos() - start) / 1e9;
+  result.latency.events[static_cast<std::size_t>(StageEvent::MESSAGE)] = lines.size();
+  return result;
+}
+
+// Feed each input to a fresh graph in main's order.
+std::vector<StreamResult> runUniverse(const EndToEndOptions &options, std::size_t products) {
+  registerProducts(products);
+  InputGenerator generator(products, options.seed);
+  std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+  std::size_t rows = std::max<std::size_t>(1, options.messages / products);
+  std::string inquiries = generator.Generate(InputKind::INQUIRIES, options.inquiriesPerProduct, options.order, threads);
+  std::string prices = generator.Generate(InputKind::PRICES, rows, options.order, threads);
+  std::string trades = generator.Generate(InputKind::TRADES, options.tradesPerProduct, options.order, threads);
+  std::string marketData = generator.Generate(InputKind::MARKET_DATA, rows, options.order, threads);
+  std::string bookDeltas = generator.Generate(InputKind::MARKET_DATA_DELTAS, rows, options.order, threads);
+
+  std::vector<StreamResult> results;
+  withServiceGraph(benchGraphOptions(), [&](const ServiceGraph &graph) {
+    results.push_back(feed("inquiries", products, *graph.inquiries, inquiries));
+    results.push_back(feed("prices", products, *graph.prices, prices));
+    results.push_back(feed("trades", products, *graph.trades, trades));
+    results.push_back(feed("marketdata", products, *graph.marketData, marketData));
+    results.push_back(feed("bookdeltas", products, *graph.marketData, bookDeltas));
+  });
+  return results;
+}
+
+// ------------- Reporting -------------
+
+void printResult(const StreamResult &result) {
+  std::cout << std::left << std::setw(10) << result.products << std::setw(12) << result.latency.name << std::right
+            << std::setw(10) << result.latency.Count() << std::setw(12) << static_cast<std::uint64_t>(result.MessagesPerSecond())
+            << std::setw(10) << result.latency.Percentile(0.50) << std::setw(10) << result.latency.Percentile(0.99)
+            << std::setw(10) << result.latency.Percentile(0.999) << std::setw(12) << result.latency.maxNanos
+            << std::endl;
+}
+
+void writeJson(std::ostream &output, const EndToEndOptions &options, const std::vector<StreamResult> &results) {
+  output << "{\n  \"messages\": " << options.messages << ",\n  \"order\": \""
+         << (options.order == InputOrder::BY_PRODUCT ? "product" : "round-robin") << "\",\n  \"streams\": [\n";
+  output << std::fixed << std::setprecision(1);
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const StreamResult &result = results[i];
+    output << "    {\"products\": " << result.products << ", \"stream\": \"" << result.latency.name
+           << "\", \"messages\": " << result.latency.Count() << ", \"messages_per_second\": "
+           << result.MessagesPerSecond() << ", \"p50_ns\": " << result.latency.Percentile(0.50)
+           << ", \"p99_ns\": " << result.latency.Percentile(0.99) << ", \"p99.9_ns\": "
+           << result.latency.Percentile(0.999) << ", \"max_ns\": " << result.latency.maxNanos << "}"
+           << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  output << "  ]\n}\n";
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<StreamResult> results;
+  EndToEndOptions options;
+  try {
+    options = EndToEndOptions::Parse(argc, argv);
+    std::filesystem::path out = std::filesystem::absolute(options.out);
+    std::filesystem::path home = std::filesystem::current_path();
+    std::filesystem::path scratch = std::filesystem::temp_directory_path() / "bond_end_to_end";
+
+    std::cout << std::left << std::setw(10) << "products" << std::setw(12) << "stream" << std::right
+              << std::setw(10) << "messages" << std::setw(12) << "msg/s" << std::setw(10) << "p50 ns"
+              << std::setw(10) << "p99 ns" << std::setw(10) << "p99.9 ns" << std::setw(12) << "max ns" << std::endl;
+    for (std::size_t products : options.products) {
+      if (products == 0) {
+        throw std::runtime_error("A universe needs at least one product");
+      }
+      std::filesystem::path directory = scratch / std::to_string(products);
+      std::filesystem::create_directories(directory / "output");
+      std::filesystem::current_path(directory);
+      for (const StreamResult &result : runUniverse(options, products)) {
+        printResult(result);
+        results.push_back(result);
+      }
+      std::filesystem::current_path(home);
+    }
+
+    std::ofstream json(out);
+    if (!json) {
+      throw std::runtime_error("Unable to write " + out.string());
+    }
+    writeJson(json, options, results);
+    std::cout << "Results written to " << out.string() << std::endl;
+  } catch (const std::exception &error) {
+    std::cerr << error.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
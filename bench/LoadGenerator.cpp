@@ -0,0 +1,305 @@
+#include "BenchSupport.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Open-loop load test of the price and market data chains. Events go in at a fixed
+// rate on a schedule that does not wait for the services, and each one's latency
+// is measured from its scheduled send time to the return of the chain.
+//
+//   bond_load_generator [--rates 50000,100000,200000,400000,800000,1600000,3200000] [--seconds 1]
+//                       [--stream prices|marketdata|both] [--products 7] [--pool 65536] [--seed 1]
+//                       [--out load.json]
+//
+// The chains are synchronous, so an event that comes due while the one before it
+// is still running waits; its latency includes that wait. Timing from the actual
+// send instead, as a closed-loop replay does, would drop the wait and hide a
+// saturated chain (coordinated omission). Both are reported: "latency" from the
+// schedule, "service" from the send. Each rate runs on a fresh graph after a short
+// warm-up. Events are decoded before the clock starts, from a pool of generated
+// lines that is cycled through. Per-stage counts, latencies and busy fractions for
+// every step come from ServiceStats and go to the JSON output only.
+
+// ------------- Declaration: LoadOptions -------------
+
+struct LoadOptions {
+  std::vector<double> rates{50000, 100000, 200000, 400000, 800000, 1600000, 3200000};
+  double seconds = 1;
+  std::vector<std::string> streams{"prices", "marketdata"};
+  std::size_t products = 7;
+  std::size_t pool = 65536;
+  std::uint64_t seed = 1;
+  std::string out = "load.json";
+
+  // Throws on an unknown option or a malformed value.
+  static LoadOptions Parse(int argc, char *argv[]);
+};
+
+// ------------- Declaration: LoadStep -------------
+
+// Stage activity during one step.
+struct StageLoad {
+  StageSnapshot calls;
+  double busy;  // fraction of the step spent inside the stage, nested stages included
+};
+
+// One stream at one offered rate.
+struct LoadStep {
+  std::string stream;
+  double targetRate;
+  double achievedRate;
+  std::int64_t maxLateNanos;  // furthest a send fell behind its schedule
+  StageSnapshot latency;      // from scheduled send to completion
+  StageSnapshot service;      // from actual send to completion
+  std::vector<StageLoad> stages;
+
+  // Sends fell behind the schedule for good: the chain cannot sustain the rate.
+  bool Saturated() const;
+};
+
+// ------------- Definition: LoadOptions -------------
+
+LoadOptions LoadOptions::Parse(int argc, char *argv[]) {
+  LoadOptions options;
+  for (int i = 1; i < argc; i += 2) {
+    if (i + 1 >= argc) {
+      throw std::runtime_error(std::string("Missing value for ") + argv[i]);
+    }
+    std::string option = argv[i], value = argv[i + 1];
+    if (option == "--rates") {
+      options.rates.clear();
+      FieldSpans rates;
+      rates.split(value, ',');
+      for (std::size_t j = 0; j < rates.size(); ++j) {
+        options.rates.push_back(static_cast<double>(parseLong(rates[j])));
+      }
+    } else if (option == "--seconds") {
+      options.seconds = std::stod(value);
+    } else if (option == "--stream" && (value == "prices" || value == "marketdata" || value == "both")) {
+      options.streams = value == "both" ? std::vector<std::string>{"prices", "marketdata"}
+                                        : std::vector<std::string>{value};
+    } else if (option == "--products") {
+      options.products = parseLong(value);
+    } else if (option == "--pool") {
+      options.pool = parseLong(value);
+    } else if (option == "--seed") {
+      options.seed = parseLong(value);
+    } else if (option == "--out") {
+      options.out = value;
+    } else {
+      throw std::runtime_error("Unknown option: " + option + " " + value);
+    }
+  }
+  for (double rate : options.rates) {
+    if (rate <= 0) {
+      throw std::runtime_error("Rates must be positive");
+    }
+  }
+  if (options.products == 0 || options.pool == 0 || options.seconds <= 0) {
+    throw std::runtime_error("--products, --pool and --seconds must be positive");
+  }
+  return options;
+}
+
+// ------------- Definition: LoadStep -------------
+
+bool LoadStep::Saturated() const {
+  return achievedRate < 0.95 * targetRate;
+}
+
+// ------------- Driving -------------
+
+StageSnapshot emptySnapshot(const std::string &name) {
+  StageSnapshot snapshot;
+  snapshot.name = name;
+  snapshot.buckets.assign(LatencyHistogram::BUCKETS, 0);
+  return snapshot;
+}
+
+void recordNanos(StageSnapshot &snapshot, std::int64_t nanos) {
+  auto value = static_cast<std::uint64_t>(std::max<std::int64_t>(nanos, 0));
+  snapshot.buckets[LatencyHistogram::BucketOf(value)]++;
+  snapshot.maxNanos = std::max(snapshot.maxNanos, value);
+  snapshot.events[static_cast<std::size_t>(StageEvent::MESSAGE)]++;
+}
+
+// Mean of a histogram, taking each bucket at its midpoint.
+double meanNanos(const StageSnapshot &snapshot) {
+  double total = 0;
+  for (std::size_t bucket = 0; bucket < snapshot.buckets.size(); ++bucket) {
+    if (snapshot.buckets[bucket] != 0) {
+      double low = bucket == 0 ? 0 : static_cast<double>(LatencyHistogram::HighestIn(bucket - 1) + 1);
+      total += snapshot.buckets[bucket] * (low + static_cast<double>(LatencyHistogram::HighestIn(bucket))) / 2;
+    }
+  }
+  std::uint64_t count = snapshot.Count();
+  return count == 0 ? 0 : total / static_cast<double>(count);
+}
+
+// Stage activity between two ServiceStats snapshots; stages only ever get appended.
+std::vector<StageLoad> stageLoads(const std::vector<StageSnapshot> &before, const std::vector<StageSnapshot> &after,
+                                  double seconds) {
+  std::vector<StageLoad> loads;
+  for (std::size_t stage = 0; stage < after.size(); ++stage) {
+    StageSnapshot calls = after[stage];
+    if (stage < before.size()) {
+      for (std::size_t event = 0; event < calls.events.size(); ++event) {
+        calls.events[event] -= before[stage].events[event];
+      }
+      for (std::size_t bucket = 0; bucket < calls.buckets.size(); ++bucket) {
+        calls.buckets[bucket] -= before[stage].buckets[bucket];
+      }
+    }
+    if (calls.Count() != 0) {
+      double busy = meanNanos(calls) * static_cast<double>(calls.Count()) / (seconds * 1e9);
+      loads.push_back(StageLoad{std::move(calls), busy});
+    }
+  }
+  return loads;
+}
+
+// Offer pool events to entry at rate for the configured time, cycling through the pool.
+template <typename V>
+LoadStep drive(const LoadOptions &options, const std::string &stream, double rate, Service<std::string, V> *entry,
+               std::vector<V> &pool) {
+  // Warm the caches and the output files up, off the record.
+  std::size_t warmup = std::min(pool.size(), static_cast<std::size_t>(rate / 10) + 1);
+  for (std::size_t i = 0; i < warmup; ++i) {
+    dispatchMessage(entry, pool[i]);
+  }
+
+  LoadStep step{stream, rate, 0, 0, emptySnapshot("latency"), emptySnapshot("service"), {}};
+  auto events = static_cast<std::size_t>(rate * options.seconds);
+  double intervalNanos = 1e9 / rate;
+  std::vector<StageSnapshot> before = ServiceStats::Instance().Snapshot();
+  std::int64_t start = Clock::MonotonicNanos();
+  std::int64_t done = start;
+  for (std::size_t i = 0; i < events; ++i) {
+    std::int64_t scheduled = start + static_cast<std::int64_t>(static_cast<double>(i) * intervalNanos);
+    std::int64_t sent = Clock::MonotonicNanos();
+    while (sent < scheduled) {
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#endif
+      sent = Clock::MonotonicNanos();
+    }
+    dispatchMessage(entry, pool[(warmup + i) % pool.size()]);
+    done = Clock::MonotonicNanos();
+    recordNanos(step.latency, done - scheduled);
+    recordNanos(step.service, done - sent);
+    step.maxLateNanos = std::max(step.maxLateNanos, sent - scheduled);
+  }
+  double seconds = static_cast<double>(std::max<std::int64_t>(done - start, 1)) / 1e9;
+  step.achievedRate = static_cast<double>(events) / seconds;
+  step.stages = stageLoads(before, ServiceStats::Instance().Snapshot(), seconds);
+  return step;
+}
+
+// Decode a pool of generated lines with the connector, as it would hand them on.
+template <typename V>
+std::vector<V> decodePool(const LoadOptions &options, InputKind kind, ChunkedInputFileConnector<std::string, V> &connector) {
+  InputGenerator generator(options.products, options.seed);
+  std::size_t rows = (options.pool + options.products - 1) / options.products;
+  std::string text = generator.Generate(kind, rows, InputOrder::ROUND_ROBIN, std::thread::hardware_concurrency());
+  std::vector<V> pool;
+  FieldSpans fields;
+  for (std::string_view line : splitLines(text)) {
+    fields.split(line, ',');
+    pool.push_back(connector.decode(line, fields));
+  }
+  return pool;
+}
+
+LoadStep runStep(const LoadOptions &options, const std::string &stream, double rate) {
+  LoadStep step;
+  withServiceGraph(benchGraphOptions(), [&](const ServiceGraph &graph) {
+    if (stream == "prices") {
+      std::vector<Price<Bond>> pool = decodePool<Price<Bond>>(options, InputKind::PRICES, *graph.prices);
+      step = drive(options, stream, rate, graph.pricingService, pool);
+    } else {
+      std::vector<OrderBook<Bond>> pool = decodePool<OrderBook<Bond>>(options, InputKind::MARKET_DATA, *graph.marketData);
+      step = drive(options, stream, rate, graph.marketDataPipeline, pool);
+    }
+  });
+  return step;
+}
+
+// ------------- Reporting -------------
+
+void printStep(const LoadStep &step) {
+  std::cout << std::left << std::setw(12) << step.stream << std::right << std::setw(10)
+            << static_cast<std::uint64_t>(step.targetRate) << std::setw(10)
+            << static_cast<std::uint64_t>(step.achievedRate) << std::setw(10) << step.latency.Percentile(0.50)
+            << std::setw(12) << step.latency.Percentile(0.99) << std::setw(12) << step.latency.Percentile(0.999)
+            << std::setw(12) << step.latency.maxNanos << std::setw(10) << step.service.Percentile(0.50)
+            << std::setw(10) << step.service.Percentile(0.99) << std::setw(11) << (step.Saturated() ? "yes" : "no")
+            << std::endl;
+}
+
+void writeJson(std::ostream &output, const LoadOptions &options, const std::vector<LoadStep> &steps) {
+  output << "{\n  \"products\": " << options.products << ",\n  \"seconds\": " << options.seconds
+         << ",\n  \"steps\": [\n";
+  output << std::fixed << std::setprecision(3);
+  for (std::size_t i = 0; i < steps.size(); ++i) {
+    const LoadStep &step = steps[i];
+    output << "    {\"stream\": \"" << step.stream << "\", \"target_rate\": " << step.targetRate
+           << ", \"achieved_rate\": " << step.achievedRate << ", \"saturated\": "
+           << (step.Saturated() ? "true" : "false") << ", \"max_late_ns\": " << step.maxLateNanos;
+    for (const StageSnapshot *snapshot : {&step.latency, &step.service}) {
+      output << ", \"" << snapshot->name << "\": {\"p50_ns\": " << snapshot->Percentile(0.50)
+             << ", \"p99_ns\": " << snapshot->Percentile(0.99) << ", \"p99.9_ns\": " << snapshot->Percentile(0.999)
+             << ", \"max_ns\": " << snapshot->maxNanos << "}";
+    }
+    output << ",\n     \"stages\": [";
+    for (std::size_t j = 0; j < step.stages.size(); ++j) {
+      const StageLoad &stage = step.stages[j];
+      output << (j == 0 ? "\n" : ",\n") << "       {\"name\": \"" << stage.calls.name
+             << "\", \"calls\": " << stage.calls.Count() << ", \"p50_ns\": " << stage.calls.Percentile(0.50)
+             << ", \"p99_ns\": " << stage.calls.Percentile(0.99) << ", \"busy\": " << stage.busy << "}";
+    }
+    output << "]}" << (i + 1 < steps.size() ? "," : "") << "\n";
+  }
+  output << "  ]\n}\n";
+}
+
+int main(int argc, char *argv[]) {
+  try {
+    LoadOptions options = LoadOptions::Parse(argc, argv);
+    std::filesystem::path out = std::filesystem::absolute(options.out);
+    std::filesystem::path home = std::filesystem::current_path();
+    std::filesystem::path scratch = std::filesystem::temp_directory_path() / "bond_load_generator";
+    std::filesystem::create_directories(scratch / "output");
+    std::filesystem::current_path(scratch);
+    registerProducts(options.products);
+
+    std::cout << std::left << std::setw(12) << "stream" << std::right << std::setw(10) << "target/s"
+              << std::setw(10) << "actual/s" << std::setw(10) << "p50 ns" << std::setw(12) << "p99 ns"
+              << std::setw(12) << "p99.9 ns" << std::setw(12) << "max ns" << std::setw(10) << "svc p50"
+              << std::setw(10) << "svc p99" << std::setw(11) << "saturated" << std::endl;
+    std::vector<LoadStep> steps;
+    for (const std::string &stream : options.streams) {
+      for (double rate : options.rates) {
+        steps.push_back(runStep(options, stream, rate));
+        printStep(steps.back());
+      }
+    }
+    std::filesystem::current_path(home);
+
+    std::ofstream json(out);
+    if (!json) {
+      throw std::runtime_error("Unable to write " + out.string());
+    }
+    writeJson(json, options, steps);
+    std::cout << "Results written to " << out.string() << std::endl;
+  } catch (const std::exception &error) {
+    std::cerr << error.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,196 @@
+#ifndef BOND_ASYNC_FILE_WRITER_HPP
+#define BOND_ASYNC_FILE_WRITER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "SpscQueue.hpp"
+
+// ------------- Declaration: AsyncFileWriter -------------
+
+// Keeps one file descriptor open and writes to it from a background thread.
+// Records are copied into a lock-free single-producer/single-consumer byte ring;
+// the flusher drains it once flushBytes are pending or flushInterval has passed,
+// and on Flush() or destruction. Only one thread may call Write/WriteLine/Flush.
+// Both sides sleep on a Parker: the flusher until there is enough to write, and
+// the producer, in Flush() or on a full ring, until the flusher has drained.
+class AsyncFileWriter {
+public:
+  static constexpr std::size_t DEFAULT_CAPACITY = 1 << 20;
+  static constexpr std::size_t DEFAULT_FLUSH_BYTES = 64 << 10;
+  static constexpr std::chrono::milliseconds DEFAULT_FLUSH_INTERVAL{50};
+
+  // Truncates the file. Capacity is rounded up to a power of two.
+  explicit AsyncFileWriter(const std::string &filePath,
+                           std::size_t capacity = DEFAULT_CAPACITY,
+                           std::size_t flushBytes = DEFAULT_FLUSH_BYTES,
+                           std::chrono::milliseconds flushInterval = DEFAULT_FLUSH_INTERVAL);
+  ~AsyncFileWriter();
+  AsyncFileWriter(const AsyncFileWriter &) = delete;
+  AsyncFileWriter &operator=(const AsyncFileWriter &) = delete;
+
+  // Queue raw bytes, waiting for the flusher while the ring is full.
+  void Write(const char *data, std::size_t size);
+
+  // Queue a line followed by '\n'.
+  void WriteLine(std::string_view line);
+
+  // Block until everything queued so far has been handed to the kernel.
+  void Flush();
+
+private:
+  void run();
+  void drain();
+  void checkError() const;
+
+  std::string filePath;
+  int fd;
+  std::size_t capacity;
+  std::size_t flushBytes;
+  std::chrono::milliseconds flushInterval;
+  std::unique_ptr<char[]> ring;
+
+  // Producer and consumer positions live on separate cache lines.
+  alignas(64) std::atomic<std::uint64_t> head;
+  alignas(64) std::atomic<std::uint64_t> tail;
+  alignas(64) std::atomic<bool> running;
+  std::atomic<int> error;
+  std::atomic<std::uint64_t> flushTarget;  // Flush() wants the ring drained up to here
+
+  Parker flusherParker;
+  Parker producerParker;
+  std::thread flusher;
+};
+
+// ------------- Definition: AsyncFileWriter -------------
+
+AsyncFileWriter::AsyncFileWriter(const std::string &filePath, std::size_t capacity, std::size_t flushBytes,
+                                 std::chrono::milliseconds flushInterval)
+    : filePath(filePath), fd(-1), capacity(1), flushBytes(flushBytes), flushInterval(flushInterval),
+      head(0), tail(0), running(true), error(0), flushTarget(0) {
+  while (this->capacity < std::max<std::size_t>(capacity, 64)) {
+    this->capacity <<= 1;
+  }
+  this->flushBytes = std::min(std::max<std::size_t>(flushBytes, 1), this->capacity / 2);
+  ring.reset(new char[this->capacity]);
+  fd = ::open(filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    throw std::runtime_error("Unable to open file: " + filePath);
+  }
+  flusher = std::thread(&AsyncFileWriter::run, this);
+}
+
+AsyncFileWriter::~AsyncFileWriter() {
+  running.store(false, std::memory_order_release);
+  flusherParker.Unpark();
+  flusher.join();
+  ::close(fd);
+}
+
+void AsyncFileWriter::Write(const char *data, std::size_t size) {
+  checkError();
+  std::uint64_t position = head.load(std::memory_order_relaxed);
+  std::uint64_t start = position;
+  while (size > 0) {
+    std::size_t free = capacity - static_cast<std::size_t>(position - tail.load(std::memory_order_acquire));
+    if (free == 0) {
+      flusherParker.Unpark();
+      producerParker.Park([&]() { return position - tail.load(std::memory_order_acquire) < capacity; },
+                          flushInterval);
+      checkError();
+      continue;
+    }
+    std::size_t chunk = std::min(size, free);
+    std::size_t offset = static_cast<std::size_t>(position & (capacity - 1));
+    std::size_t first = std::min(chunk, capacity - offset);
+    std::memcpy(ring.get() + offset, data, first);
+    std::memcpy(ring.get(), data + first, chunk - first);
+    position += chunk;
+    data += chunk;
+    size -= chunk;
+    head.store(position, std::memory_order_release);
+  }
+  // Wake the flusher only as the pending bytes cross flushBytes; it re-checks before parking.
+  std::uint64_t drained = tail.load(std::memory_order_relaxed);
+  if (start - drained < flushBytes && position - drained >= flushBytes) {
+    flusherParker.Unpark();
+  }
+}
+
+void AsyncFileWriter::WriteLine(std::string_view line) {
+  Write(line.data(), line.size());
+  Write("\n", 1);
+}
+
+void AsyncFileWriter::Flush() {
+  std::uint64_t target = head.load(std::memory_order_relaxed);
+  if (tail.load(std::memory_order_acquire) < target) {
+    flushTarget.store(target, std::memory_order_relaxed);
+    flusherParker.Unpark();
+  }
+  while (tail.load(std::memory_order_acquire) < target) {
+    producerParker.Park([&]() { return tail.load(std::memory_order_acquire) >= target; }, flushInterval);
+    checkError();
+  }
+  checkError();
+}
+
+void AsyncFileWriter::run() {
+  while (true) {
+    bool stopping = !running.load(std::memory_order_acquire);
+    drain();
+    producerParker.Unpark();
+    if (stopping) {
+      // Everything queued before shutdown has now been written.
+      return;
+    }
+    flusherParker.Park([this]() {
+      std::uint64_t drained = tail.load(std::memory_order_relaxed);
+      return !running.load(std::memory_order_acquire) ||
+          head.load(std::memory_order_acquire) - drained >= flushBytes ||
+          flushTarget.load(std::memory_order_relaxed) > drained;
+    }, flushInterval);
+  }
+}
+
+void AsyncFileWriter::drain() {
+  std::uint64_t start = tail.load(std::memory_order_relaxed);
+  std::uint64_t end = head.load(std::memory_order_acquire);
+  while (start < end) {
+    std::size_t offset = static_cast<std::size_t>(start & (capacity - 1));
+    std::size_t pending = static_cast<std::size_t>(end - start);
+    std::size_t first = std::min(pending, capacity - offset);
+    iovec parts[2] = {{ring.get() + offset, first}, {ring.get(), pending - first}};
+    ssize_t result = ::writev(fd, parts, pending > first ? 2 : 1);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      // Drop the data so the producer cannot block forever; it sees the error next call.
+      error.store(errno, std::memory_order_relaxed);
+      result = static_cast<ssize_t>(pending);
+    }
+    start += static_cast<std::uint64_t>(result);
+    tail.store(start, std::memory_order_release);
+  }
+}
+
+void AsyncFileWriter::checkError() const {
+  int code = error.load(std::memory_order_relaxed);
+  if (code != 0) {
+    throw std::runtime_error("Unable to write file: " + filePath + ": " + std::strerror(code));
+  }
+}
+
+#endif
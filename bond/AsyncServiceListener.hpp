@@ -0,0 +1,239 @@
+#ifndef BOND_ASYNC_SERVICE_LISTENER_HPP
+#define BOND_ASYNC_SERVICE_LISTENER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <pthread.h>
+#include <sched.h>
+#include "../base/soa.hpp"
+#include "Recycle.hpp"
+#include "ServiceStats.hpp"
+#include "SpscQueue.hpp"
+
+// ------------- Declaration: AsyncListenerOptions -------------
+
+struct AsyncListenerOptions {
+  std::size_t capacity = 4096;  // events; rounded up to a power of two
+  WaitStrategy waitStrategy = WaitStrategy::PARK;
+  int cpu = -1;  // pin the consumer thread to this CPU, or -1 to leave it to the scheduler
+};
+
+// ------------- Declaration: AsyncListenerStats -------------
+
+struct AsyncListenerStats {
+  std::uint64_t enqueued = 0;
+  std::uint64_t processed = 0;
+  std::size_t depth = 0;         // events waiting when the stats were taken
+  std::size_t maxDepth = 0;      // most events ever waiting at once
+  std::uint64_t fullStalls = 0;  // events that found the queue full and had to wait
+};
+
+// ------------- Declaration: AsyncServiceListener -------------
+
+// Runs another listener on a consumer thread of its own. Events are copied into
+// an SPSC queue by the thread that calls ProcessAdd/ProcessRemove/ProcessUpdate,
+// which must always be the same thread, and replayed in order on the consumer.
+// A full queue makes the producer wait. An exception thrown by the listener is
+// rethrown to the producer on its next call, and later events are dropped.
+template <typename V>
+class AsyncServiceListener : public ServiceListener<V> {
+public:
+  explicit AsyncServiceListener(ServiceListener<V> *listener, AsyncListenerOptions options = AsyncListenerOptions());
+  ~AsyncServiceListener();
+  AsyncServiceListener(const AsyncServiceListener &) = delete;
+  AsyncServiceListener &operator=(const AsyncServiceListener &) = delete;
+
+  void ProcessAdd(V &data) override;
+  void ProcessRemove(V &data) override;
+  void ProcessUpdate(V &data) override;
+
+  // Block until the listener has handled every event queued so far.
+  void Drain();
+
+  // Producer side only.
+  AsyncListenerStats GetStats() const;
+
+private:
+  enum class EventType { ADD, REMOVE, UPDATE };
+
+  // Queue slots keep their last event, so copying the next one in reuses its storage.
+  struct Event {
+    EventType type = EventType::ADD;
+    std::optional<V> data;
+  };
+
+  // Upper bound on one park, so shutdown never depends on a single wake-up, and an
+  // event enqueued just as the consumer parks waits no longer than this.
+  static constexpr std::chrono::milliseconds PARK_TIMEOUT{10};
+
+  void enqueue(EventType type, V &data);
+  void run();
+  void wait();
+  void checkError() const;
+
+  ServiceListener<V> *listener;
+  AsyncListenerOptions options;
+  SpscQueue<Event> queue;
+  Parker parker;
+
+  // Producer only.
+  std::uint64_t enqueued;
+  std::size_t maxDepth;
+  std::uint64_t fullStalls;
+
+  alignas(64) std::atomic<std::uint64_t> processed;
+  std::atomic<bool> running;
+  std::atomic<bool> failed;
+  std::exception_ptr error;
+  std::thread consumer;
+};
+
+// ------------- Definition: AsyncServiceListener -------------
+
+template <typename V>
+AsyncServiceListener<V>::AsyncServiceListener(ServiceListener<V> *listener, AsyncListenerOptions options)
+    : listener(listener), options(options), queue(options.capacity), enqueued(0), maxDepth(0), fullStalls(0),
+      processed(0), running(true), failed(false) {
+  consumer = std::thread(&AsyncServiceListener::run, this);
+  if (options.cpu >= 0) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(options.cpu, &cpus);
+    if (pthread_setaffinity_np(consumer.native_handle(), sizeof(cpus), &cpus) != 0) {
+      running.store(false, std::memory_order_release);
+      parker.Unpark();
+      consumer.join();
+      throw std::runtime_error("Unable to pin listener thread to CPU " + std::to_string(options.cpu));
+    }
+  }
+}
+
+template <typename V>
+AsyncServiceListener<V>::~AsyncServiceListener() {
+  running.store(false, std::memory_order_release);
+  parker.Unpark();
+  consumer.join();
+}
+
+template <typename V>
+void AsyncServiceListener<V>::ProcessAdd(V &data) {
+  enqueue(EventType::ADD, data);
+}
+
+template <typename V>
+void AsyncServiceListener<V>::ProcessRemove(V &data) {
+  enqueue(EventType::REMOVE, data);
+}
+
+template <typename V>
+void AsyncServiceListener<V>::ProcessUpdate(V &data) {
+  enqueue(EventType::UPDATE, data);
+}
+
+template <typename V>
+void AsyncServiceListener<V>::Drain() {
+  while (processed.load(std::memory_order_acquire) < enqueued) {
+    parker.Unpark();
+    std::this_thread::yield();
+  }
+  checkError();
+}
+
+template <typename V>
+AsyncListenerStats AsyncServiceListener<V>::GetStats() const {
+  AsyncListenerStats stats;
+  stats.enqueued = enqueued;
+  stats.processed = processed.load(std::memory_order_acquire);
+  stats.depth = queue.Size();
+  stats.maxDepth = maxDepth;
+  stats.fullStalls = fullStalls;
+  return stats;
+}
+
+template <typename V>
+void AsyncServiceListener<V>::enqueue(EventType type, V &data) {
+  checkError();
+  auto produce = [type, &data](std::optional<Event> &slot) {
+    if (!slot) {
+      slot.emplace();
+    }
+    slot->type = type;
+    recycleInto(slot->data, data);
+  };
+  if (!queue.TryProduce(produce)) {
+    fullStalls++;
+    do {
+      parker.Unpark();
+      std::this_thread::yield();
+      checkError();
+    } while (!queue.TryProduce(produce));
+  }
+  enqueued++;
+  maxDepth = std::max(maxDepth, queue.Size());
+  if (options.waitStrategy == WaitStrategy::PARK) {
+    parker.UnparkIfParked();
+  }
+}
+
+template <typename V>
+void AsyncServiceListener<V>::run() {
+  auto dispatch = [this](Event &event) {
+    if (failed.load(std::memory_order_relaxed)) {
+      return;
+    }
+    try {
+      switch (event.type) {
+        case EventType::ADD: dispatchAdd(listener, *event.data); break;
+        case EventType::REMOVE: dispatchRemove(listener, *event.data); break;
+        case EventType::UPDATE: dispatchUpdate(listener, *event.data); break;
+      }
+    } catch (...) {
+      error = std::current_exception();
+      failed.store(true, std::memory_order_release);
+    }
+  };
+  while (true) {
+    bool stopping = !running.load(std::memory_order_acquire);
+    if (queue.TryConsume(dispatch)) {
+      processed.fetch_add(1, std::memory_order_release);
+    } else if (stopping) {
+      // Everything queued before shutdown has now been handled.
+      return;
+    } else {
+      wait();
+    }
+  }
+}
+
+template <typename V>
+void AsyncServiceListener<V>::wait() {
+  switch (options.waitStrategy) {
+    case WaitStrategy::BUSY_SPIN:
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#endif
+      break;
+    case WaitStrategy::YIELD:
+      std::this_thread::yield();
+      break;
+    case WaitStrategy::PARK:
+      parker.Park([this]() { return queue.Size() > 0 || !running.load(std::memory_order_acquire); }, PARK_TIMEOUT);
+      break;
+  }
+}
+
+template <typename V>
+void AsyncServiceListener<V>::checkError() const {
+  if (failed.load(std::memory_order_acquire)) {
+    std::rethrow_exception(error);
+  }
+}
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef BOND_BINARY_INPUT_FORMAT_HPP
+#define BOND_BINARY_INPUT_FORMAT_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Pre-parsed input files are laid out as
+//
+//   BinaryFileHeader | recordCount fixed-size records | productCount BinaryProductId
+//
+// Records refer to products by their index in the trailing product table, and
+// prices are stored as Ticks counts. Fields are written in host byte order.
+
+// ------------- Declaration: Binary records -------------
+
+constexpr char BINARY_INPUT_MAGIC[8] = {'B', 'T', 'S', 'B', 'I', 'N', '\0', '\0'};
+constexpr std::uint32_t BINARY_INPUT_VERSION = 1;
+constexpr std::size_t BINARY_BOOK_DEPTH = 5;
+
+enum class BinaryRecordType : std::uint32_t { ORDER_BOOK = 1, PRICE = 2 };
+
+struct BinaryFileHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t recordType;
+  std::uint32_t recordSize;
+  std::uint32_t productCount;
+  std::uint64_t recordCount;
+  std::uint64_t productTableOffset;
+};
+
+struct BinaryProductId {
+  char id[16];  // NUL padded
+};
+
+struct BinaryOrderBookRecord {
+  std::uint32_t productIndex;
+  std::uint32_t reserved;
+  std::int64_t bidPrices[BINARY_BOOK_DEPTH];
+  std::int64_t bidQuantities[BINARY_BOOK_DEPTH];
+  std::int64_t offerPrices[BINARY_BOOK_DEPTH];
+  std::int64_t offerQuantities[BINARY_BOOK_DEPTH];
+};
+
+struct BinaryPriceRecord {
+  std::uint32_t productIndex;
+  std::uint32_t reserved;
+  std::int64_t mid;
+  std::int64_t bidOfferSpread;
+};
+
+// Every record starts on an 8-byte boundary so the mapping can be read in place.
+static_assert(sizeof(BinaryFileHeader) % 8 == 0, "header must keep records aligned");
+static_assert(sizeof(BinaryOrderBookRecord) % 8 == 0, "order book records must stay aligned");
+static_assert(sizeof(BinaryPriceRecord) % 8 == 0, "price records must stay aligned");
+
+// True when the buffer starts with a pre-parsed input header.
+bool isBinaryInput(const char *data, std::size_t size);
+
+// ------------- Declaration: BinaryInputWriter -------------
+
+// Streams fixed-size records to a file and appends the interned product table on Close().
+class BinaryInputWriter {
+public:
+  BinaryInputWriter(const std::string &filePath, BinaryRecordType recordType, std::uint32_t recordSize);
+  ~BinaryInputWriter();
+
+  // Get the product table index for a product id, adding it on first sight.
+  std::uint32_t Intern(std::string_view productId);
+
+  void Append(const void *record);
+  void Close();
+
+private:
+  std::ofstream out;
+  BinaryFileHeader header;
+  std::unordered_map<std::string, std::uint32_t> productIndex;
+  std::vector<BinaryProductId> products;
+  bool closed;
+};
+
+// ------------- Definition: Binary records -------------
+
+bool isBinaryInput(const char *data, std::size_t size) {
+  return size >= sizeof(BinaryFileHeader) && std::memcmp(data, BINARY_INPUT_MAGIC, sizeof(BINARY_INPUT_MAGIC)) == 0;
+}
+
+// ------------- Definition: BinaryInputWriter -------------
+
+BinaryInputWriter::BinaryInputWriter(const std::string &filePath, BinaryRecordType recordType,
+                                     std::uint32_t recordSize)
+    : out(filePath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc), header{}, closed(false) {
+  if (!out) {
+    throw std::runtime_error("Unable to open file: " + filePath);
+  }
+  std::memcpy(header.magic, BINARY_INPUT_MAGIC, sizeof(BINARY_INPUT_MAGIC));
+  header.version = BINARY_INPUT_VERSION;
+  header.recordType = static_cast<std::uint32_t>(recordType);
+  header.recordSize = recordSize;
+  // Reserve the header; it is rewritten with the final counts on Close().
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+}
+
+BinaryInputWriter::~BinaryInputWriter() {
+  if (!closed) {
+    try {
+      Close();
+    } catch (...) {
+      // Destructors must not throw; call Close() directly to see write errors.
+    }
+  }
+}
+
+std::uint32_t BinaryInputWriter::Intern(std::string_view productId) {
+  auto found = productIndex.find(std::string(productId));
+  if (found != productIndex.end()) {
+    return found->second;
+  }
+  if (productId.size() >= sizeof(BinaryProductId::id)) {
+    throw std::runtime_error("Product id too long for binary input: " + std::string(productId));
+  }
+  BinaryProductId entry{};
+  std::memcpy(entry.id, productId.data(), productId.size());
+  products.push_back(entry);
+  auto index = static_cast<std::uint32_t>(products.size() - 1);
+  productIndex.emplace(std::string(productId), index);
+  return index;
+}
+
+void BinaryInputWriter::Append(const void *record) {
+  out.write(static_cast<const char *>(record), header.recordSize);
+  header.recordCount++;
+}
+
+void BinaryInputWriter::Close() {
+  closed = true;
+  header.productCount = static_cast<std::uint32_t>(products.size());
+  header.productTableOffset = sizeof(header) + header.recordCount * header.recordSize;
+  out.write(reinterpret_cast<const char *>(products.data()),
+            static_cast<std::streamsize>(products.size() * sizeof(BinaryProductId)));
+  out.seekp(0);
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  out.close();
+  if (!out) {
+    throw std::runtime_error("Failed to write binary input file");
+  }
+}
+
+#endif
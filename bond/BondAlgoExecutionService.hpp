@@ -6,7 +6,10 @@
 #include "../base/soa.hpp"
 #include "../base/executionservice.hpp"
 #include "IOFileConnector.hpp"
+#include "HistoricalJournal.hpp"
 #include "BondAlgoStreamingService.hpp"
+#include "StaticPipeline.hpp"
+#include "Trace.hpp"
 
 #include <vector>
 #include <string>
@@ -34,6 +37,17 @@ public:
   void Execute(OrderBook<Bond> &orderBook);
   void OnMessage(AlgoExecution<Bond> &data) override;
 
+  // As Execute(), also notifying the static listeners next.
+  template <typename Next>
+  void Execute(OrderBook<Bond> &orderBook, Next &next);
+
+  // The side the next execution takes and its order number, e.g. for a snapshot.
+  int GetSideCursor() const;
+  long GetOrderNumber() const;
+
+  // Continue from a snapshot's side and order number.
+  void RestoreState(int sideCursor, long nextOrderNumber);
+
 private:
   std::vector<PricingSide> sideState;
   int cur_ptr;
@@ -50,6 +64,11 @@ public:
   void ProcessRemove(OrderBook<Bond> &data) override;
   void ProcessUpdate(OrderBook<Bond> &data) override;
 
+  template <typename Next>
+  void ProcessAdd(OrderBook<Bond> &data, Next &next);
+  template <typename Next>
+  void ProcessUpdate(OrderBook<Bond> &data, Next &next);
+
 private:
   BondAlgoExecutionService *listeningService;
 };
@@ -58,14 +77,14 @@ private:
 
 class BondExecutionOrderServiceListener : public ServiceListener<ExecutionOrder<Bond>> {
 public:
-  explicit BondExecutionOrderServiceListener(HistoricalDataService<ExecutionOrder<Bond>> *listeningService);
+  explicit BondExecutionOrderServiceListener(HistoricalDataService<ExecutionOrder<Bond>, ProductKey> *listeningService);
 
   void ProcessAdd(ExecutionOrder<Bond> &data) override;
   void ProcessRemove(ExecutionOrder<Bond> &data) override;
   void ProcessUpdate(ExecutionOrder<Bond> &data) override;
 
 private:
-  HistoricalDataService<ExecutionOrder<Bond>> *listeningService;
+  HistoricalDataService<ExecutionOrder<Bond>, ProductKey> *listeningService;
 };
 
 // ------------- Declaration: BondExecutionOrderConnector -------------
@@ -75,19 +94,34 @@ public:
   explicit BondExecutionOrderConnector(const std::string &filePath);
 
 private:
-  std::string toString(ExecutionOrder<Bond> &data) override;
+  void format(ExecutionOrder<Bond> &data, RecordWriter &record) override;
+};
+
+// ------------- Declaration: ExecutionJournalRecord -------------
+
+// Order ids longer than the fixed fields are truncated.
+struct ExecutionJournalRecord {
+  double price;
+  std::int64_t visibleQuantity;
+  std::int64_t hiddenQuantity;
+  std::int32_t side;
+  std::int32_t orderType;
+  std::int32_t isChildOrder;
+  char orderId[20];
+  char parentOrderId[20];
 };
 
 // ------------- Declaration: BondExecutionHistoricalDataService -------------
 
-class BondExecutionHistoricalDataService : public HistoricalDataService<ExecutionOrder<Bond>> {
+class BondExecutionHistoricalDataService : public HistoricalDataService<ExecutionOrder<Bond>, ProductKey> {
 public:
-  BondExecutionHistoricalDataService();
-  void PersistData(std::string persistKey, const ExecutionOrder<Bond> &data) override;
+  explicit BondExecutionHistoricalDataService(PersistenceMode mode = PersistenceMode::TEXT);
+  void PersistData(ProductKey persistKey, const ExecutionOrder<Bond> &data) override;
 
 private:
   void OnMessage(ExecutionOrder<Bond> &data) override;
-  BondExecutionOrderConnector *connector;
+  std::unique_ptr<BondExecutionOrderConnector> connector;
+  std::unique_ptr<HistoricalJournalWriter<ExecutionJournalRecord>> journal;
 };
 
 // ------------- Definition: AlgoExecution<T> -------------
@@ -107,28 +141,58 @@ BondAlgoExecutionService::BondAlgoExecutionService()
     : sideState({PricingSide::BID, PricingSide::OFFER}), cur_ptr(0), orderNumber(1) {}
 
 void BondAlgoExecutionService::Execute(OrderBook<Bond> &orderBook) {
-  auto topBid = orderBook.GetBidStack()[0];
-  auto topOffer = orderBook.GetOfferStack()[0];
-  double spread = topOffer.GetPrice() - topBid.GetPrice();
-
-  if (spread <= 1.0 / 128) {
-    long volume = sideState[cur_ptr] == BID ? topBid.GetQuantity() : topOffer.GetQuantity();
-    double price = sideState[cur_ptr] == BID ? topBid.GetPrice() : topOffer.GetPrice();
+  NoListeners none;
+  Execute(orderBook, none);
+}
 
-    ExecutionOrder<Bond> executionOrder(
-        orderBook.GetProduct(), sideState[cur_ptr], "Order_" + std::to_string(orderNumber), MARKET, price, volume, 0, "", false);
+template <typename Next>
+void BondAlgoExecutionService::Execute(OrderBook<Bond> &orderBook, Next &next) {
+  Tracer::Instance().Stamp(orderBook.GetTrace(), TraceHop::ALGO_EXECUTION);
+  // A delta below the top of book cannot change whether the market is tight enough to cross.
+  if (!orderBook.GetChange().TouchesTop() || orderBook.GetDepth(PricingSide::BID) == 0 ||
+      orderBook.GetDepth(PricingSide::OFFER) == 0) {
+    return;
+  }
+  Order topBid = orderBook.GetOrder(PricingSide::BID, 0);
+  Order topOffer = orderBook.GetOrder(PricingSide::OFFER, 0);
+  Ticks spread = topOffer.GetPrice() - topBid.GetPrice();
+
+  // Only cross when the market is at its tightest, 1/128th (two 256ths).
+  if (spread <= Ticks::FromParts(0, 0, 2)) {
+    PricingSide side = sideState[cur_ptr];
+    long volume = side == BID ? topBid.GetQuantity() : topOffer.GetQuantity();
+    Ticks price = side == BID ? topBid.GetPrice() : topOffer.GetPrice();
+
+    ExecutionOrder<Bond> executionOrder(orderBook.GetProduct(), side, "Order_" + std::to_string(orderNumber),
+                                        MARKET, price.ToDouble(), volume, 0, "", false);
+    executionOrder.SetTrace(orderBook.GetTrace());
     AlgoExecution<Bond> algoExecution(executionOrder);
 
-    for (auto listener : GetListeners())
-      listener->ProcessAdd(algoExecution);
-
+    // Advance before notifying, so a snapshot taken downstream already counts this execution.
     cur_ptr = (cur_ptr + 1) % sideState.size();
     orderNumber++;
+    notifyAdd(GetListeners(), next, algoExecution);
   }
 }
 
 void BondAlgoExecutionService::OnMessage(AlgoExecution<Bond> &data) {}
 
+int BondAlgoExecutionService::GetSideCursor() const {
+  return cur_ptr;
+}
+
+long BondAlgoExecutionService::GetOrderNumber() const {
+  return orderNumber;
+}
+
+void BondAlgoExecutionService::RestoreState(int sideCursor, long nextOrderNumber) {
+  if (sideCursor < 0 || static_cast<std::size_t>(sideCursor) >= sideState.size()) {
+    throw std::runtime_error("Invalid algo execution side in snapshot: " + std::to_string(sideCursor));
+  }
+  cur_ptr = sideCursor;
+  orderNumber = nextOrderNumber;
+}
+
 // ------------- Definition: BondMarketDataServiceListener -------------
 
 BondMarketDataServiceListener::BondMarketDataServiceListener(BondAlgoExecutionService *listeningService)
@@ -144,14 +208,24 @@ void BondMarketDataServiceListener::ProcessUpdate(OrderBook<Bond> &data) {
   listeningService->Execute(data);
 }
 
+template <typename Next>
+void BondMarketDataServiceListener::ProcessAdd(OrderBook<Bond> &data, Next &next) {
+  listeningService->Execute(data, next);
+}
+
+template <typename Next>
+void BondMarketDataServiceListener::ProcessUpdate(OrderBook<Bond> &data, Next &next) {
+  listeningService->Execute(data, next);
+}
+
 // ------------- Definition: BondExecutionOrderServiceListener -------------
 
 BondExecutionOrderServiceListener::BondExecutionOrderServiceListener(
-    HistoricalDataService<ExecutionOrder<Bond>> *listeningService)
+    HistoricalDataService<ExecutionOrder<Bond>, ProductKey> *listeningService)
     : listeningService(listeningService) {}
 
 void BondExecutionOrderServiceListener::ProcessAdd(ExecutionOrder<Bond> &data) {
-  listeningService->PersistData(data.GetProduct().GetProductId(), data);
+  listeningService->PersistData(data.GetProduct().GetProductKey(), data);
 }
 
 void BondExecutionOrderServiceListener::ProcessRemove(ExecutionOrder<Bond> &data) {}
@@ -163,25 +237,42 @@ void BondExecutionOrderServiceListener::ProcessUpdate(ExecutionOrder<Bond> &data
 BondExecutionOrderConnector::BondExecutionOrderConnector(const std::string &filePath)
     : OutputFileConnector(filePath) {}
 
-std::string BondExecutionOrderConnector::toString(ExecutionOrder<Bond> &data) {
-  std::ostringstream oss;
-  oss << boost::posix_time::microsec_clock::universal_time() << ","
-      << data.GetProduct().GetProductId() << "," << data.GetSide() << "," << data.GetOrderId() << ","
-      << data.GetOrderType() << "," << data.GetPrice() << "," << data.GetVisibleQuantity() << ","
-      << data.GetHiddenQuantity() << "," << data.GetParentOrderId() << ","
-      << data.IsChildOrder();
-  return oss.str();
+void BondExecutionOrderConnector::format(ExecutionOrder<Bond> &data, RecordWriter &record) {
+  record.Timestamp()
+      .Field(data.GetProduct().GetProductId()).Field(data.GetSide()).Field(data.GetOrderId())
+      .Field(data.GetOrderType()).Field(data.GetPrice()).Field(data.GetVisibleQuantity())
+      .Field(data.GetHiddenQuantity()).Field(data.GetParentOrderId())
+      .Field(data.IsChildOrder());
 }
 
 // ------------- Definition: BondExecutionHistoricalDataService -------------
 
-BondExecutionHistoricalDataService::BondExecutionHistoricalDataService() {
-  connector = new BondExecutionOrderConnector("output/execution.txt");
+BondExecutionHistoricalDataService::BondExecutionHistoricalDataService(PersistenceMode mode) {
+  if (mode != PersistenceMode::JOURNAL) {
+    connector = std::make_unique<BondExecutionOrderConnector>("output/execution.txt");
+  }
+  if (mode != PersistenceMode::TEXT) {
+    journal = std::make_unique<HistoricalJournalWriter<ExecutionJournalRecord>>("output/execution.journal");
+  }
 }
 
-void BondExecutionHistoricalDataService::PersistData(std::string persistKey,
+void BondExecutionHistoricalDataService::PersistData(ProductKey persistKey,
                                                      const ExecutionOrder<Bond> &data) {
-  connector->Publish(const_cast<ExecutionOrder<Bond> &>(data));
+  if (connector) {
+    connector->Publish(const_cast<ExecutionOrder<Bond> &>(data));
+  }
+  if (journal) {
+    ExecutionJournalRecord record{};
+    record.price = data.GetPrice();
+    record.visibleQuantity = data.GetVisibleQuantity();
+    record.hiddenQuantity = data.GetHiddenQuantity();
+    record.side = data.GetSide();
+    record.orderType = data.GetOrderType();
+    record.isChildOrder = data.IsChildOrder();
+    data.GetOrderId().copy(record.orderId, sizeof(record.orderId) - 1);
+    data.GetParentOrderId().copy(record.parentOrderId, sizeof(record.parentOrderId) - 1);
+    journal->Append(persistKey, record);
+  }
 }
 
 void BondExecutionHistoricalDataService::OnMessage(ExecutionOrder<Bond> &data) {}
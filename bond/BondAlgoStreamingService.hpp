@@ -5,6 +5,8 @@
 #include "../base/products.hpp"
 #include "../base/soa.hpp"
 #include "../base/streamingservice.hpp"
+#include "DenseStore.hpp"
+#include "ServiceStats.hpp"
 
 
 // ------------- Declaration: AlgoStream<T> -------------
@@ -16,12 +18,12 @@ public:
   const PriceStream<T> &getPriceStream() const;
 
 private:
-  const PriceStream<T> &priceStream;
+  PriceStream<T> priceStream;
 };
 
 // ------------- Declaration: BondAlgoStreamingService -------------
 
-class BondAlgoStreamingService : public Service<std::string, AlgoStream<Bond>> {
+class BondAlgoStreamingService : public DenseService<AlgoStream<Bond>> {
 public:
   BondAlgoStreamingService();
 
@@ -63,7 +65,7 @@ const PriceStream<T> &AlgoStream<T>::getPriceStream() const {
 BondAlgoStreamingService::BondAlgoStreamingService() {}
 
 void BondAlgoStreamingService::PublishPrice(Price<Bond> &newPrice) {
-  auto bond = BondProductService::GetInstance()->GetData(newPrice.GetProduct().GetProductId());
+  const Bond &bond = newPrice.GetProduct();
 
   PriceStreamOrder bidOrder(newPrice.GetMid() - newPrice.GetBidOfferSpread() / 2,
                             vis_volumes[cur_ptr],
@@ -77,14 +79,13 @@ void BondAlgoStreamingService::PublishPrice(Price<Bond> &newPrice) {
   AlgoStream<Bond> algoStream(priceStream);
 
   cur_ptr = (cur_ptr + 1) % vis_volumes.size();
-  dataStore.insert(std::make_pair(bond.GetProductId(), algoStream));
-  if (dataStore.find(bond.GetProductId()) == dataStore.end()) {
+  if (store.Store(productIndexOf(bond), algoStream).second) {
     for (auto listener : GetListeners()) {
-      listener->ProcessAdd(algoStream);
+      dispatchAdd(listener, algoStream);
     }
   } else {
     for (auto listener : GetListeners()) {
-      listener->ProcessUpdate(algoStream);
+      dispatchUpdate(listener, algoStream);
     }
   }
 }
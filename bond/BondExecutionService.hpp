@@ -5,6 +5,8 @@
 #include "../base/soa.hpp"
 #include "../base/products.hpp"
 #include "../base/executionservice.hpp"
+#include "StaticPipeline.hpp"
+#include "Trace.hpp"
 
 class BondExecutionService : public ExecutionService<Bond> {
  public:
@@ -15,9 +17,15 @@ class BondExecutionService : public ExecutionService<Bond> {
 
   // Execute an order and notify listeners.
   void ExecuteOrder(const ExecutionOrder<Bond> &order, Market market) override {
-    for (auto listener:GetListeners()) {
-      listener->ProcessAdd(const_cast<ExecutionOrder<Bond> &>(order));
-    }
+    NoListeners none;
+    ExecuteOrder(order, market, none);
+  }
+
+  // As ExecuteOrder(), also notifying the static listeners next.
+  template <typename Next>
+  void ExecuteOrder(const ExecutionOrder<Bond> &order, Market market, Next &next) {
+    Tracer::Instance().Stamp(order.GetTrace(), TraceHop::EXECUTION);
+    notifyAdd(GetListeners(), next, const_cast<ExecutionOrder<Bond> &>(order));
   }
 };
 
@@ -37,6 +45,13 @@ class BondAlgoExecutionServiceListener : public ServiceListener<AlgoExecution<Bo
 
   }
 
+  template <typename Next>
+  void ProcessAdd(AlgoExecution<Bond> &data, Next &next) {
+    listeningService->ExecuteOrder(data.getExecutionOrder(), Market::CME, next);
+  }
+  template <typename Next>
+  void ProcessUpdate(AlgoExecution<Bond> &data, Next &next) {}
+
  private:
   BondExecutionService *listeningService;
 
@@ -4,6 +4,7 @@
 #include "../base/products.hpp"
 #include "../base/inquiryservice.hpp"
 #include "IOFileConnector.hpp"
+#include "Logger.hpp"
 
 // ------------- Declaration: BondInquirySubscriber -------------
 
@@ -12,7 +13,7 @@ public:
   BondInquirySubscriber(const std::string &filePath, Service<std::string, Inquiry<Bond>> *connectedService);
 
 private:
-  void parse(std::string line) override;
+  void parse(std::string_view line, const FieldSpans &fields) override;
 };
 
 // ------------- Declaration: BondInquiryPublisher -------------
@@ -21,7 +22,7 @@ class BondInquiryPublisher : public OutputFileConnector<Inquiry<Bond>> {
 public:
   explicit BondInquiryPublisher(const std::string &filePath);
 
-  std::string toString(Inquiry<Bond> &data) override;
+  void format(Inquiry<Bond> &data, RecordWriter &record) override;
   void Publish(Inquiry<Bond> &data) override;
 };
 
@@ -60,29 +61,30 @@ BondInquirySubscriber::BondInquirySubscriber(const std::string &filePath,
                                              Service<std::string, Inquiry<Bond>> *connectedService)
     : InputFileConnector(filePath, connectedService) {}
 
-void BondInquirySubscriber::parse(std::string line) {
-  auto split = splitString(line, ',');
-  auto bond = BondProductService::GetInstance()->GetData(split[0]);
-  Inquiry<Bond> inquiry(split[1], bond, split[2] == "0" ? BUY : SELL, std::stol(split[3]), 0.0, InquiryState::RECEIVED);
+void BondInquirySubscriber::parse(std::string_view line, const FieldSpans &fields) {
+  if (fields.size() < 4) {
+    throw std::runtime_error("Malformed inquiry line: " + std::string(line));
+  }
+  const Bond &bond = BondProductService::GetInstance()->GetData(ProductKey::FromString(fields[0]));
+  Inquiry<Bond> inquiry(std::string(fields[1]), bond, fields[2] == "0" ? BUY : SELL, parseLong(fields[3]), 0.0,
+                        InquiryState::RECEIVED);
 
-  std::cout << "Parsed Inquiry: " << inquiry.GetInquiryId() << std::endl;
-  connectedService->OnMessage(inquiry);
+  LOG_DEBUG("Parsed Inquiry: ", inquiry.GetInquiryId());
+  dispatchMessage(connectedService, inquiry);
 }
 
 // ------------- Definition: BondInquiryPublisher -------------
 
 BondInquiryPublisher::BondInquiryPublisher(const std::string &filePath) : OutputFileConnector(filePath) {}
 
-std::string BondInquiryPublisher::toString(Inquiry<Bond> &data) {
-  std::ostringstream oss;
-  oss << boost::posix_time::microsec_clock::universal_time() << ","
-      << data.GetInquiryId() << "," << data.GetProduct().GetProductId() << ","
-      << data.GetSide() << "," << data.GetQuantity() << "," << data.GetPrice() << "," << data.GetState();
-  return oss.str();
+void BondInquiryPublisher::format(Inquiry<Bond> &data, RecordWriter &record) {
+  record.Timestamp()
+      .Field(data.GetInquiryId()).Field(data.GetProduct().GetProductId())
+      .Field(data.GetSide()).Field(data.GetQuantity()).Field(data.GetPrice()).Field(data.GetState());
 }
 
 void BondInquiryPublisher::Publish(Inquiry<Bond> &data) {
-  std::cout << "Publishing Inquiry to file: " << data.GetInquiryId() << std::endl;
+  LOG_DEBUG("Publishing Inquiry to file: ", data.GetInquiryId());
   OutputFileConnector::Publish(data);
 }
 
@@ -93,7 +95,7 @@ BondInquiryService::BondInquiryService() {
 }
 
 void BondInquiryService::OnMessage(Inquiry<Bond> &data) {
-  std::cout << "OnMessage: InquiryId=" << data.GetInquiryId() << ", State=" << data.GetState() << std::endl;
+  LOG_DEBUG("OnMessage: InquiryId=", data.GetInquiryId(), ", State=", data.GetState());
 
   dataStore.emplace(data.GetInquiryId(), data);
 
@@ -111,10 +113,10 @@ void BondInquiryService::SendQuote(const std::string &inquiryId, double price) {
   data.SetPrice(price);
   data.SetState(InquiryState::QUOTED);
 
-  std::cout << "Sending Quote for InquiryId: " << inquiryId << ", Price: " << price << std::endl;
+  LOG_DEBUG("Sending Quote for InquiryId: ", inquiryId, ", Price: ", price);
 
   for (auto listener : GetListeners()) {
-    listener->ProcessAdd(data);
+    dispatchAdd(listener, data);
   }
 }
 
@@ -124,7 +126,7 @@ void BondInquiryService::Subscribe(BondInquirySubscriber *subscriber) {
 
 void BondInquiryService::NotifyListeners(Inquiry<Bond> &data) {
   for (auto listener : GetListeners()) {
-    listener->ProcessUpdate(data);
+    dispatchUpdate(listener, data);
   }
 }
 
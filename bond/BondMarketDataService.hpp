@@ -5,61 +5,185 @@
 #include "../base/products.hpp"
 #include "../base/marketdataservice.hpp"
 #include "IOFileConnector.hpp"
+#include "Logger.hpp"
+#include "Trace.hpp"
+#include "DenseStore.hpp"
+#include "StaticPipeline.hpp"
 
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
+#include <optional>
 #include <sstream>
+#include <type_traits>
 
 // ------------- Declaration: BondMarketDataConnector -------------
 
-class BondMarketDataConnector : public InputFileConnector<std::string, OrderBook<Bond>> {
+class BondMarketDataConnector : public ChunkedInputFileConnector<std::string, OrderBook<Bond>> {
 public:
   BondMarketDataConnector(const std::string &filePath, Service<std::string, OrderBook<Bond>> *connectedService);
 
+  // Read on one thread, every line is decoded into the same recycled book.
+  // A line is either a whole book or, for incremental feeds, one level delta:
+  // "<product id>,<A|M|D>,<B|O>,<level>[,<price>,<quantity>]" adds, modifies or
+  // deletes the level (0 is the best) of the bid or offer side.
+  void parse(std::string_view line, const FieldSpans &fields) override;
+  OrderBook<Bond> decode(std::string_view line, const FieldSpans &fields) override;
+
 private:
-  void parse(std::string line) override;
+  static bool isDelta(const FieldSpans &fields);
+  void readLine(const FieldSpans &fields, const Bond &bond, OrderBook<Bond> &orderBook) const;
+  void readDelta(const FieldSpans &fields, const Bond &bond, OrderBook<Bond> &orderBook) const;
+  void addLevels(const FieldSpans &fields, OrderBook<Bond> &orderBook) const;
+  OrderBook<Bond> &recycledBook(const Bond &bond);
+  void deliver(OrderBook<Bond> &book) override;
+  void beginBinary(const BinaryFileHeader &header, const std::vector<std::string_view> &productIds) override;
+  void parseBinary(const char *record) override;
+
+  std::vector<const Bond *> binaryProducts;
+  std::optional<OrderBook<Bond>> book;
 };
 
 // ------------- Declaration: BondMarketDataService -------------
 
+// Books are stored, recycled and handed between threads as flat copies.
+static_assert(std::is_trivially_copyable<OrderBook<Bond>>::value, "OrderBook<Bond> must be copyable with memcpy");
+
 class BondMarketDataService : public MarketDataService<Bond> {
 public:
   BondMarketDataService();
 
-  const BidOffer &GetBestBidOffer(const std::string &productId) override;
-  const OrderBook<Bond> &AggregateDepth(const std::string &productId) override;
+  OrderBook<Bond> &GetData(std::string productId) override;
+  BidOffer GetBestBidOffer(const std::string &productId) override;
+  void AggregateDepth(const std::string &productId, OrderBook<Bond> &aggregate) override;
 
-  void Subscribe(BondMarketDataConnector *connector);
+  // Read the connector's file, decoding it on the given number of threads.
+  void Subscribe(BondMarketDataConnector *connector, std::size_t workers = 1);
   void OnMessage(OrderBook<Bond> &data) override;
+
+  // As OnMessage(), also notifying the static listeners next.
+  template <typename Next>
+  void OnMessage(OrderBook<Bond> &data, Next &next);
+
+  const DenseStore<OrderBook<Bond>> &GetBooks() const;
+
+  // Replace a product's book without notifying listeners, e.g. from a snapshot.
+  void RestoreBook(const OrderBook<Bond> &book);
+
+private:
+  DenseStore<OrderBook<Bond>> books;
 };
 
 // ------------- Definition: BondMarketDataConnector -------------
 
 BondMarketDataConnector::BondMarketDataConnector(const std::string &filePath,
                                                  Service<std::string, OrderBook<Bond>> *connectedService)
-    : InputFileConnector(filePath, connectedService) {}
+    : ChunkedInputFileConnector(filePath, connectedService) {}
 
-void BondMarketDataConnector::parse(std::string line) {
-  auto split = splitString(line, ',');
-  std::string id = split[0];
-  auto bond = BondProductService::GetInstance()->GetData(id);
-  std::vector<Order> bidStack;
-  std::vector<Order> offerStack;
+void BondMarketDataConnector::parse(std::string_view line, const FieldSpans &fields) {
+  const Bond &bond = BondProductService::GetInstance()->GetData(ProductKey::FromString(fields[0]));
+  OrderBook<Bond> &orderBook = recycledBook(bond);
+  readLine(fields, bond, orderBook);
+  deliver(orderBook);
+}
+
+OrderBook<Bond> BondMarketDataConnector::decode(std::string_view line, const FieldSpans &fields) {
+  const Bond &bond = BondProductService::GetInstance()->GetData(ProductKey::FromString(fields[0]));
+  OrderBook<Bond> decoded(bond);
+  readLine(fields, bond, decoded);
+  return decoded;
+}
+
+bool BondMarketDataConnector::isDelta(const FieldSpans &fields) {
+  // A whole book's second field is a price, never a single letter.
+  return fields.size() >= 2 && fields[1].size() == 1 && (fields[1][0] == 'A' || fields[1][0] == 'M' || fields[1][0] == 'D');
+}
 
-  for (int i = 1; i <= 5; ++i) {
-    Order bid(fractionalToDouble(split[2 * i - 1]), stol(split[2 * i]), PricingSide::BID);
-    Order offer(fractionalToDouble(split[9 + 2 * i]), stol(split[10 + 2 * i]), PricingSide::OFFER);
-    bidStack.push_back(bid);
-    offerStack.push_back(offer);
+void BondMarketDataConnector::readLine(const FieldSpans &fields, const Bond &bond, OrderBook<Bond> &orderBook) const {
+  if (isDelta(fields)) {
+    readDelta(fields, bond, orderBook);
+  } else {
+    addLevels(fields, orderBook);
   }
+}
 
-  auto book = OrderBook<Bond>(bond, bidStack, offerStack);
+void BondMarketDataConnector::readDelta(const FieldSpans &fields, const Bond &bond, OrderBook<Bond> &orderBook) const {
+  BookAction action = fields[1][0] == 'A' ? BookAction::ADD : fields[1][0] == 'M' ? BookAction::MODIFY : BookAction::DELETE;
+  if (fields.size() < (action == BookAction::DELETE ? 4u : 6u) || (fields[2] != "B" && fields[2] != "O")) {
+    throw std::runtime_error("Malformed order book delta for " + std::string(fields[0]));
+  }
+  PricingSide side = fields[2] == "B" ? PricingSide::BID : PricingSide::OFFER;
+  auto level = static_cast<std::size_t>(parseLong(fields[3]));
+  if (action == BookAction::DELETE) {
+    orderBook.SetDelta(bond, action, side, level, Ticks(), 0);
+  } else {
+    orderBook.SetDelta(bond, action, side, level, Ticks::FromFractional(fields[4]), parseLong(fields[5]));
+  }
+}
+
+void BondMarketDataConnector::addLevels(const FieldSpans &fields, OrderBook<Bond> &orderBook) const {
+  // A line holds the bid levels, then as many offer levels, each a price and a quantity.
+  std::size_t depth = (fields.size() - 1) / 4;
+  if (fields.size() != 1 + 4 * depth || depth == 0 || depth > OrderBook<Bond>::DEPTH) {
+    throw std::runtime_error("Malformed order book for " + std::string(fields[0]));
+  }
+  for (std::size_t i = 0; i < depth; ++i) {
+    orderBook.AddLevel(PricingSide::BID, Ticks::FromFractional(fields[1 + 2 * i]), parseLong(fields[2 + 2 * i]));
+  }
+  for (std::size_t i = 0; i < depth; ++i) {
+    std::size_t offer = 1 + 2 * depth + 2 * i;
+    orderBook.AddLevel(PricingSide::OFFER, Ticks::FromFractional(fields[offer]), parseLong(fields[offer + 1]));
+  }
+}
+
+OrderBook<Bond> &BondMarketDataConnector::recycledBook(const Bond &bond) {
+  if (book) {
+    book->Reset(bond);
+  } else {
+    book.emplace(bond);
+  }
+  return *book;
+}
+
+void BondMarketDataConnector::deliver(OrderBook<Bond> &book) {
+  // Traces begin here, on the delivering thread, so a book decoded ahead on a
+  // worker does not count its wait for delivery as pipeline time.
+  book.SetTrace(Tracer::Instance().Begin());
+  Order topBid = book.GetOrder(PricingSide::BID, 0);
+  Order topOffer = book.GetOrder(PricingSide::OFFER, 0);
 
   // Print parsed data for debugging
-  std::cout << "Parsed OrderBook: ProductId = " << bond.GetProductId() << std::endl;
-  std::cout << "Top Bid: Price = " << bidStack[0].GetPrice() << ", Quantity = " << bidStack[0].GetQuantity() << std::endl;
-  std::cout << "Top Offer: Price = " << offerStack[0].GetPrice() << ", Quantity = " << offerStack[0].GetQuantity() << std::endl;
+  LOG_DEBUG("Parsed OrderBook: ProductId = ", book.GetProduct().GetProductId());
+  LOG_DEBUG("Top Bid: Price = ", topBid.GetPrice(), ", Quantity = ", topBid.GetQuantity());
+  LOG_DEBUG("Top Offer: Price = ", topOffer.GetPrice(), ", Quantity = ", topOffer.GetQuantity());
+
+  dispatchMessage(connectedService, book);
+}
 
-  connectedService->OnMessage(book);
+void BondMarketDataConnector::beginBinary(const BinaryFileHeader &header,
+                                          const std::vector<std::string_view> &productIds) {
+  if (header.recordType != static_cast<std::uint32_t>(BinaryRecordType::ORDER_BOOK) ||
+      header.recordSize != sizeof(BinaryOrderBookRecord)) {
+    throw std::runtime_error("Binary input does not hold order books: " + GetFilePath());
+  }
+  binaryProducts.clear();
+  for (auto productId : productIds) {
+    binaryProducts.push_back(&BondProductService::GetInstance()->GetData(ProductKey::FromString(productId)));
+  }
+}
+
+void BondMarketDataConnector::parseBinary(const char *record) {
+  const auto &entry = *reinterpret_cast<const BinaryOrderBookRecord *>(record);
+  OrderBook<Bond> &orderBook = recycledBook(*binaryProducts.at(entry.productIndex));
+
+  for (std::size_t i = 0; i < std::min(BINARY_BOOK_DEPTH, OrderBook<Bond>::DEPTH); ++i) {
+    orderBook.AddLevel(PricingSide::BID, Ticks(entry.bidPrices[i]), entry.bidQuantities[i]);
+  }
+  for (std::size_t i = 0; i < std::min(BINARY_BOOK_DEPTH, OrderBook<Bond>::DEPTH); ++i) {
+    orderBook.AddLevel(PricingSide::OFFER, Ticks(entry.offerPrices[i]), entry.offerQuantities[i]);
+  }
+
+  deliver(orderBook);
 }
 
 // ------------- Definition: BondMarketDataService -------------
@@ -67,73 +191,115 @@ void BondMarketDataConnector::parse(std::string line) {
 BondMarketDataService::BondMarketDataService() {}
 
 void BondMarketDataService::OnMessage(OrderBook<Bond> &data) {
-  std::cout << "OnMessage: ProductId = " << data.GetProduct().GetProductId() << std::endl;
+  NoListeners none;
+  OnMessage(data, none);
+}
+
+template <typename Next>
+void BondMarketDataService::OnMessage(OrderBook<Bond> &data, Next &next) {
+  LOG_DEBUG("OnMessage: ProductId = ", data.GetProduct().GetProductId());
 
-  if (dataStore.find(data.GetProduct().GetProductId()) == dataStore.end()) {
-    dataStore.insert(std::make_pair(data.GetProduct().GetProductId(), data));
-    for (auto listener : GetListeners()) {
-      listener->ProcessAdd(data);
+  std::uint32_t productIndex = productIndexOf(data.GetProduct());
+  if (data.GetChange().action != BookAction::SNAPSHOT) {
+    // Deltas change the stored book in place; listeners get the whole book, its change saying which level moved.
+    // A delta with no book to apply to is dropped, so one bad line cannot stop the feed.
+    OrderBook<Bond> *book = books.Find(productIndex);
+    if (book == nullptr) {
+      LOG_WARN("Dropped order book delta before any snapshot for product: ", data.GetProduct().GetProductId());
+      return;
     }
-    std::cout << "Processed Add for ProductId = " << data.GetProduct().GetProductId() << std::endl;
+    book->Apply(data);
+    notifyUpdate(GetListeners(), next, *book);
+    LOG_DEBUG("Processed Delta for ProductId = ", data.GetProduct().GetProductId());
+    return;
+  }
+
+  if (books.Store(productIndex, data).second) {
+    notifyAdd(GetListeners(), next, data);
+    LOG_DEBUG("Processed Add for ProductId = ", data.GetProduct().GetProductId());
   } else {
-    dataStore.insert(std::make_pair(data.GetProduct().GetProductId(), data));
-    for (auto listener : GetListeners()) {
-      listener->ProcessUpdate(data);
-    }
-    std::cout << "Processed Update for ProductId = " << data.GetProduct().GetProductId() << std::endl;
+    notifyUpdate(GetListeners(), next, data);
+    LOG_DEBUG("Processed Update for ProductId = ", data.GetProduct().GetProductId());
   }
 }
 
-void BondMarketDataService::Subscribe(BondMarketDataConnector *connector) {
-  std::cout << "Subscribing BondMarketDataConnector..." << std::endl;
-  connector->read();
+OrderBook<Bond> &BondMarketDataService::GetData(std::string productId) {
+  OrderBook<Bond> *book = books.Find(productId);
+  if (book == nullptr) {
+    throw std::out_of_range("No order book for product: " + productId);
+  }
+  return *book;
 }
 
-const BidOffer &BondMarketDataService::GetBestBidOffer(const std::string &productId) {
-  if (dataStore.find(productId) != dataStore.end()) {
-    OrderBook<Bond> orderBook = dataStore.at(productId);
-    auto *bidOffer = new BidOffer(
-        Order(orderBook.GetBidStack()[0].GetPrice(), orderBook.GetBidStack()[0].GetQuantity(), PricingSide::BID),
-        Order(orderBook.GetOfferStack()[0].GetPrice(), orderBook.GetOfferStack()[0].GetQuantity(), PricingSide::OFFER));
-
-    // Debugging print
-    std::cout << "Best BidOffer for ProductId = " << productId << ": Bid = " << bidOffer->GetBidOrder().GetPrice()
-              << ", Offer = " << bidOffer->GetOfferOrder().GetPrice() << std::endl;
-
-    return *bidOffer;
+void BondMarketDataService::Subscribe(BondMarketDataConnector *connector, std::size_t workers) {
+  LOG_INFO("Subscribing BondMarketDataConnector...");
+  if (workers > 1) {
+    connector->readParallel(workers);
+  } else {
+    connector->read();
   }
-  throw std::runtime_error("Product not found");
 }
 
-const OrderBook<Bond> &BondMarketDataService::AggregateDepth(const std::string &productId) {
-  if (dataStore.find(productId) != dataStore.end()) {
-    OrderBook<Bond> orderBook = dataStore.at(productId);
-    double totalBidCost = 0.0;
-    long totalBidVolume = 0;
-    double totalOfferCost = 0.0;
-    long totalOfferVolume = 0;
-
-    for (int i = 0; i < 5; ++i) {
-      totalBidVolume += orderBook.GetBidStack()[i].GetQuantity();
-      totalBidCost += orderBook.GetBidStack()[i].GetQuantity() * orderBook.GetBidStack()[i].GetPrice();
-      totalOfferVolume += orderBook.GetOfferStack()[i].GetQuantity();
-      totalOfferCost += orderBook.GetOfferStack()[i].GetQuantity() * orderBook.GetOfferStack()[i].GetPrice();
-    }
+const DenseStore<OrderBook<Bond>> &BondMarketDataService::GetBooks() const {
+  return books;
+}
 
-    double averageBidPrice = totalBidCost / totalBidVolume;
-    double averageOfferPrice = totalOfferCost / totalOfferVolume;
+void BondMarketDataService::RestoreBook(const OrderBook<Bond> &book) {
+  books.Store(productIndexOf(book.GetProduct()), book);
+}
 
-    std::vector<Order> aggregatedBidStack({Order(averageBidPrice, totalBidVolume, PricingSide::BID)});
-    std::vector<Order> aggregatedOfferStack({Order(averageOfferPrice, totalOfferVolume, PricingSide::OFFER)});
-    auto *aggregateOrderBook =
-        new OrderBook<Bond>(orderBook.GetProduct(), aggregatedBidStack, aggregatedOfferStack);
+BidOffer BondMarketDataService::GetBestBidOffer(const std::string &productId) {
+  if (const OrderBook<Bond> *book = books.Find(productId)) {
+    const OrderBook<Bond> &orderBook = *book;
+    BidOffer bidOffer(orderBook.GetOrder(PricingSide::BID, 0), orderBook.GetOrder(PricingSide::OFFER, 0));
 
     // Debugging print
-    std::cout << "AggregateDepth for ProductId = " << productId << ": AvgBid = " << averageBidPrice
-              << ", AvgOffer = " << averageOfferPrice << std::endl;
+    LOG_DEBUG("Best BidOffer for ProductId = ", productId, ": Bid = ", bidOffer.GetBidOrder().GetPrice(),
+              ", Offer = ", bidOffer.GetOfferOrder().GetPrice());
 
-    return *aggregateOrderBook;
+    return bidOffer;
   }
   throw std::runtime_error("Product not found");
 }
+
+void BondMarketDataService::AggregateDepth(const std::string &productId, OrderBook<Bond> &aggregate) {
+  const OrderBook<Bond> *book = books.Find(productId);
+  if (book == nullptr) {
+    throw std::runtime_error("Product not found");
+  }
+  const OrderBook<Bond> &orderBook = *book;
+  const Ticks *bidPrices = orderBook.GetPrices(PricingSide::BID);
+  const long *bidQuantities = orderBook.GetQuantities(PricingSide::BID);
+  const Ticks *offerPrices = orderBook.GetPrices(PricingSide::OFFER);
+  const long *offerQuantities = orderBook.GetQuantities(PricingSide::OFFER);
+  // Costs are summed in ticks, exactly, over the whole fixed depth; empty levels are zero.
+  long totalBidVolume = 0;
+  std::int64_t totalBidCost = 0;
+  long totalOfferVolume = 0;
+  std::int64_t totalOfferCost = 0;
+  for (std::size_t i = 0; i < OrderBook<Bond>::DEPTH; ++i) {
+    totalBidVolume += bidQuantities[i];
+    totalBidCost += bidQuantities[i] * bidPrices[i].Count();
+    totalOfferVolume += offerQuantities[i];
+    totalOfferCost += offerQuantities[i] * offerPrices[i].Count();
+  }
+
+  // Volume-weighted averages are rounded to the nearest tick. Deletes can empty a
+  // side, which is then left empty in the aggregate too.
+  double averageBidPrice = 0;
+  double averageOfferPrice = 0;
+  aggregate.Reset(orderBook.GetProduct());
+  if (totalBidVolume > 0) {
+    averageBidPrice = static_cast<double>(totalBidCost) / Ticks::PER_POINT / totalBidVolume;
+    aggregate.AddOrder(Order(Ticks::FromDouble(averageBidPrice), totalBidVolume, PricingSide::BID));
+  }
+  if (totalOfferVolume > 0) {
+    averageOfferPrice = static_cast<double>(totalOfferCost) / Ticks::PER_POINT / totalOfferVolume;
+    aggregate.AddOrder(Order(Ticks::FromDouble(averageOfferPrice), totalOfferVolume, PricingSide::OFFER));
+  }
+
+  // Debugging print
+  LOG_DEBUG("AggregateDepth for ProductId = ", productId, ": AvgBid = ", averageBidPrice,
+            ", AvgOffer = ", averageOfferPrice);
+}
 #endif 
\ No newline at end of file
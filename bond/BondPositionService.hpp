@@ -4,6 +4,11 @@
 #include "../base/positionservice.hpp"
 #include "../base/products.hpp"
 #include "../base/soa.hpp"
+#include "HistoricalJournal.hpp"
+#include "Conflator.hpp"
+#include "DenseStore.hpp"
+#include "StaticPipeline.hpp"
+#include "Trace.hpp"
 
 #include <string>
 #include <map>
@@ -16,8 +21,22 @@ class BondPositionService : public PositionService<Bond> {
 public:
   BondPositionService();
 
+  Position<Bond> &GetData(std::string productId) override;
   void AddTrade(const Trade<Bond> &trade) override;
   void OnMessage(Position<Bond> &data) override;
+
+  // As AddTrade(), also notifying the static listeners next.
+  template <typename Next>
+  void AddTrade(const Trade<Bond> &trade, Next &next);
+
+  // Every position held, indexed by product.
+  const DenseStore<Position<Bond>> &GetPositions() const;
+
+  // Replace a product's position without notifying listeners, e.g. from a snapshot.
+  void RestorePosition(const Position<Bond> &position);
+
+private:
+  DenseStore<Position<Bond>> positions;
 };
 
 // ------------- Declaration: BondTradesServiceListener -------------
@@ -30,6 +49,11 @@ public:
   void ProcessRemove(Trade<Bond> &data) override;
   void ProcessUpdate(Trade<Bond> &data) override;
 
+  template <typename Next>
+  void ProcessAdd(Trade<Bond> &data, Next &next);
+  template <typename Next>
+  void ProcessUpdate(Trade<Bond> &data, Next &next);
+
 private:
   BondPositionService *listeningService;
 };
@@ -39,14 +63,14 @@ private:
 
 class BondPositionServiceListener : public ServiceListener<Position<Bond>> {
 public:
-  explicit BondPositionServiceListener(HistoricalDataService<Position<Bond>> *listeningService);
+  explicit BondPositionServiceListener(HistoricalDataService<Position<Bond>, ProductKey> *listeningService);
 
   void ProcessAdd(Position<Bond> &data) override;
   void ProcessRemove(Position<Bond> &data) override;
   void ProcessUpdate(Position<Bond> &data) override;
 
 private:
-  HistoricalDataService<Position<Bond>> *listeningService;
+  HistoricalDataService<Position<Bond>, ProductKey> *listeningService;
 };
 
 // ------------- Declaration: BondPositionConnector -------------
@@ -56,48 +80,78 @@ public:
   explicit BondPositionConnector(const std::string &filePath);
 
 private:
-  std::string toString(Position<Bond> &data) override;
+  void format(Position<Bond> &data, RecordWriter &record) override;
+};
+
+// ------------- Declaration: PositionJournalRecord -------------
+
+struct PositionJournalRecord {
+  std::int64_t aggregatePosition;
 };
 
 // ------------- Declaration: BondPositionHistoricalDataService -------------
 
-class BondPositionHistoricalDataService : public HistoricalDataService<Position<Bond>> {
+class BondPositionHistoricalDataService : public HistoricalDataService<Position<Bond>, ProductKey> {
 public:
-  BondPositionHistoricalDataService();
+  // With an enabled conflation policy only the latest value per key is written on each flush.
+  explicit BondPositionHistoricalDataService(PersistenceMode mode = PersistenceMode::TEXT,
+                                             ConflationPolicy conflation = ConflationPolicy());
+  ~BondPositionHistoricalDataService();
+
+  void PersistData(ProductKey persistKey, const Position<Bond> &data) override;
 
-  void PersistData(std::string persistKey, const Position<Bond> &data) override;
+  // Write out values held back by conflation.
+  void Flush();
+  ConflationStats GetConflationStats() const;
 
 private:
   void OnMessage(Position<Bond> &data) override;
-  BondPositionConnector *connector;
+  void write(ProductKey persistKey, const Position<Bond> &data);
+
+  std::unique_ptr<Conflator<Position<Bond>, ProductKey>> conflator;
+  std::unique_ptr<BondPositionConnector> connector;
+  std::unique_ptr<HistoricalJournalWriter<PositionJournalRecord>> journal;
 };
 
 // ------------- Definition: BondPositionService -------------
 
 BondPositionService::BondPositionService() {}
 
+Position<Bond> &BondPositionService::GetData(std::string productId) {
+  Position<Bond> *position = positions.Find(productId);
+  if (position == nullptr) {
+    throw std::out_of_range("No position for product: " + productId);
+  }
+  return *position;
+}
+
 void BondPositionService::AddTrade(const Trade<Bond> &trade) {
-  std::string productId = trade.GetProduct().GetProductId();
+  NoListeners none;
+  AddTrade(trade, none);
+}
 
-  if (dataStore.find(productId) == dataStore.end()) {
+template <typename Next>
+void BondPositionService::AddTrade(const Trade<Bond> &trade, Next &next) {
+  Tracer::Instance().Stamp(trade.GetTrace(), TraceHop::POSITION);
+  std::uint32_t productIndex = productIndexOf(trade.GetProduct());
+
+  if (positions.Find(productIndex) == nullptr) {
     // Create and add a new position
     Position<Bond> newPosition(trade.GetProduct());
     newPosition.UpdatePosition(trade);  // Initialize position with the trade
-    dataStore.insert(std::make_pair(productId, newPosition));
+    newPosition.SetTrace(trade.GetTrace());
+    auto &position = *positions.Store(productIndex, newPosition).first;
 
     // Notify listeners of the new position
-    for (auto listener : GetListeners()) {
-      listener->ProcessAdd(newPosition);
-    }
+    notifyAdd(GetListeners(), next, position);
   } else {
     // Update an existing position
-    auto &position = dataStore.at(productId);
+    auto &position = *positions.Find(productIndex);
     position.UpdatePosition(trade);
+    position.SetTrace(trade.GetTrace());
 
     // Notify listeners of the updated position
-    for (auto listener : GetListeners()) {
-      listener->ProcessUpdate(position);
-    }
+    notifyUpdate(GetListeners(), next, position);
   }
 }
 
@@ -105,6 +159,14 @@ void BondPositionService::OnMessage(Position<Bond> &data) {
   // No-op
 }
 
+const DenseStore<Position<Bond>> &BondPositionService::GetPositions() const {
+  return positions;
+}
+
+void BondPositionService::RestorePosition(const Position<Bond> &position) {
+  positions.Store(productIndexOf(position.GetProduct()), position);
+}
+
 // ------------- Definition: BondTradesServiceListener -------------
 
 BondTradesServiceListener::BondTradesServiceListener(BondPositionService *listeningService)
@@ -122,21 +184,29 @@ void BondTradesServiceListener::ProcessUpdate(Trade<Bond> &data) {
   // NO-OP: Trades are never updated in this project.
 }
 
+template <typename Next>
+void BondTradesServiceListener::ProcessAdd(Trade<Bond> &data, Next &next) {
+  listeningService->AddTrade(data, next);
+}
+
+template <typename Next>
+void BondTradesServiceListener::ProcessUpdate(Trade<Bond> &data, Next &next) {}
+
 
 // ------------- Definition: BondPositionServiceListener -------------
 
 BondPositionServiceListener::BondPositionServiceListener(
-    HistoricalDataService<Position<Bond>> *listeningService)
+    HistoricalDataService<Position<Bond>, ProductKey> *listeningService)
     : listeningService(listeningService) {}
 
 void BondPositionServiceListener::ProcessAdd(Position<Bond> &data) {
-  listeningService->PersistData(data.GetProduct().GetProductId(), data);
+  listeningService->PersistData(data.GetProduct().GetProductKey(), data);
 }
 
 void BondPositionServiceListener::ProcessRemove(Position<Bond> &data) {}
 
 void BondPositionServiceListener::ProcessUpdate(Position<Bond> &data) {
-  listeningService->PersistData(data.GetProduct().GetProductId(), data);
+  listeningService->PersistData(data.GetProduct().GetProductKey(), data);
 }
 
 // ------------- Definition: BondPositionConnector -------------
@@ -144,22 +214,62 @@ void BondPositionServiceListener::ProcessUpdate(Position<Bond> &data) {
 BondPositionConnector::BondPositionConnector(const std::string &filePath)
     : OutputFileConnector(filePath) {}
 
-std::string BondPositionConnector::toString(Position<Bond> &data) {
-  std::ostringstream oss;
-  oss << boost::posix_time::microsec_clock::universal_time() << ","
-      << data.GetProduct().GetProductId() << ","
-      << data.GetAggregatePosition();
-  return oss.str();
+void BondPositionConnector::format(Position<Bond> &data, RecordWriter &record) {
+  record.Timestamp()
+      .Field(data.GetProduct().GetProductId())
+      .Field(data.GetAggregatePosition());
 }
 
 // ------------- Definition: BondPositionHistoricalDataService -------------
 
-BondPositionHistoricalDataService::BondPositionHistoricalDataService() {
-  connector = new BondPositionConnector("output/positions.txt");
+BondPositionHistoricalDataService::BondPositionHistoricalDataService(PersistenceMode mode,
+                                                                     ConflationPolicy conflation) {
+  if (mode != PersistenceMode::JOURNAL) {
+    connector = std::make_unique<BondPositionConnector>("output/positions.txt");
+  }
+  if (mode != PersistenceMode::TEXT) {
+    journal = std::make_unique<HistoricalJournalWriter<PositionJournalRecord>>("output/positions.journal");
+  }
+  if (conflation.Enabled()) {
+    conflator = std::make_unique<Conflator<Position<Bond>, ProductKey>>(
+        conflation, [this](const ProductKey &key, const Position<Bond> &value) { write(key, value); });
+  }
+}
+
+BondPositionHistoricalDataService::~BondPositionHistoricalDataService() {
+  try {
+    Flush();
+  } catch (...) {
+    // Destructors must not throw; call Flush() directly to see write errors.
+  }
+}
+
+void BondPositionHistoricalDataService::PersistData(ProductKey persistKey, const Position<Bond> &data) {
+  if (conflator) {
+    conflator->Update(persistKey, data);
+  } else {
+    write(persistKey, data);
+  }
+}
+
+void BondPositionHistoricalDataService::Flush() {
+  if (conflator) {
+    conflator->Flush();
+  }
+}
+
+ConflationStats BondPositionHistoricalDataService::GetConflationStats() const {
+  return conflator ? conflator->GetStats() : ConflationStats();
 }
 
-void BondPositionHistoricalDataService::PersistData(std::string persistKey, const Position<Bond> &data) {
-  connector->Publish(const_cast<Position<Bond> &>(data));
+void BondPositionHistoricalDataService::write(ProductKey persistKey, const Position<Bond> &data) {
+  auto &position = const_cast<Position<Bond> &>(data);
+  if (connector) {
+    connector->Publish(position);
+  }
+  if (journal) {
+    journal->Append(persistKey, PositionJournalRecord{position.GetAggregatePosition()});
+  }
 }
 
 void BondPositionHistoricalDataService::OnMessage(Position<Bond> &data) {}
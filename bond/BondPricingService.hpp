@@ -5,6 +5,8 @@
 #include "../base/products.hpp"
 #include "../base/pricingservice.hpp"
 #include "IOFileConnector.hpp"
+#include "Logger.hpp"
+#include "DenseStore.hpp"
 
 #include <string>
 #include <sstream>
@@ -14,12 +16,18 @@
 
 // ------------- Declaration: BondPricesConnector -------------
 
-class BondPricesConnector : public InputFileConnector<std::string, Price<Bond>> {
+class BondPricesConnector : public ChunkedInputFileConnector<std::string, Price<Bond>> {
 public:
   BondPricesConnector(const std::string &filePath, Service<std::string, Price<Bond>> *connectedService);
 
+  Price<Bond> decode(std::string_view line, const FieldSpans &fields) override;
+
 private:
-  void parse(std::string line) override;
+  void deliver(Price<Bond> &price) override;
+  void beginBinary(const BinaryFileHeader &header, const std::vector<std::string_view> &productIds) override;
+  void parseBinary(const char *record) override;
+
+  std::vector<const Bond *> binaryProducts;
 };
 
 // ------------- Declaration: BondPricingService -------------
@@ -28,29 +36,56 @@ class BondPricingService : public PricingService<Bond> {
 public:
   BondPricingService();
 
-  void Subscribe(BondPricesConnector *connector);
+  Price<Bond> &GetData(std::string productId) override;
+
+  // Read the connector's file, decoding it on the given number of threads.
+  void Subscribe(BondPricesConnector *connector, std::size_t workers = 1);
   void OnMessage(Price<Bond> &data) override;
+
+private:
+  DenseStore<Price<Bond>> prices;
 };
 
 // ------------- Definition: BondPricesConnector -------------
 
 BondPricesConnector::BondPricesConnector(const std::string &filePath, Service<std::string, Price<Bond>> *connectedService)
-    : InputFileConnector(filePath, connectedService) {}
+    : ChunkedInputFileConnector(filePath, connectedService) {}
 
-void BondPricesConnector::parse(std::string line) {
-  auto split = splitString(line, ',');
-  std::string id = split[0];
-  double mid = fractionalToDouble(split[1]);
-  double bidOfferSpread = fractionalToDouble(split[2]);
+Price<Bond> BondPricesConnector::decode(std::string_view line, const FieldSpans &fields) {
+  if (fields.size() < 3) {
+    throw std::runtime_error("Malformed price line: " + std::string(line));
+  }
+  Ticks mid = Ticks::FromFractional(fields[1]);
+  Ticks bidOfferSpread = Ticks::FromFractional(fields[2]);
 
-  auto bond = BondProductService::GetInstance()->GetData(id);
-  auto price = Price<Bond>(bond, mid, bidOfferSpread);
+  const Bond &bond = BondProductService::GetInstance()->GetData(ProductKey::FromString(fields[0]));
+  return Price<Bond>(bond, mid, bidOfferSpread);
+}
 
+void BondPricesConnector::deliver(Price<Bond> &price) {
   // Debugging Output
-  std::cout << "Parsed Price: ProductId = " << bond.GetProductId()
-            << ", Mid = " << mid << ", Spread = " << bidOfferSpread << std::endl;
+  LOG_DEBUG("Parsed Price: ProductId = ", price.GetProduct().GetProductId(),
+            ", Mid = ", price.GetMid(), ", Spread = ", price.GetBidOfferSpread());
+
+  dispatchMessage(connectedService, price);
+}
+
+void BondPricesConnector::beginBinary(const BinaryFileHeader &header,
+                                      const std::vector<std::string_view> &productIds) {
+  if (header.recordType != static_cast<std::uint32_t>(BinaryRecordType::PRICE) ||
+      header.recordSize != sizeof(BinaryPriceRecord)) {
+    throw std::runtime_error("Binary input does not hold prices: " + GetFilePath());
+  }
+  binaryProducts.clear();
+  for (auto productId : productIds) {
+    binaryProducts.push_back(&BondProductService::GetInstance()->GetData(ProductKey::FromString(productId)));
+  }
+}
 
-  connectedService->OnMessage(price);
+void BondPricesConnector::parseBinary(const char *record) {
+  const auto &entry = *reinterpret_cast<const BinaryPriceRecord *>(record);
+  Price<Bond> price(*binaryProducts.at(entry.productIndex), Ticks(entry.mid), Ticks(entry.bidOfferSpread));
+  deliver(price);
 }
 
 // ------------- Definition: BondPricingService -------------
@@ -58,37 +93,43 @@ void BondPricesConnector::parse(std::string line) {
 BondPricingService::BondPricingService() {}
 
 void BondPricingService::OnMessage(Price<Bond> &data) {
-  std::string productId = data.GetProduct().GetProductId();
-
-  if (dataStore.find(productId) == dataStore.end()) {
-    // Add new price to data store
-    dataStore.insert(std::make_pair(productId, data));
+  const std::string &productId = data.GetProduct().GetProductId();
 
+  if (prices.Store(productIndexOf(data.GetProduct()), data).second) {
     // Notify listeners about the new price
     for (auto listener : this->GetListeners()) {
-      listener->ProcessAdd(data);
+      dispatchAdd(listener, data);
     }
 
     // Debugging Output
-    std::cout << "Added Price: ProductId = " << productId
-              << ", Mid = " << data.GetMid() << ", Spread = " << data.GetBidOfferSpread() << std::endl;
+    LOG_DEBUG("Added Price: ProductId = ", productId, ", Mid = ", data.GetMid(),
+              ", Spread = ", data.GetBidOfferSpread());
   } else {
-    // Update existing price in data store
-    dataStore.insert(std::make_pair(productId, data));
-
     // Notify listeners about the updated price
     for (auto listener : this->GetListeners()) {
-      listener->ProcessUpdate(data);
+      dispatchUpdate(listener, data);
     }
 
     // Debugging Output
-    std::cout << "Updated Price: ProductId = " << productId
-              << ", Mid = " << data.GetMid() << ", Spread = " << data.GetBidOfferSpread() << std::endl;
+    LOG_DEBUG("Updated Price: ProductId = ", productId, ", Mid = ", data.GetMid(),
+              ", Spread = ", data.GetBidOfferSpread());
   }
 }
 
-void BondPricingService::Subscribe(BondPricesConnector *connector) {
-  std::cout << "Subscribing BondPricesConnector..." << std::endl;
-  connector->read();
+Price<Bond> &BondPricingService::GetData(std::string productId) {
+  Price<Bond> *price = prices.Find(productId);
+  if (price == nullptr) {
+    throw std::out_of_range("No price for product: " + productId);
+  }
+  return *price;
+}
+
+void BondPricingService::Subscribe(BondPricesConnector *connector, std::size_t workers) {
+  LOG_INFO("Subscribing BondPricesConnector...");
+  if (workers > 1) {
+    connector->readParallel(workers);
+  } else {
+    connector->read();
+  }
 }
 #endif
\ No newline at end of file
@@ -2,7 +2,10 @@
 #define BOND_PRODUCT_SERVICE_HPP
 
 
+#include <cstdint>
+#include <deque>
 #include <map>
+#include <stdexcept>
 #include "../base/products.hpp"
 #include "../base/soa.hpp"
 
@@ -14,11 +17,21 @@ class BondProductService : public Service<string, Bond> {
   static BondProductService *GetInstance();
 
   Bond &GetData(string productId) override;
+  Bond &GetData(ProductKey productKey);
   void Add(Bond& bond);
   void OnMessage(Bond &data) override;
 
+  // Dense index given to the product when it was added, from 0 to Size() - 1,
+  // or NO_PRODUCT_INDEX for an unknown product.
+  uint32_t GetProductIndex(ProductKey productKey) const;
+  uint32_t GetProductIndex(const string &productId) const;
+  Bond &GetProduct(uint32_t productIndex);
+  size_t Size() const;
+
  private:
-  unordered_map<string, Bond> bondMapper; 
+  // A deque keeps references to registered bonds valid as more are added.
+  deque<Bond> bonds;
+  unordered_map<ProductKey, uint32_t> productIndex;
   static BondProductService *instance;  
 
   BondProductService();
@@ -28,18 +41,53 @@ class BondProductService : public Service<string, Bond> {
 
 BondProductService *BondProductService::instance = nullptr;
 
-BondProductService::BondProductService() {
-  bondMapper = unordered_map<string, Bond>();
-}
+BondProductService::BondProductService() {}
 
 void BondProductService::OnMessage(Bond &data) {}
 
 Bond &BondProductService::GetData(string productId) {
-  return bondMapper[productId];
+  uint32_t index = GetProductIndex(productId);
+  if (index == NO_PRODUCT_INDEX) {
+    throw std::runtime_error("Product not found: " + productId);
+  }
+  return bonds[index];
+}
+
+Bond &BondProductService::GetData(ProductKey productKey) {
+  // Lookup only, so connectors may resolve products from several threads at once.
+  auto found = productIndex.find(productKey);
+  if (found == productIndex.end()) {
+    throw std::runtime_error("Product not found: " + productKey.ToString());
+  }
+  return bonds[found->second];
 }
 
 void BondProductService::Add(Bond& bond) {
-  bondMapper.insert(make_pair(bond.GetProductId(), bond));
+  if (productIndex.find(bond.GetProductKey()) != productIndex.end()) {
+    return;
+  }
+  auto index = static_cast<uint32_t>(bonds.size());
+  bond.SetProductIndex(index);
+  bonds.push_back(bond);
+  productIndex.emplace(bond.GetProductKey(), index);
+}
+
+uint32_t BondProductService::GetProductIndex(ProductKey productKey) const {
+  auto found = productIndex.find(productKey);
+  return found == productIndex.end() ? NO_PRODUCT_INDEX : found->second;
+}
+
+uint32_t BondProductService::GetProductIndex(const string &productId) const {
+  ProductKey productKey;
+  return ProductKey::TryParse(productId, productKey) ? GetProductIndex(productKey) : NO_PRODUCT_INDEX;
+}
+
+Bond &BondProductService::GetProduct(uint32_t productIndex) {
+  return bonds.at(productIndex);
+}
+
+size_t BondProductService::Size() const {
+  return bonds.size();
 }
 
 BondProductService *BondProductService::GetInstance() {
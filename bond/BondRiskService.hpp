@@ -5,6 +5,12 @@
 #include "../base/products.hpp"
 #include "../base/streamingservice.hpp"
 #include "../base/riskservice.hpp"
+#include "HistoricalJournal.hpp"
+#include "Logger.hpp"
+#include "Trace.hpp"
+#include "Conflator.hpp"
+#include "DenseStore.hpp"
+#include "StaticPipeline.hpp"
 
 // ------------- Declaration: BondRiskService -------------
 
@@ -12,9 +18,23 @@ class BondRiskService : public RiskService<Bond> {
 public:
   BondRiskService();
 
+  PV01<Bond> &GetData(std::string productId) override;
   void OnMessage(PV01<Bond> &data) override;
   void AddPosition(Position<Bond> &position) override;
-  const PV01<BucketedSector<Bond>> &GetBucketedRisk(const BucketedSector<Bond> &sector) const override;
+  void GetBucketedRisk(const BucketedSector<Bond> &sector, PV01<BucketedSector<Bond>> &risk) const override;
+
+  // As AddPosition(), also notifying the static listeners next.
+  template <typename Next>
+  void AddPosition(Position<Bond> &position, Next &next);
+
+  // Every PV01 held, indexed by product.
+  const DenseStore<PV01<Bond>> &GetRisks() const;
+
+  // Replace a product's PV01 without notifying listeners, e.g. from a snapshot.
+  void RestoreRisk(const PV01<Bond> &risk);
+
+private:
+  DenseStore<PV01<Bond>> risks;
 };
 
 // ------------- Declaration: BondPositionRiskServiceListener -------------
@@ -27,6 +47,11 @@ public:
   void ProcessRemove(Position<Bond> &data) override;
   void ProcessUpdate(Position<Bond> &data) override;
 
+  template <typename Next>
+  void ProcessAdd(Position<Bond> &data, Next &next);
+  template <typename Next>
+  void ProcessUpdate(Position<Bond> &data, Next &next);
+
 private:
   BondRiskService *listeningService;
 };
@@ -35,14 +60,14 @@ private:
 
 class BondRiskServiceListener : public ServiceListener<PV01<Bond>> {
 public:
-  explicit BondRiskServiceListener(HistoricalDataService<PV01<Bond>> *listeningService);
+  explicit BondRiskServiceListener(HistoricalDataService<PV01<Bond>, ProductKey> *listeningService);
 
   void ProcessAdd(PV01<Bond> &data) override;
   void ProcessRemove(PV01<Bond> &data) override;
   void ProcessUpdate(PV01<Bond> &data) override;
 
 private:
-  HistoricalDataService<PV01<Bond>> *listeningService;
+  HistoricalDataService<PV01<Bond>, ProductKey> *listeningService;
 };
 
 // ------------- Declaration: BondRiskConnector -------------
@@ -52,69 +77,104 @@ public:
   explicit BondRiskConnector(const std::string &filePath);
 
 private:
-  std::string toString(PV01<Bond> &data) override;
+  void format(PV01<Bond> &data, RecordWriter &record) override;
+};
+
+// ------------- Declaration: RiskJournalRecord -------------
+
+struct RiskJournalRecord {
+  std::int64_t quantity;
+  double pv01;
 };
 
 // ------------- Declaration: BondRiskHistoricalDataService -------------
 
-class BondRiskHistoricalDataService : public HistoricalDataService<PV01<Bond>> {
+class BondRiskHistoricalDataService : public HistoricalDataService<PV01<Bond>, ProductKey> {
 public:
-  BondRiskHistoricalDataService();
+  // With an enabled conflation policy only the latest value per key is written on each flush.
+  explicit BondRiskHistoricalDataService(PersistenceMode mode = PersistenceMode::TEXT,
+                                         ConflationPolicy conflation = ConflationPolicy());
+  ~BondRiskHistoricalDataService();
 
-  void PersistData(std::string persistKey, const PV01<Bond> &data) override;
+  void PersistData(ProductKey persistKey, const PV01<Bond> &data) override;
+
+  // Write out values held back by conflation.
+  void Flush();
+  ConflationStats GetConflationStats() const;
 
 private:
   void OnMessage(PV01<Bond> &data) override;
-  BondRiskConnector *connector;
+  void write(ProductKey persistKey, const PV01<Bond> &data);
+
+  std::unique_ptr<Conflator<PV01<Bond>, ProductKey>> conflator;
+  std::unique_ptr<BondRiskConnector> connector;
+  std::unique_ptr<HistoricalJournalWriter<RiskJournalRecord>> journal;
 };
 
 // ------------- Definition: BondRiskService -------------
 
 BondRiskService::BondRiskService() {}
 
+PV01<Bond> &BondRiskService::GetData(std::string productId) {
+  PV01<Bond> *risk = risks.Find(productId);
+  if (risk == nullptr) {
+    throw std::out_of_range("No risk for product: " + productId);
+  }
+  return *risk;
+}
+
 void BondRiskService::OnMessage(PV01<Bond> &data) {
   // No-op: Streaming service does not have a connector.
 }
 
 void BondRiskService::AddPosition(Position<Bond> &position) {
-  auto product = position.GetProduct();
+  NoListeners none;
+  AddPosition(position, none);
+}
+
+template <typename Next>
+void BondRiskService::AddPosition(Position<Bond> &position, Next &next) {
+  Tracer::Instance().Stamp(position.GetTrace(), TraceHop::RISK);
+  const Bond &product = position.GetProduct();
 
   // Calculate risk for the position
   PV01<Bond> risk(product, position.GetAggregatePosition() * product.GetPV01(), position.GetAggregatePosition());
+  risk.SetTrace(position.GetTrace());
 
-  if (dataStore.find(position.GetProduct().GetProductId()) == dataStore.end()) {
-    // Insert new risk data and notify listeners
-    dataStore.insert(std::make_pair(position.GetProduct().GetProductId(), risk));
-    for (auto listener : this->GetListeners()) {
-      listener->ProcessAdd(risk);
-    }
+  if (risks.Store(productIndexOf(product), risk).second) {
+    // Notify listeners of the new risk
+    notifyAdd(GetListeners(), next, risk);
   } else {
-    // Update existing risk data and notify listeners
-    dataStore.insert(std::make_pair(position.GetProduct().GetProductId(), risk));
-    for (auto listener : this->GetListeners()) {
-      listener->ProcessUpdate(risk);
-    }
+    // Notify listeners of the updated risk
+    notifyUpdate(GetListeners(), next, risk);
   }
+  Tracer::Instance().Stamp(risk.GetTrace(), TraceHop::RISK_PUBLISHED);
+}
+
+const DenseStore<PV01<Bond>> &BondRiskService::GetRisks() const {
+  return risks;
+}
+
+void BondRiskService::RestoreRisk(const PV01<Bond> &risk) {
+  risks.Store(productIndexOf(risk.GetProduct()), risk);
 }
 
-const PV01<BucketedSector<Bond>> &BondRiskService::GetBucketedRisk(const BucketedSector<Bond> &sector) const {
+void BondRiskService::GetBucketedRisk(const BucketedSector<Bond> &sector, PV01<BucketedSector<Bond>> &risk) const {
   double totalPV01 = 0.0;
   long totalPosition = 0;
 
   for (const auto &product : sector.GetProducts()) {
-    if (dataStore.find(product.GetProductId()) != dataStore.end()) {
-      totalPV01 += dataStore.at(product.GetProductId()).GetPV01();
-      totalPosition += dataStore.at(product.GetProductId()).GetQuantity();
+    if (const PV01<Bond> *risk = risks.Find(product.GetProductId())) {
+      totalPV01 += risk->GetPV01();
+      totalPosition += risk->GetQuantity();
     }
   }
 
-  auto pv01 = new PV01<BucketedSector<Bond>>(sector, totalPV01, totalPosition);
+  risk.Assign(sector, totalPV01, totalPosition);
 
   // Debugging Output
-  std::cout << "BucketedRisk: Sector = " << sector.GetName() << ", TotalPV01 = " << totalPV01
-            << ", TotalQuantity = " << totalPosition << std::endl;
-
-  return *pv01;
+  LOG_DEBUG("BucketedRisk: Sector = ", sector.GetName(), ", TotalPV01 = ", totalPV01,
+            ", TotalQuantity = ", totalPosition);
 }
 
 // ------------- Definition: BondPositionRiskServiceListener -------------
@@ -135,15 +195,25 @@ void BondPositionRiskServiceListener::ProcessUpdate(Position<Bond> &data) {
   listeningService->AddPosition(data);
 }
 
+template <typename Next>
+void BondPositionRiskServiceListener::ProcessAdd(Position<Bond> &data, Next &next) {
+  listeningService->AddPosition(data, next);
+}
+
+template <typename Next>
+void BondPositionRiskServiceListener::ProcessUpdate(Position<Bond> &data, Next &next) {
+  listeningService->AddPosition(data, next);
+}
+
 
 // ------------- Definition: BondRiskServiceListener -------------
 
 BondRiskServiceListener::BondRiskServiceListener(
-    HistoricalDataService<PV01<Bond>> *listeningService)
+    HistoricalDataService<PV01<Bond>, ProductKey> *listeningService)
     : listeningService(listeningService) {}
 
 void BondRiskServiceListener::ProcessAdd(PV01<Bond> &data) {
-  listeningService->PersistData(data.GetProduct().GetProductId(), data);
+  listeningService->PersistData(data.GetProduct().GetProductKey(), data);
 }
 
 void BondRiskServiceListener::ProcessRemove(PV01<Bond> &data) {
@@ -151,7 +221,7 @@ void BondRiskServiceListener::ProcessRemove(PV01<Bond> &data) {
 }
 
 void BondRiskServiceListener::ProcessUpdate(PV01<Bond> &data) {
-  listeningService->PersistData(data.GetProduct().GetProductId(), data);
+  listeningService->PersistData(data.GetProduct().GetProductKey(), data);
 }
 
 // ------------- Definition: BondRiskConnector -------------
@@ -159,23 +229,62 @@ void BondRiskServiceListener::ProcessUpdate(PV01<Bond> &data) {
 BondRiskConnector::BondRiskConnector(const std::string &filePath)
     : OutputFileConnector(filePath) {}
 
-std::string BondRiskConnector::toString(PV01<Bond> &data) {
-  std::ostringstream oss;
-  oss << boost::posix_time::microsec_clock::universal_time() << ","
-      << data.GetProduct().GetProductId() << ","
-      << data.GetQuantity() << ","
-      << data.GetPV01();
-  return oss.str();
+void BondRiskConnector::format(PV01<Bond> &data, RecordWriter &record) {
+  record.Timestamp()
+      .Field(data.GetProduct().GetProductId())
+      .Field(data.GetQuantity())
+      .Field(data.GetPV01());
 }
 
 // ------------- Definition: BondRiskHistoricalDataService -------------
 
-BondRiskHistoricalDataService::BondRiskHistoricalDataService() {
-  connector = new BondRiskConnector("output/risk.txt");
+BondRiskHistoricalDataService::BondRiskHistoricalDataService(PersistenceMode mode, ConflationPolicy conflation) {
+  if (mode != PersistenceMode::JOURNAL) {
+    connector = std::make_unique<BondRiskConnector>("output/risk.txt");
+  }
+  if (mode != PersistenceMode::TEXT) {
+    journal = std::make_unique<HistoricalJournalWriter<RiskJournalRecord>>("output/risk.journal");
+  }
+  if (conflation.Enabled()) {
+    conflator = std::make_unique<Conflator<PV01<Bond>, ProductKey>>(
+        conflation, [this](const ProductKey &key, const PV01<Bond> &value) { write(key, value); });
+  }
+}
+
+BondRiskHistoricalDataService::~BondRiskHistoricalDataService() {
+  try {
+    Flush();
+  } catch (...) {
+    // Destructors must not throw; call Flush() directly to see write errors.
+  }
+}
+
+void BondRiskHistoricalDataService::PersistData(ProductKey persistKey, const PV01<Bond> &data) {
+  if (conflator) {
+    conflator->Update(persistKey, data);
+  } else {
+    write(persistKey, data);
+  }
 }
 
-void BondRiskHistoricalDataService::PersistData(std::string persistKey, const PV01<Bond> &data) {
-  connector->Publish(const_cast<PV01<Bond> &>(data));
+void BondRiskHistoricalDataService::Flush() {
+  if (conflator) {
+    conflator->Flush();
+  }
+}
+
+ConflationStats BondRiskHistoricalDataService::GetConflationStats() const {
+  return conflator ? conflator->GetStats() : ConflationStats();
+}
+
+void BondRiskHistoricalDataService::write(ProductKey persistKey, const PV01<Bond> &data) {
+  auto &risk = const_cast<PV01<Bond> &>(data);
+  if (connector) {
+    connector->Publish(risk);
+  }
+  if (journal) {
+    journal->Append(persistKey, RiskJournalRecord{risk.GetQuantity(), risk.GetPV01()});
+  }
 }
 
 void BondRiskHistoricalDataService::OnMessage(PV01<Bond> &data) {
@@ -7,6 +7,10 @@
 #include "../base/streamingservice.hpp"
 #include "../base/historicaldataservice.hpp"
 #include "IOFileConnector.hpp"
+#include "Logger.hpp"
+#include "HistoricalJournal.hpp"
+#include "DenseStore.hpp"
+#include "Conflator.hpp"
 
 // ------------- Declaration: BondStreamingService -------------
 
@@ -14,8 +18,12 @@ class BondStreamingService : public StreamingService<Bond> {
 public:
   BondStreamingService();
 
+  PriceStream<Bond> &GetData(std::string productId) override;
   void OnMessage(PriceStream<Bond> &data) override;
   void PublishPrice(const PriceStream<Bond> &priceStream) override;
+
+private:
+  DenseStore<PriceStream<Bond>> streams;
 };
 
 // ------------- Declaration: BondAlgoStreamServiceListener -------------
@@ -39,73 +47,98 @@ public:
   explicit BondPriceStreamsConnector(const std::string &filePath);
 
 private:
-  std::string toString(PriceStream<Bond> &data) override;
+  void format(PriceStream<Bond> &data, RecordWriter &record) override;
 };
 
 // ------------- Declaration: BondPriceStreamsServiceListener -------------
 
 class BondPriceStreamsServiceListener : public ServiceListener<PriceStream<Bond>> {
 public:
-  explicit BondPriceStreamsServiceListener(HistoricalDataService<PriceStream<Bond>> *listeningService);
+  explicit BondPriceStreamsServiceListener(HistoricalDataService<PriceStream<Bond>, ProductKey> *listeningService);
 
   void ProcessAdd(PriceStream<Bond> &data) override;
   void ProcessRemove(PriceStream<Bond> &data) override;
   void ProcessUpdate(PriceStream<Bond> &data) override;
 
 private:
-  HistoricalDataService<PriceStream<Bond>> *listeningService;
+  HistoricalDataService<PriceStream<Bond>, ProductKey> *listeningService;
+};
+
+// ------------- Declaration: PriceStreamJournalRecord -------------
+
+// Prices are Ticks counts.
+struct PriceStreamJournalRecord {
+  std::int64_t bidPrice;
+  std::int64_t bidVisibleQuantity;
+  std::int64_t bidHiddenQuantity;
+  std::int64_t offerPrice;
+  std::int64_t offerVisibleQuantity;
+  std::int64_t offerHiddenQuantity;
 };
 
 // ------------- Declaration: BondPriceStreamsHistoricalDataService -------------
 
-class BondPriceStreamsHistoricalDataService : public HistoricalDataService<PriceStream<Bond>> {
+class BondPriceStreamsHistoricalDataService : public HistoricalDataService<PriceStream<Bond>, ProductKey> {
 public:
-  BondPriceStreamsHistoricalDataService();
+  // With an enabled conflation policy only the latest value per key is written on each flush.
+  explicit BondPriceStreamsHistoricalDataService(PersistenceMode mode = PersistenceMode::TEXT,
+                                                 ConflationPolicy conflation = ConflationPolicy());
+  ~BondPriceStreamsHistoricalDataService();
+
+  void PersistData(ProductKey persistKey, const PriceStream<Bond> &data) override;
 
-  void PersistData(std::string persistKey, const PriceStream<Bond> &data) override;
+  // Write out values held back by conflation.
+  void Flush();
+  ConflationStats GetConflationStats() const;
 
 private:
   void OnMessage(PriceStream<Bond> &data) override;
-  BondPriceStreamsConnector *connector;
+  void write(ProductKey persistKey, const PriceStream<Bond> &data);
+
+  std::unique_ptr<Conflator<PriceStream<Bond>, ProductKey>> conflator;
+  std::unique_ptr<BondPriceStreamsConnector> connector;
+  std::unique_ptr<HistoricalJournalWriter<PriceStreamJournalRecord>> journal;
 };
 
 // ------------- Definition: BondStreamingService -------------
 
 BondStreamingService::BondStreamingService() {}
 
+PriceStream<Bond> &BondStreamingService::GetData(std::string productId) {
+  PriceStream<Bond> *stream = streams.Find(productId);
+  if (stream == nullptr) {
+    throw std::out_of_range("No price stream for product: " + productId);
+  }
+  return *stream;
+}
+
 void BondStreamingService::OnMessage(PriceStream<Bond> &data) {
   // No-op
 }
 
 void BondStreamingService::PublishPrice(const PriceStream<Bond> &priceStream) {
-  std::string productId = priceStream.GetProduct().GetProductId();
-
-  if (dataStore.find(productId) == dataStore.end()) {
-    // Add new PriceStream to the data store
-    dataStore.insert(std::make_pair(productId, priceStream));
+  const std::string &productId = priceStream.GetProduct().GetProductId();
 
+  if (streams.Store(productIndexOf(priceStream.GetProduct()), priceStream).second) {
     // Notify listeners about the new PriceStream
     for (auto listener : this->GetListeners()) {
-      listener->ProcessAdd(const_cast<PriceStream<Bond> &>(priceStream));
+      dispatchAdd(listener, const_cast<PriceStream<Bond> &>(priceStream));
     }
 
     // Debugging Output
-    std::cout << "Added PriceStream: ProductId = " << productId
-              << ", Bid Price = " << priceStream.GetBidOrder().GetPrice()
-              << ", Offer Price = " << priceStream.GetOfferOrder().GetPrice() << std::endl;
+    LOG_DEBUG("Added PriceStream: ProductId = ", productId,
+              ", Bid Price = ", priceStream.GetBidOrder().GetPrice(),
+              ", Offer Price = ", priceStream.GetOfferOrder().GetPrice());
   } else {
-    // Update existing PriceStream in the data store
-    dataStore.insert(std::make_pair(productId, priceStream));
-
     // Notify listeners about the updated PriceStream
     for (auto listener : this->GetListeners()) {
-      listener->ProcessUpdate(const_cast<PriceStream<Bond> &>(priceStream));
+      dispatchUpdate(listener, const_cast<PriceStream<Bond> &>(priceStream));
     }
 
     // Debugging Output
-    std::cout << "Updated PriceStream: ProductId = " << productId
-              << ", Bid Price = " << priceStream.GetBidOrder().GetPrice()
-              << ", Offer Price = " << priceStream.GetOfferOrder().GetPrice() << std::endl;
+    LOG_DEBUG("Updated PriceStream: ProductId = ", productId,
+              ", Bid Price = ", priceStream.GetBidOrder().GetPrice(),
+              ", Offer Price = ", priceStream.GetOfferOrder().GetPrice());
   }
 }
 
@@ -131,41 +164,83 @@ void BondAlgoStreamServiceListener::ProcessUpdate(AlgoStream<Bond> &data) {
 BondPriceStreamsConnector::BondPriceStreamsConnector(const std::string &filePath)
     : OutputFileConnector(filePath) {}
 
-std::string BondPriceStreamsConnector::toString(PriceStream<Bond> &data) {
-  std::ostringstream oss;
-  oss << boost::posix_time::microsec_clock::universal_time() << ","
-      << data.GetProduct().GetProductId() << "," << data.GetBidOrder().GetPrice() << ","
-      << data.GetBidOrder().GetVisibleQuantity() << "," << data.GetBidOrder().GetHiddenQuantity() << ","
-      << data.GetOfferOrder().GetPrice() << "," << data.GetOfferOrder().GetVisibleQuantity() << ","
-      << data.GetOfferOrder().GetHiddenQuantity();
-  return oss.str();
+void BondPriceStreamsConnector::format(PriceStream<Bond> &data, RecordWriter &record) {
+  record.Timestamp()
+      .Field(data.GetProduct().GetProductId()).Field(data.GetBidOrder().GetPrice())
+      .Field(data.GetBidOrder().GetVisibleQuantity()).Field(data.GetBidOrder().GetHiddenQuantity())
+      .Field(data.GetOfferOrder().GetPrice()).Field(data.GetOfferOrder().GetVisibleQuantity())
+      .Field(data.GetOfferOrder().GetHiddenQuantity());
 }
 
 // ------------- Definition: BondPriceStreamsServiceListener -------------
 
 BondPriceStreamsServiceListener::BondPriceStreamsServiceListener(
-    HistoricalDataService<PriceStream<Bond>> *listeningService)
+    HistoricalDataService<PriceStream<Bond>, ProductKey> *listeningService)
     : listeningService(listeningService) {}
 
 void BondPriceStreamsServiceListener::ProcessAdd(PriceStream<Bond> &data) {
-  listeningService->PersistData(data.GetProduct().GetProductId(), data);
+  listeningService->PersistData(data.GetProduct().GetProductKey(), data);
 }
 
 void BondPriceStreamsServiceListener::ProcessRemove(PriceStream<Bond> &data) {}
 
 void BondPriceStreamsServiceListener::ProcessUpdate(PriceStream<Bond> &data) {
-  listeningService->PersistData(data.GetProduct().GetProductId(), data);
+  listeningService->PersistData(data.GetProduct().GetProductKey(), data);
 }
 
 // ------------- Definition: BondPriceStreamsHistoricalDataService -------------
 
-BondPriceStreamsHistoricalDataService::BondPriceStreamsHistoricalDataService() {
-  connector = new BondPriceStreamsConnector("output/streaming.txt");
+BondPriceStreamsHistoricalDataService::BondPriceStreamsHistoricalDataService(PersistenceMode mode,
+                                                                             ConflationPolicy conflation) {
+  if (mode != PersistenceMode::JOURNAL) {
+    connector = std::make_unique<BondPriceStreamsConnector>("output/streaming.txt");
+  }
+  if (mode != PersistenceMode::TEXT) {
+    journal = std::make_unique<HistoricalJournalWriter<PriceStreamJournalRecord>>("output/streaming.journal");
+  }
+  if (conflation.Enabled()) {
+    conflator = std::make_unique<Conflator<PriceStream<Bond>, ProductKey>>(
+        conflation, [this](const ProductKey &key, const PriceStream<Bond> &value) { write(key, value); });
+  }
 }
 
-void BondPriceStreamsHistoricalDataService::PersistData(std::string persistKey,
-                                                        const PriceStream<Bond> &data) {
-  connector->Publish(const_cast<PriceStream<Bond> &>(data));
+BondPriceStreamsHistoricalDataService::~BondPriceStreamsHistoricalDataService() {
+  try {
+    Flush();
+  } catch (...) {
+    // Destructors must not throw; call Flush() directly to see write errors.
+  }
+}
+
+void BondPriceStreamsHistoricalDataService::PersistData(ProductKey persistKey, const PriceStream<Bond> &data) {
+  if (conflator) {
+    conflator->Update(persistKey, data);
+  } else {
+    write(persistKey, data);
+  }
+}
+
+void BondPriceStreamsHistoricalDataService::Flush() {
+  if (conflator) {
+    conflator->Flush();
+  }
+}
+
+ConflationStats BondPriceStreamsHistoricalDataService::GetConflationStats() const {
+  return conflator ? conflator->GetStats() : ConflationStats();
+}
+
+void BondPriceStreamsHistoricalDataService::write(ProductKey persistKey, const PriceStream<Bond> &data) {
+  if (connector) {
+    connector->Publish(const_cast<PriceStream<Bond> &>(data));
+  }
+  if (journal) {
+    const auto &bid = data.GetBidOrder();
+    const auto &offer = data.GetOfferOrder();
+    journal->Append(persistKey, PriceStreamJournalRecord{
+        bid.GetPrice().Count(), bid.GetVisibleQuantity(), bid.GetHiddenQuantity(),
+        offer.GetPrice().Count(), offer.GetVisibleQuantity(), offer.GetHiddenQuantity()});
+  }
 }
 
 void BondPriceStreamsHistoricalDataService::OnMessage(PriceStream<Bond> &data) {}
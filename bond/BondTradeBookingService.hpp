@@ -5,6 +5,9 @@
 #include "../base/tradebookingservice.hpp"
 #include "../base/executionservice.hpp"
 #include "IOFileConnector.hpp"
+#include "StaticPipeline.hpp"
+#include "Trace.hpp"
+#include <optional>
 
 
 // ------------- Declaration: BondTradesConnector -------------
@@ -14,7 +17,7 @@ public:
   BondTradesConnector(const std::string &filePath, Service<std::string, Trade<Bond>> *connectedService);
 
 private:
-  void parse(std::string line) override;
+  void parse(std::string_view line, const FieldSpans &fields) override;
 };
 
 // ------------- Declaration: BondTradeBookingService -------------
@@ -25,6 +28,24 @@ public:
   void Subscribe(BondTradesConnector *connector);
   void OnMessage(Trade<Bond> &data) override;
   void BookTrade(const Trade<Bond> &trade) override;
+
+  // As OnMessage() and BookTrade(), also notifying the static listeners next.
+  template <typename Next>
+  void OnMessage(Trade<Bond> &data, Next &next);
+  template <typename Next>
+  void BookTrade(const Trade<Bond> &trade, Next &next);
+
+  // Id for an internally generated trade. Ids count up past every numeric id booked so far.
+  // The returned id is overwritten by the next call.
+  const std::string &NextTradeId();
+
+  // Highest numeric trade id booked or generated.
+  std::uint64_t GetTradeIdHighWater() const;
+  void SetTradeIdHighWater(std::uint64_t highWater);
+
+private:
+  std::uint64_t tradeIdHighWater;
+  std::string nextTradeId;
 };
 
 // ------------- Declaration: BondExecutionServiceListener -------------
@@ -34,6 +55,8 @@ private:
   BondTradeBookingService *listeningService;
   vector<std::string> TradeBooks = {"TRSY1", "TRSY2", "TRSY3"};
   int cur_ptr = 0;
+  // Refilled for every execution, so booking reuses its storage.
+  std::optional<Trade<Bond>> trade;
 
   void cycleState();
 
@@ -42,6 +65,15 @@ public:
   void ProcessAdd(ExecutionOrder<Bond> &data) override;
   void ProcessRemove(ExecutionOrder<Bond> &data) override;
   void ProcessUpdate(ExecutionOrder<Bond> &data) override;
+
+  template <typename Next>
+  void ProcessAdd(ExecutionOrder<Bond> &data, Next &next);
+
+  // The book the next execution is booked to, e.g. for a snapshot.
+  int GetBookCursor() const;
+  void RestoreBookCursor(int bookCursor);
+  template <typename Next>
+  void ProcessUpdate(ExecutionOrder<Bond> &data, Next &next);
 };
 
 // ------------- Definition: BondTradesConnector -------------
@@ -50,35 +82,68 @@ BondTradesConnector::BondTradesConnector(const std::string &filePath,
                                          Service<std::string, Trade<Bond>> *connectedService)
     : InputFileConnector(filePath, connectedService) {}
 
-void BondTradesConnector::parse(std::string line) {
-  auto split = splitString(line, ',');
-  std::string productId = split[0], tradeId = split[1], bookId = split[3];
-  double price = std::stod(split[2]);
-  long quantity = std::stol(split[4]);
-  Side side = split[5].compare("0") == 0 ? Side::BUY : Side::SELL;
+void BondTradesConnector::parse(std::string_view line, const FieldSpans &fields) {
+  if (fields.size() < 6) {
+    throw std::runtime_error("Malformed trade line: " + std::string(line));
+  }
+  double price = parseDouble(fields[2]);
+  long quantity = parseLong(fields[4]);
+  Side side = fields[5] == "0" ? Side::BUY : Side::SELL;
 
-  auto bond = BondProductService::GetInstance()->GetData(productId);
-  auto trade = Trade<Bond>(bond, tradeId, price, bookId, quantity, side);
-  connectedService->OnMessage(trade);
+  const Bond &bond = BondProductService::GetInstance()->GetData(ProductKey::FromString(fields[0]));
+  auto trade = Trade<Bond>(bond, std::string(fields[1]), price, std::string(fields[3]), quantity, side);
+  dispatchMessage(connectedService, trade);
 }
 
 // ------------- Definition: BondTradeBookingService -------------
 
-BondTradeBookingService::BondTradeBookingService() {}
+BondTradeBookingService::BondTradeBookingService() : tradeIdHighWater(0) {}
 
 void BondTradeBookingService::Subscribe(BondTradesConnector *connector) {
   connector->read();
 }
 
 void BondTradeBookingService::OnMessage(Trade<Bond> &data) {
-  dataStore.insert(std::make_pair(data.GetTradeId(), data));
-  BookTrade(data);
+  NoListeners none;
+  OnMessage(data, none);
 }
 
 void BondTradeBookingService::BookTrade(const Trade<Bond> &trade) {
-  for (auto listener : this->GetListeners()) {
-    listener->ProcessAdd(const_cast<Trade<Bond> &>(trade));
+  NoListeners none;
+  BookTrade(trade, none);
+}
+
+template <typename Next>
+void BondTradeBookingService::OnMessage(Trade<Bond> &data, Next &next) {
+  dataStore.insert(std::make_pair(data.GetTradeId(), data));
+  BookTrade(data, next);
+}
+
+template <typename Next>
+void BondTradeBookingService::BookTrade(const Trade<Bond> &trade, Next &next) {
+  Tracer::Instance().Stamp(trade.GetTrace(), TraceHop::TRADE_BOOKING);
+  const std::string &tradeId = trade.GetTradeId();
+  std::uint64_t numericId = 0;
+  auto parsed = std::from_chars(tradeId.data(), tradeId.data() + tradeId.size(), numericId);
+  if (parsed.ec == std::errc() && parsed.ptr == tradeId.data() + tradeId.size()) {
+    tradeIdHighWater = std::max(tradeIdHighWater, numericId);
   }
+  notifyAdd(GetListeners(), next, const_cast<Trade<Bond> &>(trade));
+}
+
+const std::string &BondTradeBookingService::NextTradeId() {
+  char digits[20];
+  auto formatted = std::to_chars(digits, digits + sizeof(digits), ++tradeIdHighWater);
+  nextTradeId.assign(digits, formatted.ptr);
+  return nextTradeId;
+}
+
+std::uint64_t BondTradeBookingService::GetTradeIdHighWater() const {
+  return tradeIdHighWater;
+}
+
+void BondTradeBookingService::SetTradeIdHighWater(std::uint64_t highWater) {
+  tradeIdHighWater = highWater;
 }
 
 // ------------- Definition: BondExecutionServiceListener -------------
@@ -90,16 +155,20 @@ void BondExecutionServiceListener::cycleState() {
   cur_ptr = (cur_ptr + 1) % TradeBooks.size();
 }
 
+int BondExecutionServiceListener::GetBookCursor() const {
+  return cur_ptr;
+}
+
+void BondExecutionServiceListener::RestoreBookCursor(int bookCursor) {
+  if (bookCursor < 0 || static_cast<std::size_t>(bookCursor) >= TradeBooks.size()) {
+    throw std::runtime_error("Invalid execution book in snapshot: " + std::to_string(bookCursor));
+  }
+  cur_ptr = bookCursor;
+}
+
 void BondExecutionServiceListener::ProcessAdd(ExecutionOrder<Bond> &data) {
-  Trade<Bond> trade(data.GetProduct(),
-                    "tradeid",  // TODO: Replace with generated trade ID
-                    data.GetPrice(),
-                    TradeBooks[cur_ptr],
-                    data.GetVisibleQuantity() + data.GetHiddenQuantity(),
-                    data.GetSide() == OFFER ? BUY : SELL);
-
-  listeningService->BookTrade(trade);
-  cycleState();
+  NoListeners none;
+  ProcessAdd(data, none);
 }
 
 void BondExecutionServiceListener::ProcessRemove(ExecutionOrder<Bond> &data) {
@@ -110,4 +179,26 @@ void BondExecutionServiceListener::ProcessUpdate(ExecutionOrder<Bond> &data) {
   // NO-OP : ExecutionOrders are never updated in this project.
 }
 
+template <typename Next>
+void BondExecutionServiceListener::ProcessAdd(ExecutionOrder<Bond> &data, Next &next) {
+  Tracer::Instance().Stamp(data.GetTrace(), TraceHop::EXECUTION_LISTENER);
+  const std::string &tradeId = listeningService->NextTradeId();
+  long quantity = data.GetVisibleQuantity() + data.GetHiddenQuantity();
+  Side side = data.GetSide() == OFFER ? BUY : SELL;
+  const std::string &book = TradeBooks[cur_ptr];
+  if (trade) {
+    trade->Assign(data.GetProduct(), tradeId, data.GetPrice(), book, quantity, side);
+  } else {
+    trade.emplace(data.GetProduct(), tradeId, data.GetPrice(), book, quantity, side);
+  }
+  trade->SetTrace(data.GetTrace());
+
+  // Cycle before booking, so a snapshot taken downstream already counts this trade.
+  cycleState();
+  listeningService->BookTrade(*trade, next);
+}
+
+template <typename Next>
+void BondExecutionServiceListener::ProcessUpdate(ExecutionOrder<Bond> &data, Next &next) {}
+
 #endif
\ No newline at end of file
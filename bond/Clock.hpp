@@ -0,0 +1,235 @@
+#ifndef BOND_CLOCK_HPP
+#define BOND_CLOCK_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define BOND_CLOCK_HAS_TSC 1
+#else
+#define BOND_CLOCK_HAS_TSC 0
+#endif
+
+// ------------- Declaration: Clock -------------
+
+// Cheap timestamps for the hot path. On x86 with an invariant TSC, readings are
+// a single rdtsc scaled by a factor calibrated against CLOCK_MONOTONIC at first
+// use. Wall time adds an offset to CLOCK_REALTIME that NowNanos() re-reads once
+// WALL_RESYNC_NANOS have passed, so it follows NTP adjustments and strays from
+// the system clock by at most a second's worth of TSC rate error; a re-sync may
+// step it back by that much. Elsewhere readings fall back to clock_gettime,
+// which the vDSO serves without a system call.
+class Clock {
+public:
+  enum class Source { TSC, VDSO };
+
+  static constexpr std::int64_t WALL_RESYNC_NANOS = 1000000000;
+
+  // Nanoseconds since an arbitrary fixed point; never goes backwards.
+  static std::int64_t MonotonicNanos();
+
+  // Nanoseconds since the Unix epoch.
+  static std::int64_t NowNanos();
+
+  // Microseconds since the Unix epoch.
+  static std::int64_t NowMicros();
+
+  // Raw cycle counter (or monotonic nanoseconds without a TSC), for interval stamps.
+  static std::uint64_t Ticks();
+
+  // Convert a difference of Ticks() readings to nanoseconds.
+  static double TicksToNanos(std::uint64_t ticks);
+
+  static Source GetSource();
+
+private:
+  struct Calibration {
+    Source source;
+    std::uint64_t baseTicks;
+    std::int64_t baseMonotonic;
+    std::int64_t baseWall;
+    double nanosPerTick;
+  };
+
+  // CLOCK_REALTIME minus MonotonicNanos(), and when to read it again.
+  struct WallAnchor {
+    std::atomic<std::int64_t> offset;
+    std::atomic<std::int64_t> nextResync;
+  };
+
+  static const Calibration &calibration();
+  static WallAnchor &wallAnchor();
+  static void resyncWall(std::int64_t monotonic);
+  static Calibration calibrate();
+  static std::int64_t readClock(clockid_t id);
+};
+
+// ------------- Declaration: TimestampFormatter -------------
+
+// Formats UTC timestamps exactly like boost::posix_time's ptime output,
+// e.g. "2024-Dec-22 16:37:05.761930". The "YYYY-Mon-DD HH:MM:SS" prefix is
+// cached per second, so most calls only rewrite the microsecond digits.
+class TimestampFormatter {
+public:
+  static constexpr std::size_t MAX_LENGTH = 27;
+
+  // Write the timestamp for the given microseconds since the epoch; returns the length.
+  std::size_t Format(std::int64_t epochMicros, char *out);
+
+  // Write the current time from Clock.
+  std::size_t FormatNow(char *out);
+
+private:
+  static constexpr std::size_t PREFIX_LENGTH = 20;
+
+  std::int64_t cachedSecond = INT64_MIN;
+  char prefix[PREFIX_LENGTH];
+};
+
+// ------------- Definition: Clock -------------
+
+std::int64_t Clock::readClock(clockid_t id) {
+  timespec now{};
+  clock_gettime(id, &now);
+  return static_cast<std::int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+Clock::Calibration Clock::calibrate() {
+  Calibration result{Source::VDSO, 0, 0, 0, 1.0};
+#if BOND_CLOCK_HAS_TSC
+  unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+  // CPUID 0x80000007 EDX bit 8: the TSC ticks at a constant rate in every power state.
+  bool invariant = __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) && (edx & (1u << 8)) != 0;
+  if (invariant) {
+    std::uint64_t startTicks = __rdtsc();
+    std::int64_t startMonotonic = readClock(CLOCK_MONOTONIC);
+    std::int64_t startWall = readClock(CLOCK_REALTIME);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::uint64_t endTicks = __rdtsc();
+    std::int64_t endMonotonic = readClock(CLOCK_MONOTONIC);
+    if (endTicks > startTicks && endMonotonic > startMonotonic) {
+      result.source = Source::TSC;
+      result.baseTicks = startTicks;
+      result.baseMonotonic = startMonotonic;
+      result.baseWall = startWall;
+      result.nanosPerTick = static_cast<double>(endMonotonic - startMonotonic) / static_cast<double>(endTicks - startTicks);
+      return result;
+    }
+  }
+#endif
+  result.baseMonotonic = readClock(CLOCK_MONOTONIC);
+  result.baseWall = readClock(CLOCK_REALTIME);
+  return result;
+}
+
+const Clock::Calibration &Clock::calibration() {
+  static const Calibration instance = calibrate();
+  return instance;
+}
+
+Clock::WallAnchor &Clock::wallAnchor() {
+  static WallAnchor instance{{calibration().baseWall - calibration().baseMonotonic},
+                             {calibration().baseMonotonic + WALL_RESYNC_NANOS}};
+  return instance;
+}
+
+void Clock::resyncWall(std::int64_t monotonic) {
+  WallAnchor &anchor = wallAnchor();
+  std::int64_t due = anchor.nextResync.load(std::memory_order_relaxed);
+  // One caller per interval re-reads the wall clock; the rest keep the current offset.
+  if (monotonic < due ||
+      !anchor.nextResync.compare_exchange_strong(due, monotonic + WALL_RESYNC_NANOS, std::memory_order_relaxed)) {
+    return;
+  }
+  std::int64_t before = MonotonicNanos();
+  std::int64_t wall = readClock(CLOCK_REALTIME);
+  std::int64_t after = MonotonicNanos();
+  anchor.offset.store(wall - before - (after - before) / 2, std::memory_order_relaxed);
+}
+
+std::uint64_t Clock::Ticks() {
+#if BOND_CLOCK_HAS_TSC
+  if (calibration().source == Source::TSC) {
+    return __rdtsc();
+  }
+#endif
+  return static_cast<std::uint64_t>(readClock(CLOCK_MONOTONIC));
+}
+
+double Clock::TicksToNanos(std::uint64_t ticks) {
+  return static_cast<double>(ticks) * calibration().nanosPerTick;
+}
+
+std::int64_t Clock::MonotonicNanos() {
+  const Calibration &base = calibration();
+  if (base.source == Source::TSC) {
+    return base.baseMonotonic + static_cast<std::int64_t>(TicksToNanos(Ticks() - base.baseTicks));
+  }
+  return readClock(CLOCK_MONOTONIC);
+}
+
+std::int64_t Clock::NowNanos() {
+  const Calibration &base = calibration();
+  if (base.source == Source::TSC) {
+    std::int64_t monotonic = MonotonicNanos();
+    WallAnchor &anchor = wallAnchor();
+    if (monotonic >= anchor.nextResync.load(std::memory_order_relaxed)) {
+      resyncWall(monotonic);
+    }
+    return monotonic + anchor.offset.load(std::memory_order_relaxed);
+  }
+  return readClock(CLOCK_REALTIME);
+}
+
+std::int64_t Clock::NowMicros() {
+  return NowNanos() / 1000;
+}
+
+Clock::Source Clock::GetSource() {
+  return calibration().source;
+}
+
+// ------------- Definition: TimestampFormatter -------------
+
+std::size_t TimestampFormatter::Format(std::int64_t epochMicros, char *out) {
+  static const char MONTHS[12][4] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                     "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+  std::int64_t second = epochMicros >= 0 ? epochMicros / 1000000 : (epochMicros - 999999) / 1000000;
+  auto micros = static_cast<std::int64_t>(epochMicros - second * 1000000);
+
+  if (second != cachedSecond) {
+    std::time_t seconds = static_cast<std::time_t>(second);
+    std::tm utc{};
+    gmtime_r(&seconds, &utc);
+    char text[32];
+    std::snprintf(text, sizeof(text), "%04d-%s-%02d %02d:%02d:%02d", utc.tm_year + 1900, MONTHS[utc.tm_mon],
+                  utc.tm_mday, utc.tm_hour, utc.tm_min, utc.tm_sec);
+    std::memcpy(prefix, text, PREFIX_LENGTH);
+    cachedSecond = second;
+  }
+
+  std::memcpy(out, prefix, PREFIX_LENGTH);
+  if (micros == 0) {
+    // boost leaves the fraction off entirely on a whole second.
+    return PREFIX_LENGTH;
+  }
+  out[PREFIX_LENGTH] = '.';
+  for (int digit = 6; digit >= 1; --digit) {
+    out[PREFIX_LENGTH + digit] = static_cast<char>('0' + micros % 10);
+    micros /= 10;
+  }
+  return MAX_LENGTH;
+}
+
+std::size_t TimestampFormatter::FormatNow(char *out) {
+  return Format(Clock::NowMicros(), out);
+}
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef BOND_CONFLATOR_HPP
+#define BOND_CONFLATOR_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Clock.hpp"
+#include "Recycle.hpp"
+
+// ------------- Declaration: ConflationPolicy -------------
+
+// When a conflating persister flushes its dirty values: after maxEvents updates or
+// once interval has passed since the last flush, whichever comes first. A zero
+// leaves that trigger off; with both off, values are written straight through.
+struct ConflationPolicy {
+  std::size_t maxEvents = 0;
+  std::chrono::milliseconds interval{0};
+
+  bool Enabled() const;
+};
+
+// ------------- Declaration: ConflationStats -------------
+
+struct ConflationStats {
+  std::uint64_t updates = 0;    // values handed to Update()
+  std::uint64_t conflated = 0;  // values replaced before they were written
+  std::uint64_t written = 0;    // values handed to the sink
+  std::uint64_t flushes = 0;
+};
+
+// ------------- Declaration: Conflator -------------
+
+// Keeps the latest value per key and hands only those to the sink on flush, in
+// the order the keys first became dirty. Triggers are checked on Update(), so
+// a quiet stream stays buffered until the next update or an explicit Flush().
+template <typename T, typename K = std::string>
+class Conflator {
+public:
+  using Sink = std::function<void(const K &key, const T &value)>;
+
+  Conflator(ConflationPolicy policy, Sink sink);
+
+  void Update(const K &key, const T &value);
+  void Flush();
+
+  const ConflationStats &GetStats() const;
+
+private:
+  struct Entry {
+    std::optional<T> value;
+    bool dirty = false;
+  };
+
+  ConflationPolicy policy;
+  Sink sink;
+  // Element pointers, unlike iterators, survive rehashing.
+  std::unordered_map<K, Entry> latest;
+  std::vector<std::pair<const K, Entry> *> dirty;
+  std::size_t pendingEvents;
+  std::int64_t lastFlush;
+  ConflationStats stats;
+};
+
+// ------------- Definition: ConflationPolicy -------------
+
+bool ConflationPolicy::Enabled() const {
+  return maxEvents > 0 || interval.count() > 0;
+}
+
+// ------------- Definition: Conflator -------------
+
+template <typename T, typename K>
+Conflator<T, K>::Conflator(ConflationPolicy policy, Sink sink)
+    : policy(policy), sink(std::move(sink)), pendingEvents(0), lastFlush(Clock::MonotonicNanos()) {}
+
+template <typename T, typename K>
+void Conflator<T, K>::Update(const K &key, const T &value) {
+  stats.updates++;
+  auto *entry = &*latest.try_emplace(key).first;
+  if (entry->second.dirty) {
+    stats.conflated++;
+  } else {
+    entry->second.dirty = true;
+    dirty.push_back(entry);
+  }
+  recycleInto(entry->second.value, value);
+  pendingEvents++;
+
+  bool countDue = policy.maxEvents > 0 && pendingEvents >= policy.maxEvents;
+  bool timeDue = policy.interval.count() > 0 &&
+      Clock::MonotonicNanos() - lastFlush >= std::chrono::nanoseconds(policy.interval).count();
+  if (countDue || timeDue || !policy.Enabled()) {
+    Flush();
+  }
+}
+
+template <typename T, typename K>
+void Conflator<T, K>::Flush() {
+  for (auto entry : dirty) {
+    entry->second.dirty = false;
+    sink(entry->first, *entry->second.value);
+    stats.written++;
+  }
+  if (!dirty.empty()) {
+    stats.flushes++;
+  }
+  dirty.clear();
+  pendingEvents = 0;
+  lastFlush = Clock::MonotonicNanos();
+}
+
+template <typename T, typename K>
+const ConflationStats &Conflator<T, K>::GetStats() const {
+  return stats;
+}
+
+#endif
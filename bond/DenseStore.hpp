@@ -0,0 +1,143 @@
+#ifndef BOND_DENSE_STORE_HPP
+#define BOND_DENSE_STORE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../base/products.hpp"
+#include "../base/soa.hpp"
+#include "BondProductService.hpp"
+#include "Recycle.hpp"
+
+// Dense index of a product, looked up in BondProductService when the product
+// was not copied from a registered one. Throws for unknown products.
+std::uint32_t productIndexOf(const Product &product);
+
+// ------------- Declaration: DenseStore -------------
+
+// Per-product values in a flat vector indexed by BondProductService's dense
+// product indexes, so a lookup is an array index instead of a string hash.
+template <typename V>
+class DenseStore {
+public:
+  // Put the value in its product's slot, reusing the storage of the value it replaces.
+  // Returns the stored value and whether the slot was empty.
+  std::pair<V *, bool> Store(std::uint32_t productIndex, const V &value);
+
+  V *Find(std::uint32_t productIndex);
+  const V *Find(std::uint32_t productIndex) const;
+
+  // Lookup by product key or id, off the hot path. Returns nullptr for unknown or absent products.
+  V *Find(ProductKey productKey);
+  const V *Find(ProductKey productKey) const;
+  V *Find(const std::string &productId);
+  const V *Find(const std::string &productId) const;
+
+  // Visit every stored value in product index order.
+  template <typename F>
+  void ForEach(F &&visit) const;
+
+  std::size_t Size() const;
+
+private:
+  std::vector<std::optional<V>> slots;
+  std::size_t count = 0;
+};
+
+// ------------- Declaration: DenseService -------------
+
+// Service whose values live in a DenseStore rather than the string-keyed dataStore.
+template <typename V>
+class DenseService : public Service<std::string, V> {
+public:
+  V &GetData(std::string key) override;
+
+protected:
+  DenseStore<V> store;
+};
+
+// ------------- Definition: DenseStore -------------
+
+std::uint32_t productIndexOf(const Product &product) {
+  std::uint32_t index = product.GetProductIndex();
+  if (index == NO_PRODUCT_INDEX) {
+    index = BondProductService::GetInstance()->GetProductIndex(product.GetProductKey());
+  }
+  if (index == NO_PRODUCT_INDEX) {
+    throw std::out_of_range("Unknown product: " + product.GetProductId());
+  }
+  return index;
+}
+
+template <typename V>
+std::pair<V *, bool> DenseStore<V>::Store(std::uint32_t productIndex, const V &value) {
+  if (productIndex >= slots.size()) {
+    slots.resize(std::max<std::size_t>(productIndex + 1, BondProductService::GetInstance()->Size()));
+  }
+  auto &slot = slots[productIndex];
+  bool added = recycleInto(slot, value);
+  count += added ? 1 : 0;
+  return {&*slot, added};
+}
+
+template <typename V>
+V *DenseStore<V>::Find(std::uint32_t productIndex) {
+  return productIndex < slots.size() && slots[productIndex] ? &*slots[productIndex] : nullptr;
+}
+
+template <typename V>
+const V *DenseStore<V>::Find(std::uint32_t productIndex) const {
+  return productIndex < slots.size() && slots[productIndex] ? &*slots[productIndex] : nullptr;
+}
+
+template <typename V>
+V *DenseStore<V>::Find(ProductKey productKey) {
+  return Find(BondProductService::GetInstance()->GetProductIndex(productKey));
+}
+
+template <typename V>
+const V *DenseStore<V>::Find(ProductKey productKey) const {
+  return Find(BondProductService::GetInstance()->GetProductIndex(productKey));
+}
+
+template <typename V>
+V *DenseStore<V>::Find(const std::string &productId) {
+  return Find(BondProductService::GetInstance()->GetProductIndex(productId));
+}
+
+template <typename V>
+const V *DenseStore<V>::Find(const std::string &productId) const {
+  return Find(BondProductService::GetInstance()->GetProductIndex(productId));
+}
+
+template <typename V>
+template <typename F>
+void DenseStore<V>::ForEach(F &&visit) const {
+  for (const auto &slot : slots) {
+    if (slot) {
+      visit(*slot);
+    }
+  }
+}
+
+template <typename V>
+std::size_t DenseStore<V>::Size() const {
+  return count;
+}
+
+// ------------- Definition: DenseService -------------
+
+template <typename V>
+V &DenseService<V>::GetData(std::string key) {
+  V *value = store.Find(key);
+  if (value == nullptr) {
+    throw std::out_of_range("No data for product: " + key);
+  }
+  return *value;
+}
+
+#endif
@@ -4,14 +4,14 @@
 #include "../base/products.hpp"
 #include "../base/pricingservice.hpp"
 #include "IOFileConnector.hpp"
-#include <boost/date_time/posix_time/posix_time.hpp>
+#include "Clock.hpp"
 
 // ------------- Declaration: GUIConnector -------------
 
 class GUIConnector : public OutputFileConnector<Price<Bond>> {
 public:
   explicit GUIConnector(const std::string &filePath);
-  std::string toString(Price<Bond> &data) override;
+  void format(Price<Bond> &data, RecordWriter &record) override;
 };
 
 // ------------- Declaration: GUIService -------------
@@ -23,8 +23,8 @@ public:
 
 private:
   const int throttle = 300;  // Defined in milliseconds
-  GUIConnector *connector;
-  boost::posix_time::ptime lastTick = boost::posix_time::microsec_clock::universal_time();
+  std::unique_ptr<GUIConnector> connector;
+  std::int64_t lastTick = Clock::MonotonicNanos();
 };
 
 // ------------- Declaration: BondPriceServiceListener -------------
@@ -45,27 +45,24 @@ private:
 
 GUIConnector::GUIConnector(const std::string &filePath) : OutputFileConnector(filePath) {}
 
-std::string GUIConnector::toString(Price<Bond> &data) {
-  std::ostringstream oss;
-  oss << boost::posix_time::microsec_clock::universal_time() << ","
-      << data.GetProduct().GetProductId() << ","
-      << (data.GetMid() - data.GetBidOfferSpread() / 2) << ","
-      << (data.GetMid() + data.GetBidOfferSpread() / 2);
-  return oss.str();
+void GUIConnector::format(Price<Bond> &data, RecordWriter &record) {
+  record.Timestamp()
+      .Field(data.GetProduct().GetProductId())
+      .Field(data.GetMid() - data.GetBidOfferSpread() / 2)
+      .Field(data.GetMid() + data.GetBidOfferSpread() / 2);
 }
 
 // ------------- Definition: GUIService -------------
 
 GUIService::GUIService(const int throttle) : throttle(throttle) {
-  connector = new GUIConnector("output/gui.txt");
+  connector = std::make_unique<GUIConnector>("output/gui.txt");
 }
 
 void GUIService::OnMessage(Price<Bond> &data) {
-  auto currentTick = boost::posix_time::microsec_clock::universal_time();
-  boost::posix_time::time_duration diff = currentTick - lastTick;
-  if (diff.total_milliseconds() > 300) {
+  std::int64_t currentTick = Clock::MonotonicNanos();
+  if (currentTick - lastTick > static_cast<std::int64_t>(throttle) * 1000000) {
     connector->Publish(data);
-    lastTick = boost::posix_time::microsec_clock::universal_time();
+    lastTick = currentTick;
   }
 }
 
@@ -0,0 +1,389 @@
+#ifndef BOND_HISTORICAL_JOURNAL_HPP
+#define BOND_HISTORICAL_JOURNAL_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "../base/productkey.hpp"
+#include "AsyncFileWriter.hpp"
+#include "Clock.hpp"
+#include "IOFileConnector.hpp"
+
+// Historical journals are append-only files of fixed-size frames:
+//
+//   JournalFileHeader | frames... | key table | block table | JournalTrailer
+//
+// Each frame carries its persist key and timestamp. The key table holds the
+// latest frame of every key, and the block table the first and last timestamp
+// of every BLOCK_FRAMES frames, so time-range scans, for one key or all, start
+// at the first block that can overlap the interval. The tables and trailer are
+// appended on Close(); a journal without a trailer (e.g. after a crash) is
+// re-indexed by scanning its frames. Fields are written in host byte order.
+
+// ------------- Declaration: Journal layout -------------
+
+// How a historical data service persists: CSV text, a binary journal, or both.
+enum class PersistenceMode { TEXT, JOURNAL, BOTH };
+
+constexpr char JOURNAL_MAGIC[8] = {'B', 'T', 'S', 'J', 'R', 'N', 'L', '\0'};
+constexpr char JOURNAL_INDEX_MAGIC[8] = {'B', 'T', 'S', 'J', 'I', 'D', 'X', '\0'};
+constexpr std::uint32_t JOURNAL_VERSION = 2;
+constexpr std::uint64_t JOURNAL_NO_FRAME = std::numeric_limits<std::uint64_t>::max();
+
+struct JournalFileHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t payloadSize;
+  std::uint32_t frameSize;
+  std::uint32_t blockFrames;
+  std::uint64_t reserved;
+};
+
+template <typename R>
+struct JournalFrame {
+  std::int64_t timestamp;  // microseconds since the epoch, non-decreasing through the file
+  char key[16];            // NUL padded
+  R payload;
+};
+
+struct JournalKeyEntry {
+  char key[16];  // NUL padded
+  std::uint64_t latest;
+};
+
+struct JournalBlockEntry {
+  std::int64_t firstTimestamp;
+  std::int64_t lastTimestamp;
+};
+
+struct JournalTrailer {
+  std::uint64_t frameCount;
+  std::uint64_t keyCount;
+  std::uint64_t blockCount;
+  std::uint64_t indexOffset;
+  char magic[8];
+};
+
+static_assert(sizeof(JournalFileHeader) % 8 == 0, "header must keep frames aligned");
+
+// ------------- Declaration: HistoricalJournalWriter -------------
+
+// Appends timestamped records of the trivially copyable type R through an
+// AsyncFileWriter and keeps the key and block indexes in memory until Close().
+template <typename R>
+class HistoricalJournalWriter {
+public:
+  static constexpr std::uint32_t BLOCK_FRAMES = 1024;
+
+  explicit HistoricalJournalWriter(const std::string &filePath);
+  ~HistoricalJournalWriter();
+  HistoricalJournalWriter(const HistoricalJournalWriter &) = delete;
+  HistoricalJournalWriter &operator=(const HistoricalJournalWriter &) = delete;
+
+  // Append a record for the key, stamped with the current time.
+  void Append(std::string_view key, const R &payload);
+  void Append(ProductKey key, const R &payload);
+
+  // Write the index tables and trailer. Nothing may be appended afterwards.
+  void Close();
+
+private:
+  static_assert(std::is_trivially_copyable<R>::value, "journal records are copied byte for byte");
+
+  std::unique_ptr<AsyncFileWriter> writer;
+  std::unordered_map<std::string, std::uint32_t> keyIndex;
+  std::vector<JournalKeyEntry> keys;
+  std::vector<JournalBlockEntry> blocks;
+  std::uint64_t frameCount;
+  std::int64_t lastTimestamp;
+  bool closed;
+};
+
+// ------------- Declaration: HistoricalJournalReader -------------
+
+// Answers latest-value and time-range queries from a memory mapping of a journal.
+// Returned frames point into the mapping and live as long as the reader.
+template <typename R>
+class HistoricalJournalReader {
+public:
+  using Frame = JournalFrame<R>;
+
+  explicit HistoricalJournalReader(const std::string &filePath);
+
+  std::uint64_t Size() const;
+  const std::vector<std::string> &GetKeys() const;
+  std::string_view GetKey(const Frame &frame) const;
+
+  // Most recent record for the key, or nullptr if the key was never persisted.
+  const Frame *Latest(std::string_view key) const;
+
+  // Records for the key stamped within [from, to], oldest first. Only the blocks
+  // overlapping the interval are scanned, so later history is never read.
+  std::vector<const Frame *> Range(std::string_view key, std::int64_t from, std::int64_t to) const;
+
+  // Records for every key stamped within [from, to], oldest first. Only the
+  // blocks overlapping the interval are scanned.
+  std::vector<const Frame *> Range(std::int64_t from, std::int64_t to) const;
+
+private:
+  const Frame *frameAt(std::uint64_t index) const;
+
+  // Walk the frames stamped within [from, to] forward, starting from a binary search of the block table.
+  template <typename Visit>
+  void scan(std::int64_t from, std::int64_t to, Visit &&visit) const;
+  void loadIndex(const JournalTrailer &trailer);
+  void rebuildIndex();
+
+  MappedFile file;
+  const char *frames;
+  std::uint64_t frameCount;
+  std::uint32_t blockFrames;
+  std::vector<std::string> keys;
+  std::vector<std::uint64_t> latest;
+  std::unordered_map<std::string, std::uint32_t> keyIndex;
+  std::vector<JournalBlockEntry> blocks;
+};
+
+// ------------- Definition: HistoricalJournalWriter -------------
+
+template <typename R>
+HistoricalJournalWriter<R>::HistoricalJournalWriter(const std::string &filePath)
+    : writer(std::make_unique<AsyncFileWriter>(filePath)), frameCount(0),
+      lastTimestamp(std::numeric_limits<std::int64_t>::min()), closed(false) {
+  JournalFileHeader header{};
+  std::memcpy(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+  header.version = JOURNAL_VERSION;
+  header.payloadSize = sizeof(R);
+  header.frameSize = sizeof(JournalFrame<R>);
+  header.blockFrames = BLOCK_FRAMES;
+  writer->Write(reinterpret_cast<const char *>(&header), sizeof(header));
+}
+
+template <typename R>
+HistoricalJournalWriter<R>::~HistoricalJournalWriter() {
+  if (!closed) {
+    try {
+      Close();
+    } catch (...) {
+      // Destructors must not throw; call Close() directly to see write errors.
+    }
+  }
+}
+
+template <typename R>
+void HistoricalJournalWriter<R>::Append(ProductKey key, const R &payload) {
+  char id[ProductKey::MAX_LENGTH];
+  Append(std::string_view(id, key.Format(id)), payload);
+}
+
+template <typename R>
+void HistoricalJournalWriter<R>::Append(std::string_view key, const R &payload) {
+  if (closed) {
+    throw std::runtime_error("Journal is closed");
+  }
+  auto found = keyIndex.find(std::string(key));
+  if (found == keyIndex.end()) {
+    if (key.size() >= sizeof(JournalKeyEntry::key)) {
+      throw std::runtime_error("Persist key too long for journal: " + std::string(key));
+    }
+    JournalKeyEntry entry{};
+    std::memcpy(entry.key, key.data(), key.size());
+    entry.latest = JOURNAL_NO_FRAME;
+    keys.push_back(entry);
+    found = keyIndex.emplace(std::string(key), static_cast<std::uint32_t>(keys.size() - 1)).first;
+  }
+
+  // Range lookups rely on timestamps never going backwards within a file.
+  lastTimestamp = std::max(lastTimestamp, Clock::NowMicros());
+
+  JournalKeyEntry &entry = keys[found->second];
+  JournalFrame<R> frame{};
+  frame.timestamp = lastTimestamp;
+  std::memcpy(frame.key, entry.key, sizeof(frame.key));
+  frame.payload = payload;
+  writer->Write(reinterpret_cast<const char *>(&frame), sizeof(frame));
+
+  entry.latest = frameCount;
+  if (frameCount % BLOCK_FRAMES == 0) {
+    blocks.push_back({lastTimestamp, lastTimestamp});
+  }
+  blocks.back().lastTimestamp = lastTimestamp;
+  frameCount++;
+}
+
+template <typename R>
+void HistoricalJournalWriter<R>::Close() {
+  if (closed) {
+    return;
+  }
+  closed = true;
+  JournalTrailer trailer{};
+  trailer.frameCount = frameCount;
+  trailer.keyCount = keys.size();
+  trailer.blockCount = blocks.size();
+  trailer.indexOffset = sizeof(JournalFileHeader) + frameCount * sizeof(JournalFrame<R>);
+  std::memcpy(trailer.magic, JOURNAL_INDEX_MAGIC, sizeof(JOURNAL_INDEX_MAGIC));
+  writer->Write(reinterpret_cast<const char *>(keys.data()), keys.size() * sizeof(JournalKeyEntry));
+  writer->Write(reinterpret_cast<const char *>(blocks.data()), blocks.size() * sizeof(JournalBlockEntry));
+  writer->Write(reinterpret_cast<const char *>(&trailer), sizeof(trailer));
+  writer->Flush();
+  writer.reset();
+}
+
+// ------------- Definition: HistoricalJournalReader -------------
+
+template <typename R>
+HistoricalJournalReader<R>::HistoricalJournalReader(const std::string &filePath)
+    : file(filePath), frames(nullptr), frameCount(0), blockFrames(1) {
+  JournalFileHeader header{};
+  if (file.size() < sizeof(header)) {
+    throw std::runtime_error("Not a journal: " + filePath);
+  }
+  std::memcpy(&header, file.data(), sizeof(header));
+  if (std::memcmp(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0 || header.version != JOURNAL_VERSION) {
+    throw std::runtime_error("Not a journal: " + filePath);
+  }
+  if (header.payloadSize != sizeof(R) || header.frameSize != sizeof(Frame) || header.blockFrames == 0) {
+    throw std::runtime_error("Journal record layout does not match: " + filePath);
+  }
+  frames = file.data() + sizeof(header);
+  blockFrames = header.blockFrames;
+
+  JournalTrailer trailer{};
+  if (file.size() >= sizeof(header) + sizeof(trailer)) {
+    std::memcpy(&trailer, file.data() + file.size() - sizeof(trailer), sizeof(trailer));
+  }
+  if (std::memcmp(trailer.magic, JOURNAL_INDEX_MAGIC, sizeof(JOURNAL_INDEX_MAGIC)) == 0) {
+    loadIndex(trailer);
+  } else {
+    rebuildIndex();
+  }
+}
+
+template <typename R>
+void HistoricalJournalReader<R>::loadIndex(const JournalTrailer &trailer) {
+  std::uint64_t tableBytes = trailer.keyCount * sizeof(JournalKeyEntry) + trailer.blockCount * sizeof(JournalBlockEntry);
+  if (trailer.indexOffset != sizeof(JournalFileHeader) + trailer.frameCount * sizeof(Frame) ||
+      trailer.indexOffset + tableBytes + sizeof(JournalTrailer) != file.size()) {
+    throw std::runtime_error("Corrupt journal index");
+  }
+  frameCount = trailer.frameCount;
+
+  const char *table = file.data() + trailer.indexOffset;
+  for (std::uint64_t i = 0; i < trailer.keyCount; ++i) {
+    JournalKeyEntry entry{};
+    std::memcpy(&entry, table + i * sizeof(entry), sizeof(entry));
+    keys.emplace_back(entry.key, strnlen(entry.key, sizeof(entry.key)));
+    latest.push_back(entry.latest);
+    keyIndex.emplace(keys.back(), static_cast<std::uint32_t>(i));
+  }
+  blocks.resize(trailer.blockCount);
+  std::memcpy(blocks.data(), table + trailer.keyCount * sizeof(JournalKeyEntry),
+              trailer.blockCount * sizeof(JournalBlockEntry));
+}
+
+template <typename R>
+void HistoricalJournalReader<R>::rebuildIndex() {
+  // A torn final frame is ignored.
+  frameCount = (file.size() - sizeof(JournalFileHeader)) / sizeof(Frame);
+  for (std::uint64_t i = 0; i < frameCount; ++i) {
+    const Frame *frame = frameAt(i);
+    std::string key(frame->key, strnlen(frame->key, sizeof(frame->key)));
+    auto found = keyIndex.find(key);
+    if (found == keyIndex.end()) {
+      keys.push_back(key);
+      latest.push_back(JOURNAL_NO_FRAME);
+      found = keyIndex.emplace(key, static_cast<std::uint32_t>(keys.size() - 1)).first;
+    }
+    latest[found->second] = i;
+    if (i % blockFrames == 0) {
+      blocks.push_back({frame->timestamp, frame->timestamp});
+    }
+    blocks.back().lastTimestamp = frame->timestamp;
+  }
+}
+
+template <typename R>
+const JournalFrame<R> *HistoricalJournalReader<R>::frameAt(std::uint64_t index) const {
+  return reinterpret_cast<const Frame *>(frames + index * sizeof(Frame));
+}
+
+template <typename R>
+std::uint64_t HistoricalJournalReader<R>::Size() const {
+  return frameCount;
+}
+
+template <typename R>
+const std::vector<std::string> &HistoricalJournalReader<R>::GetKeys() const {
+  return keys;
+}
+
+template <typename R>
+std::string_view HistoricalJournalReader<R>::GetKey(const Frame &frame) const {
+  return std::string_view(frame.key, strnlen(frame.key, sizeof(frame.key)));
+}
+
+template <typename R>
+const JournalFrame<R> *HistoricalJournalReader<R>::Latest(std::string_view key) const {
+  auto found = keyIndex.find(std::string(key));
+  if (found == keyIndex.end() || latest[found->second] == JOURNAL_NO_FRAME) {
+    return nullptr;
+  }
+  return frameAt(latest[found->second]);
+}
+
+template <typename R>
+template <typename Visit>
+void HistoricalJournalReader<R>::scan(std::int64_t from, std::int64_t to, Visit &&visit) const {
+  auto first = std::lower_bound(blocks.begin(), blocks.end(), from,
+                                [](const JournalBlockEntry &block, std::int64_t time) {
+                                  return block.lastTimestamp < time;
+                                });
+  for (auto block = first; block != blocks.end() && block->firstTimestamp <= to; ++block) {
+    std::uint64_t begin = static_cast<std::uint64_t>(block - blocks.begin()) * blockFrames;
+    std::uint64_t end = std::min<std::uint64_t>(begin + blockFrames, frameCount);
+    for (std::uint64_t i = begin; i < end; ++i) {
+      const Frame *frame = frameAt(i);
+      if (frame->timestamp > to) {
+        return;
+      }
+      if (frame->timestamp >= from) {
+        visit(frame);
+      }
+    }
+  }
+}
+
+template <typename R>
+std::vector<const JournalFrame<R> *> HistoricalJournalReader<R>::Range(std::string_view key, std::int64_t from,
+                                                                      std::int64_t to) const {
+  std::vector<const Frame *> result;
+  if (key.size() >= sizeof(Frame::key) || keyIndex.find(std::string(key)) == keyIndex.end()) {
+    return result;
+  }
+  char padded[sizeof(Frame::key)] = {};
+  std::memcpy(padded, key.data(), key.size());
+  scan(from, to, [&](const Frame *frame) {
+    if (std::memcmp(frame->key, padded, sizeof(padded)) == 0) {
+      result.push_back(frame);
+    }
+  });
+  return result;
+}
+
+template <typename R>
+std::vector<const JournalFrame<R> *> HistoricalJournalReader<R>::Range(std::int64_t from, std::int64_t to) const {
+  std::vector<const Frame *> result;
+  scan(from, to, [&](const Frame *frame) { result.push_back(frame); });
+  return result;
+}
+
+#endif
@@ -2,69 +2,583 @@
 #define BOND_IOFILECONNECTOR_HPP
 
 #include <vector>
+#include <algorithm>
+#include <array>
 #include <string>
+#include <string_view>
+#include <charconv>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <exception>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <sstream>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include "../base/soa.hpp"
+#include "AsyncFileWriter.hpp"
+#include "BinaryInputFormat.hpp"
+#include "RecordWriter.hpp"
+#include "ServiceStats.hpp"
+
+// ------------- Declaration: MappedFile -------------
+
+// Read-only memory mapping of a whole file. The mapping lives as long as the object.
+class MappedFile {
+public:
+  explicit MappedFile(const std::string &filePath);
+  ~MappedFile();
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  const char *data() const;
+  std::size_t size() const;
+
+private:
+  int fd;
+  const char *mapped;
+  std::size_t length;
+};
+
+// ------------- Declaration: FieldSpans -------------
+
+// Reusable array of views into one delimited line. Splitting never allocates;
+// fields past MAX_FIELDS are dropped. Indexing is unchecked: parsers check size()
+// first, since views past it still point into an earlier line.
+class FieldSpans {
+public:
+  static constexpr std::size_t MAX_FIELDS = 32;
+
+  std::size_t split(std::string_view line, char delim);
+  const std::string_view &operator[](std::size_t index) const;
+  std::size_t size() const;
+
+private:
+  std::array<std::string_view, MAX_FIELDS> spans;
+  std::size_t count = 0;
+};
 
 // ------------- Declaration: InputFileConnector -------------
 
+// STREAM reads the file with std::getline, MMAP walks a read-only mapping of it.
+// Either way, a file starting with a pre-parsed input header is read as binary records.
+enum class ReadMode { STREAM, MMAP };
+
 template <typename K, typename V>
 class InputFileConnector : public Connector<V> {
 private:
   std::string filePath;
+  ReadMode readMode;
+  FieldSpans fields;
+  std::size_t startOffset;
+  std::size_t offset;
+
+  void readStream();
+  void readMapped();
+  void dispatch(std::string_view line);
 
 protected:
   Service<K, V> *connectedService;
 
+  const std::string &GetFilePath() const;
+
+  // The text of a mapped file from the start offset on, checked to begin on a line.
+  std::string_view unreadText(const MappedFile &file);
+
+  // Record that the input has been consumed through this many bytes.
+  void setOffset(std::size_t consumed);
+
+  // Hand every record of a pre-parsed binary file to parseBinary().
+  void readBinary(const MappedFile &file);
+
+  // Called once before the records of a binary file, with its product table.
+  virtual void beginBinary(const BinaryFileHeader &header, const std::vector<std::string_view> &productIds);
+
+  // Called once per fixed-size record of a binary file.
+  virtual void parseBinary(const char *record);
+
 public:
-  InputFileConnector(const std::string &filePath, Service<K, V> *connectedService);
+  InputFileConnector(const std::string &filePath, Service<K, V> *connectedService,
+                     ReadMode readMode = ReadMode::MMAP);
   void Publish(V &data) override;
   void read();
-  virtual void parse(std::string line) = 0;
+
+  // Start reading this many bytes in, e.g. past input applied before a restart. The
+  // offset must fall on a line boundary, or on a record boundary of a binary file.
+  void SetStartOffset(std::size_t offset);
+
+  // Bytes of the file consumed so far, through the end of the line or record being handled.
+  std::size_t GetOffset() const;
+
+  // Called once per non-empty line. Both views are only valid for the duration of the call.
+  virtual void parse(std::string_view line, const FieldSpans &fields) = 0;
+};
+
+// ------------- Declaration: ChunkedInputFileConnector -------------
+
+// Input connector that can decode its file on several threads. The file is cut
+// into rounds of byte-range chunks on line boundaries, one chunk per worker. The
+// workers decode each chunk into its own vector, in file order, and the calling
+// thread delivers the vectors in chunk order while the workers decode the next
+// round, so records arrive in the same order a single-threaded read() produces.
+// Decoding is what runs in parallel; records are not split up by product, and
+// every one is delivered on the calling thread.
+template <typename K, typename V>
+class ChunkedInputFileConnector : public InputFileConnector<K, V> {
+public:
+  static constexpr std::size_t DEFAULT_CHUNK_BYTES = 4 << 20;
+
+  ChunkedInputFileConnector(const std::string &filePath, Service<K, V> *connectedService,
+                            ReadMode readMode = ReadMode::MMAP);
+
+  void parse(std::string_view line, const FieldSpans &fields) override;
+  void readParallel(std::size_t workers, std::size_t chunkBytes = DEFAULT_CHUNK_BYTES);
+
+  // Turn one line into a record. Must not touch shared state: it runs on worker threads.
+  virtual V decode(std::string_view line, const FieldSpans &fields) = 0;
+
+protected:
+  // Hand one decoded record to the connected service.
+  virtual void deliver(V &data);
+
+private:
+  // A decoded line and the file offset just past it.
+  struct Decoded {
+    std::size_t end;
+    V data;
+  };
+
+  void decodeChunk(std::string_view chunk, std::size_t chunkOffset, std::vector<Decoded> &records);
 };
 
 // ------------- Declaration: OutputFileConnector -------------
 
+// Writes one line per published record. The file is truncated on construction and
+// kept open; lines are buffered and written by an AsyncFileWriter, and everything
+// published is on disk once Flush() returns or the connector is destroyed.
+// Records are formatted into a stack buffer, so publishing does not allocate.
 template <typename V>
 class OutputFileConnector : public Connector<V> {
 private:
   std::string filePath;
-
-  void append(std::string line, bool newFile);
+  std::unique_ptr<AsyncFileWriter> writer;
 
 public:
+  static constexpr std::size_t MAX_RECORD_BYTES = 512;
+
   explicit OutputFileConnector(const std::string &filePath);
   void Publish(V &data) override;
-  virtual std::string toString(V &data) = 0;
+  void Flush();
+
+  // Write the record's fields, without the trailing newline.
+  virtual void format(V &data, RecordWriter &record) = 0;
+
+  // The record as it appears in the file.
+  virtual std::string toString(V &data);
 };
 
 // ------------- Declaration: Utility Functions -------------
 
 std::vector<std::string> splitString(std::string input, char delim);
-double fractionalToDouble(std::string price);
+double fractionalToDouble(std::string_view price);
+long parseLong(std::string_view field);
+double parseDouble(std::string_view field);
+
+// ------------- Definition: MappedFile -------------
+
+MappedFile::MappedFile(const std::string &filePath) : fd(-1), mapped(nullptr), length(0) {
+  fd = ::open(filePath.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Unable to open file: " + filePath);
+  }
+  struct stat info {};
+  if (::fstat(fd, &info) != 0) {
+    ::close(fd);
+    throw std::runtime_error("Unable to stat file: " + filePath);
+  }
+  length = static_cast<std::size_t>(info.st_size);
+  if (length > 0) {
+    void *address = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address == MAP_FAILED) {
+      ::close(fd);
+      throw std::runtime_error("Unable to map file: " + filePath);
+    }
+    ::madvise(address, length, MADV_SEQUENTIAL);
+    mapped = static_cast<const char *>(address);
+  }
+}
+
+MappedFile::~MappedFile() {
+  if (mapped != nullptr) {
+    ::munmap(const_cast<char *>(mapped), length);
+  }
+  if (fd >= 0) {
+    ::close(fd);
+  }
+}
+
+const char *MappedFile::data() const {
+  return mapped;
+}
+
+std::size_t MappedFile::size() const {
+  return length;
+}
+
+// ------------- Definition: FieldSpans -------------
+
+std::size_t FieldSpans::split(std::string_view line, char delim) {
+  count = 0;
+  std::size_t start = 0;
+  while (count < MAX_FIELDS) {
+    std::size_t end = line.find(delim, start);
+    if (end == std::string_view::npos) {
+      spans[count++] = line.substr(start);
+      break;
+    }
+    spans[count++] = line.substr(start, end - start);
+    start = end + 1;
+  }
+  return count;
+}
+
+const std::string_view &FieldSpans::operator[](std::size_t index) const {
+  return spans[index];
+}
+
+std::size_t FieldSpans::size() const {
+  return count;
+}
 
 // ------------- Definition: InputFileConnector -------------
 
 template <typename K, typename V>
-InputFileConnector<K, V>::InputFileConnector(const std::string &filePath, Service<K, V> *connectedService)
-    : filePath(filePath), connectedService(connectedService) {}
+InputFileConnector<K, V>::InputFileConnector(const std::string &filePath, Service<K, V> *connectedService,
+                                             ReadMode readMode)
+    : filePath(filePath), readMode(readMode), startOffset(0), offset(0), connectedService(connectedService) {}
 
 template <typename K, typename V>
 void InputFileConnector<K, V>::Publish(V &data) {
   // No-op for InputFileConnector
 }
 
+template <typename K, typename V>
+const std::string &InputFileConnector<K, V>::GetFilePath() const {
+  return filePath;
+}
+
+template <typename K, typename V>
+void InputFileConnector<K, V>::SetStartOffset(std::size_t offset) {
+  startOffset = offset;
+  // The skipped input counts as consumed, e.g. for a snapshot taken before reading starts.
+  this->offset = offset;
+}
+
+template <typename K, typename V>
+std::size_t InputFileConnector<K, V>::GetOffset() const {
+  return offset;
+}
+
+template <typename K, typename V>
+std::string_view InputFileConnector<K, V>::unreadText(const MappedFile &file) {
+  if (startOffset > file.size()) {
+    throw std::runtime_error("Start offset is past the end of " + filePath);
+  }
+  if (startOffset > 0 && file.data()[startOffset - 1] != '\n') {
+    throw std::runtime_error("Start offset is not on a line boundary in " + filePath);
+  }
+  offset = startOffset;
+  return std::string_view(file.data() + startOffset, file.size() - startOffset);
+}
+
+template <typename K, typename V>
+void InputFileConnector<K, V>::setOffset(std::size_t consumed) {
+  offset = consumed;
+}
+
 template <typename K, typename V>
 void InputFileConnector<K, V>::read() {
+  if (readMode == ReadMode::MMAP) {
+    readMapped();
+  } else {
+    readStream();
+  }
+}
+
+template <typename K, typename V>
+void InputFileConnector<K, V>::readStream() {
   std::ifstream inFile(filePath);
   if (!inFile) {
     throw std::runtime_error("Unable to open file: " + filePath);
   }
+  char magic[sizeof(BinaryFileHeader)] = {};
+  inFile.read(magic, sizeof(magic));
+  if (isBinaryInput(magic, static_cast<std::size_t>(inFile.gcount()))) {
+    readBinary(MappedFile(filePath));
+    return;
+  }
+  inFile.clear();
+  inFile.seekg(0, std::ios_base::end);
+  auto size = static_cast<std::size_t>(inFile.tellg());
+  if (startOffset > size) {
+    throw std::runtime_error("Start offset is past the end of " + filePath);
+  }
+  if (startOffset > 0) {
+    char previous = '\0';
+    inFile.seekg(static_cast<std::streamoff>(startOffset - 1));
+    inFile.get(previous);
+    if (previous != '\n') {
+      throw std::runtime_error("Start offset is not on a line boundary in " + filePath);
+    }
+  }
+  inFile.seekg(static_cast<std::streamoff>(startOffset));
+  offset = startOffset;
   std::string line;
   while (std::getline(inFile, line)) {
-    parse(line);
+    offset += line.size() + (inFile.eof() ? 0 : 1);
+    dispatch(line);
+  }
+}
+
+template <typename K, typename V>
+void InputFileConnector<K, V>::readMapped() {
+  MappedFile file(filePath);
+  if (isBinaryInput(file.data(), file.size())) {
+    readBinary(file);
+    return;
+  }
+  std::string_view remaining = unreadText(file);
+  while (!remaining.empty()) {
+    std::size_t end = remaining.find('\n');
+    if (end == std::string_view::npos) {
+      end = remaining.size();
+    }
+    std::size_t consumed = std::min(end + 1, remaining.size());
+    offset += consumed;
+    dispatch(remaining.substr(0, end));
+    remaining.remove_prefix(consumed);
+  }
+}
+
+template <typename K, typename V>
+void InputFileConnector<K, V>::readBinary(const MappedFile &file) {
+  BinaryFileHeader header{};
+  std::memcpy(&header, file.data(), sizeof(header));
+  if (header.version != BINARY_INPUT_VERSION) {
+    throw std::runtime_error("Unsupported binary input version in " + filePath);
+  }
+  std::size_t recordsEnd = sizeof(header) + header.recordCount * header.recordSize;
+  if (header.productTableOffset != recordsEnd ||
+      recordsEnd + header.productCount * sizeof(BinaryProductId) > file.size()) {
+    throw std::runtime_error("Truncated binary input file: " + filePath);
+  }
+
+  std::vector<std::string_view> productIds;
+  productIds.reserve(header.productCount);
+  const char *table = file.data() + header.productTableOffset;
+  for (std::uint32_t i = 0; i < header.productCount; ++i) {
+    const char *id = table + i * sizeof(BinaryProductId);
+    productIds.emplace_back(id, strnlen(id, sizeof(BinaryProductId::id)));
+  }
+  beginBinary(header, productIds);
+
+  std::uint64_t first = 0;
+  if (startOffset > 0) {
+    if (startOffset < sizeof(header) || startOffset > recordsEnd ||
+        (startOffset - sizeof(header)) % header.recordSize != 0) {
+      throw std::runtime_error("Start offset is not on a record boundary in " + filePath);
+    }
+    first = (startOffset - sizeof(header)) / header.recordSize;
+  }
+  const char *record = file.data() + sizeof(header) + first * header.recordSize;
+  for (std::uint64_t i = first; i < header.recordCount; ++i, record += header.recordSize) {
+    offset = sizeof(header) + (i + 1) * header.recordSize;
+    parseBinary(record);
+  }
+}
+
+template <typename K, typename V>
+void InputFileConnector<K, V>::beginBinary(const BinaryFileHeader &header,
+                                           const std::vector<std::string_view> &productIds) {
+  throw std::runtime_error("Binary input is not supported for " + filePath);
+}
+
+template <typename K, typename V>
+void InputFileConnector<K, V>::parseBinary(const char *record) {
+  throw std::runtime_error("Binary input is not supported for " + filePath);
+}
+
+template <typename K, typename V>
+void InputFileConnector<K, V>::dispatch(std::string_view line) {
+  if (line.empty()) {
+    return;
+  }
+  fields.split(line, ',');
+  parse(line, fields);
+}
+
+// ------------- Definition: ChunkedInputFileConnector -------------
+
+template <typename K, typename V>
+ChunkedInputFileConnector<K, V>::ChunkedInputFileConnector(const std::string &filePath,
+                                                           Service<K, V> *connectedService, ReadMode readMode)
+    : InputFileConnector<K, V>(filePath, connectedService, readMode) {}
+
+template <typename K, typename V>
+void ChunkedInputFileConnector<K, V>::parse(std::string_view line, const FieldSpans &fields) {
+  V data = decode(line, fields);
+  deliver(data);
+}
+
+template <typename K, typename V>
+void ChunkedInputFileConnector<K, V>::deliver(V &data) {
+  dispatchMessage(this->connectedService, data);
+}
+
+template <typename K, typename V>
+void ChunkedInputFileConnector<K, V>::readParallel(std::size_t workers, std::size_t chunkBytes) {
+  workers = std::max<std::size_t>(workers, 1);
+  chunkBytes = std::max<std::size_t>(chunkBytes, 1);
+  MappedFile file(this->GetFilePath());
+  if (isBinaryInput(file.data(), file.size())) {
+    // Pre-parsed records need no decoding, so there is nothing to spread over workers.
+    this->readBinary(file);
+    return;
+  }
+  std::string_view remaining = this->unreadText(file);
+
+  // Worker w decodes chunk w of a round into records[w]. There are two rounds, so
+  // the workers can fill one while the calling thread delivers the other.
+  struct Round {
+    std::vector<std::string_view> chunks;
+    std::vector<std::vector<Decoded>> records;
+    std::vector<std::exception_ptr> errors;
+  };
+  Round rounds[2];
+  for (Round &round : rounds) {
+    round.records.resize(workers);
+    round.errors.resize(workers);
+  }
+
+  std::mutex mutex;
+  std::condition_variable roundIssued, roundDecoded;
+  std::size_t issued = 0;   // rounds handed to the workers; round i uses rounds[i % 2]
+  std::size_t decoding = 0; // workers still busy with the latest round
+  bool stopping = false;
+
+  std::vector<std::thread> pool;
+  auto stopPool = [&]() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    roundIssued.notify_all();
+    for (std::thread &thread : pool) {
+      thread.join();
+    }
+    pool.clear();
+  };
+  for (std::size_t w = 0; w < workers; ++w) {
+    pool.emplace_back([this, &file, &rounds, &mutex, &roundIssued, &roundDecoded, &issued, &decoding, &stopping, w]() {
+      std::size_t seen = 0;
+      while (true) {
+        Round *round;
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          roundIssued.wait(lock, [&]() { return stopping || issued > seen; });
+          if (issued == seen) {
+            return;
+          }
+          round = &rounds[seen++ % 2];
+        }
+        if (w < round->chunks.size()) {
+          try {
+            decodeChunk(round->chunks[w], static_cast<std::size_t>(round->chunks[w].data() - file.data()),
+                        round->records[w]);
+          } catch (...) {
+            round->errors[w] = std::current_exception();
+          }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--decoding == 0) {
+          roundDecoded.notify_one();
+        }
+      }
+    });
+  }
+
+  // Cut up to one chunk per worker, each ending on a line boundary, and wake the workers.
+  auto issue = [&]() {
+    Round &round = rounds[issued % 2];
+    round.chunks.clear();
+    while (round.chunks.size() < workers && !remaining.empty()) {
+      std::size_t end = chunkBytes < remaining.size() ? remaining.find('\n', chunkBytes) : std::string_view::npos;
+      end = end == std::string_view::npos ? remaining.size() : end + 1;
+      round.chunks.push_back(remaining.substr(0, end));
+      remaining.remove_prefix(end);
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      decoding = workers;
+      ++issued;
+    }
+    roundIssued.notify_all();
+  };
+
+  try {
+    if (!remaining.empty()) {
+      issue();
+    }
+    for (std::size_t delivered = 0; delivered < issued; ++delivered) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        roundDecoded.wait(lock, [&]() { return decoding == 0; });
+      }
+      Round &round = rounds[delivered % 2];
+      for (auto &error : round.errors) {
+        if (error) {
+          std::rethrow_exception(error);
+        }
+      }
+      if (!remaining.empty()) {
+        issue();
+      }
+      for (std::size_t w = 0; w < round.chunks.size(); ++w) {
+        for (Decoded &record : round.records[w]) {
+          this->setOffset(record.end);
+          deliver(record.data);
+        }
+        round.records[w].clear();
+      }
+    }
+  } catch (...) {
+    stopPool();
+    throw;
+  }
+  stopPool();
+}
+
+template <typename K, typename V>
+void ChunkedInputFileConnector<K, V>::decodeChunk(std::string_view chunk, std::size_t chunkOffset,
+                                                  std::vector<Decoded> &records) {
+  FieldSpans fields;
+  std::size_t offset = 0;
+  while (offset < chunk.size()) {
+    std::size_t end = chunk.find('\n', offset);
+    end = end == std::string_view::npos ? chunk.size() : end;
+    std::string_view line = chunk.substr(offset, end - offset);
+    if (!line.empty()) {
+      fields.split(line, ',');
+      records.push_back(Decoded{chunkOffset + std::min(end + 1, chunk.size()), decode(line, fields)});
+    }
+    offset = end + 1;
   }
 }
 
@@ -72,25 +586,29 @@ void InputFileConnector<K, V>::read() {
 
 template <typename V>
 OutputFileConnector<V>::OutputFileConnector(const std::string &filePath)
-    : filePath(filePath) {
-      append("", true);
-    }
+    : filePath(filePath), writer(std::make_unique<AsyncFileWriter>(filePath)) {}
 
 template <typename V>
 void OutputFileConnector<V>::Publish(V &data) {
-  append(toString(data), false);
+  char buffer[MAX_RECORD_BYTES];
+  RecordWriter record(buffer, sizeof(buffer));
+  format(data, record);
+  if (!record.View().empty()) {
+    writer->WriteLine(record.View());
+  }
 }
 
 template <typename V>
-void OutputFileConnector<V>::append(std::string line, bool clearFile) {
-  std::ofstream outFile;
-  outFile.open(filePath, clearFile ? std::ios_base::out : std::ios_base::app);
-  if (!outFile) {
-    throw std::runtime_error("Unable to open file: " + filePath);
-  }
-  if (line != "") 
-    outFile << line << std::endl;
-  outFile.close();
+std::string OutputFileConnector<V>::toString(V &data) {
+  char buffer[MAX_RECORD_BYTES];
+  RecordWriter record(buffer, sizeof(buffer));
+  format(data, record);
+  return std::string(record.View());
+}
+
+template <typename V>
+void OutputFileConnector<V>::Flush() {
+  writer->Flush();
 }
 
 // ------------- Definition: Utility Functions -------------
@@ -105,13 +623,36 @@ std::vector<std::string> splitString(std::string input, char delim) {
   return result;
 }
 
-double fractionalToDouble(std::string price) {
-  auto split = splitString(price, '-');
-  if (split.size() != 2) {
+double fractionalToDouble(std::string_view price) {
+  std::size_t dash = price.find('-');
+  if (dash == std::string_view::npos || price.find('-', dash + 1) != std::string_view::npos) {
     return 0.0;
   }
-  return std::stod(split[0]) +
-         std::stod(split[1].substr(0, 2)) / 32.0 +
-         ((split[1][2] == '+') ? 4 : (split[1][2] - '0')) / 256.0;
+  // The fraction is two digits of 32nds and one of 256ths, "+" meaning 4.
+  std::string_view fraction = price.substr(dash + 1);
+  if (fraction.size() != 3 || (fraction[2] != '+' && (fraction[2] < '0' || fraction[2] > '7'))) {
+    throw std::runtime_error("Malformed fractional price: " + std::string(price));
+  }
+  return parseDouble(price.substr(0, dash)) +
+         parseDouble(fraction.substr(0, 2)) / 32.0 +
+         ((fraction[2] == '+') ? 4 : (fraction[2] - '0')) / 256.0;
+}
+
+long parseLong(std::string_view field) {
+  long value = 0;
+  auto result = std::from_chars(field.data(), field.data() + field.size(), value);
+  if (result.ec != std::errc() || result.ptr != field.data() + field.size()) {
+    throw std::runtime_error("Malformed integer field: " + std::string(field));
+  }
+  return value;
+}
+
+double parseDouble(std::string_view field) {
+  double value = 0.0;
+  auto result = std::from_chars(field.data(), field.data() + field.size(), value);
+  if (result.ec != std::errc() || result.ptr != field.data() + field.size()) {
+    throw std::runtime_error("Malformed decimal field: " + std::string(field));
+  }
+  return value;
 }
 #endif
\ No newline at end of file
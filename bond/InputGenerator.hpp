@@ -0,0 +1,244 @@
+#ifndef BOND_INPUT_GENERATOR_HPP
+#define BOND_INPUT_GENERATOR_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../base/products.hpp"
+
+// ------------- Declaration: InputKind -------------
+
+// The input files of data_generator.py, in its formats. MARKET_DATA_DELTAS is the
+// incremental form of marketdata.txt: each product's first row is a whole book and
+// the rest modify the quantity of one level.
+enum class InputKind { PRICES, MARKET_DATA, TRADES, INQUIRIES, MARKET_DATA_DELTAS };
+
+const char *inputFileName(InputKind kind);
+
+// BY_PRODUCT writes every row of one product before the next, as data_generator.py
+// does. ROUND_ROBIN writes row r of every product before row r + 1.
+enum class InputOrder { BY_PRODUCT, ROUND_ROBIN };
+
+// ------------- Declaration: InputGenerator -------------
+
+// Native replacement for data_generator.py. The first seven products are the
+// treasuries main.cpp registers; the rest are synthetic CUSIPs with maturities
+// spread from 2 to 30 years. Each line is a function of the seed, its product and
+// its row alone, so the output does not depend on the order or on how many threads
+// produce it.
+class InputGenerator {
+public:
+  InputGenerator(std::size_t products, std::uint64_t seed = 1);
+
+  // The bonds the generated lines refer to. Products(n) is a prefix of Products(m) for n < m.
+  static std::vector<Bond> Products(std::size_t count);
+
+  std::size_t GetProducts() const;
+
+  // rowsPerProduct lines for every product, generated on up to `threads` threads.
+  std::string Generate(InputKind kind, std::size_t rowsPerProduct, InputOrder order, std::size_t threads) const;
+
+private:
+  // Deterministic stream of random numbers for one line.
+  class LineRandom {
+  public:
+    explicit LineRandom(std::uint64_t state);
+    std::uint64_t Next();
+    // Uniform in [low, high].
+    int Between(int low, int high);
+
+  private:
+    std::uint64_t state;
+  };
+
+  // Append row `row` of a product, the line'th line in product-major order, with its newline.
+  void appendLine(InputKind kind, std::size_t product, std::size_t row, std::size_t line, std::string &out) const;
+
+  LineRandom lineRandom(InputKind kind, std::size_t product, std::size_t row) const;
+
+  static void appendFractional(std::int64_t twoFiftySixths, std::string &out);
+
+  std::vector<std::string> productIds;
+  std::uint64_t seed;
+};
+
+// ------------- Definition: InputKind -------------
+
+const char *inputFileName(InputKind kind) {
+  switch (kind) {
+    case InputKind::PRICES: return "prices.txt";
+    case InputKind::MARKET_DATA:
+    case InputKind::MARKET_DATA_DELTAS: return "marketdata.txt";
+    case InputKind::TRADES: return "trades.txt";
+    case InputKind::INQUIRIES: return "inquiries.txt";
+  }
+  return "";
+}
+
+// ------------- Definition: InputGenerator -------------
+
+InputGenerator::InputGenerator(std::size_t products, std::uint64_t seed) : seed(seed) {
+  for (const Bond &bond : Products(products)) {
+    productIds.push_back(bond.GetProductId());
+  }
+}
+
+std::vector<Bond> InputGenerator::Products(std::size_t count) {
+  static const Bond TREASURIES[] = {
+      Bond("91282CME8", CUSIP, "T", 4., date(2026, Nov, 30), 0.019063),
+      Bond("91282CMB4", CUSIP, "T", 4., date(2027, Dec, 15), 0.028002),
+      Bond("91282CMD0", CUSIP, "T", 4., date(2029, Dec, 31), 0.044902),
+      Bond("91282CMC2", CUSIP, "T", 4., date(2031, Dec, 31), 0.060510),
+      Bond("91282CLW9", CUSIP, "T", 4., date(2034, Nov, 15), 0.081718),
+      Bond("912810UF3", CUSIP, "T", 4., date(2044, Nov, 15), 0.136657),
+      Bond("912810UE6", CUSIP, "T", 4., date(2054, Nov, 15), 0.173594),
+  };
+  constexpr std::size_t SYNTHETIC_LIMIT = 100000;
+  if (count > std::size(TREASURIES) + SYNTHETIC_LIMIT) {
+    throw std::runtime_error("Too many products to generate: " + std::to_string(count));
+  }
+
+  std::vector<Bond> bonds;
+  for (std::size_t i = 0; i < count; ++i) {
+    if (i < std::size(TREASURIES)) {
+      bonds.push_back(TREASURIES[i]);
+      continue;
+    }
+    // "912" and five digits, then the CUSIP check digit. All-digit ids never clash with the treasuries.
+    std::string id = std::to_string(SYNTHETIC_LIMIT + i - std::size(TREASURIES));
+    id = "912" + id.substr(1);
+    int sum = 0;
+    for (std::size_t c = 0; c < id.size(); ++c) {
+      int value = (id[c] - '0') * (c % 2 == 1 ? 2 : 1);
+      sum += value / 10 + value % 10;
+    }
+    id += static_cast<char>('0' + (10 - sum % 10) % 10);
+    int years = 2 + static_cast<int>(i % 29);
+    bonds.emplace_back(id, CUSIP, "T", 4., date(2025 + years, Nov, 15), 0.0058 * years);
+  }
+  return bonds;
+}
+
+std::size_t InputGenerator::GetProducts() const {
+  return productIds.size();
+}
+
+void InputGenerator::appendLine(InputKind kind, std::size_t product, std::size_t row, std::size_t line,
+                                std::string &out) const {
+  LineRandom random = lineRandom(kind, product, row);
+  out += productIds[product];
+  if (kind == InputKind::MARKET_DATA_DELTAS && row > 0) {
+    // Keep the snapshot's prices, so the book stays ordered, and change one level's quantity.
+    std::int64_t mid = lineRandom(kind, product, 0).Between(99 * 256, 101 * 256);
+    std::int64_t spread = 2, level = random.Between(0, 4);
+    bool bid = random.Between(0, 1) == 0;
+    out += bid ? ",M,B," : ",M,O,";
+    out += std::to_string(level);
+    out += ',';
+    appendFractional(bid ? mid - spread / 2 - level : mid + spread / 2 + level, out);
+    out += ',';
+    out += std::to_string(random.Between(1, 50) * 1000000);
+    out += '\n';
+    return;
+  }
+  switch (kind) {
+    case InputKind::PRICES: {
+      std::int64_t mid = random.Between(99, 100) * 256 + random.Between(0, 31) * 8 + random.Between(0, 7);
+      out += ',';
+      appendFractional(mid, out);
+      out += ",0-00";
+      out += "23+"[random.Between(0, 2)];
+      break;
+    }
+    case InputKind::MARKET_DATA:
+    case InputKind::MARKET_DATA_DELTAS: {
+      static const std::int64_t SPREADS[] = {2, 4, 6, 8, 6, 4};
+      std::int64_t mid = random.Between(99 * 256, 101 * 256);
+      std::int64_t spread = SPREADS[row % std::size(SPREADS)];
+      for (int side = 0; side < 2; ++side) {
+        for (std::int64_t level = 0; level < 5; ++level) {
+          out += ',';
+          appendFractional(side == 0 ? mid - spread / 2 - level : mid + spread / 2 + level, out);
+          out += ',';
+          out += std::to_string((level + 1) * 10000000);
+        }
+      }
+      break;
+    }
+    // The counters data_generator.py carries from line to line run over the product-major line number.
+    case InputKind::TRADES:
+      out += ',' + std::to_string(1734889683009925 + line) + (line % 2 == 0 ? ",99.0" : ",100.0") + ",TRSY" +
+             std::to_string(line % 3 + 1) + ',' + std::to_string((line % 5 + 1) * 1000000) + ',' +
+             std::to_string(line % 2);
+      break;
+    case InputKind::INQUIRIES:
+      out += ',' + std::to_string(1734889683010205 + line) + ',' + std::to_string(line % 2) + ',' +
+             std::to_string((line % 5 + 1) * 1000000);
+      break;
+  }
+  out += '\n';
+}
+
+std::string InputGenerator::Generate(InputKind kind, std::size_t rowsPerProduct, InputOrder order,
+                                     std::size_t threads) const {
+  std::size_t lines = productIds.size() * rowsPerProduct;
+  threads = std::max<std::size_t>(1, std::min(threads, lines / 4096 + 1));
+  std::vector<std::string> chunks(threads);
+  auto generateChunk = [&](std::size_t chunk) {
+    std::size_t first = lines * chunk / threads, last = lines * (chunk + 1) / threads;
+    chunks[chunk].reserve((last - first) * (kind == InputKind::MARKET_DATA ? 192 : 48));
+    for (std::size_t i = first; i < last; ++i) {
+      std::size_t product = order == InputOrder::BY_PRODUCT ? i / rowsPerProduct : i % productIds.size();
+      std::size_t row = order == InputOrder::BY_PRODUCT ? i % rowsPerProduct : i / productIds.size();
+      appendLine(kind, product, row, product * rowsPerProduct + row, chunks[chunk]);
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (std::size_t chunk = 1; chunk < threads; ++chunk) {
+    workers.emplace_back(generateChunk, chunk);
+  }
+  generateChunk(0);
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+
+  std::string text = std::move(chunks[0]);
+  for (std::size_t chunk = 1; chunk < threads; ++chunk) {
+    text += chunks[chunk];
+  }
+  return text;
+}
+
+InputGenerator::LineRandom InputGenerator::lineRandom(InputKind kind, std::size_t product, std::size_t row) const {
+  return LineRandom(seed ^ static_cast<std::uint64_t>(kind) << 56 ^ static_cast<std::uint64_t>(product) << 32 ^ row);
+}
+
+InputGenerator::LineRandom::LineRandom(std::uint64_t state) : state(state) {}
+
+std::uint64_t InputGenerator::LineRandom::Next() {
+  // splitmix64
+  std::uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+int InputGenerator::LineRandom::Between(int low, int high) {
+  return low + static_cast<int>(Next() % static_cast<std::uint64_t>(high - low + 1));
+}
+
+void InputGenerator::appendFractional(std::int64_t twoFiftySixths, std::string &out) {
+  std::int64_t thirtySeconds = twoFiftySixths % 256 / 8;
+  std::int64_t eighths = twoFiftySixths % 8;
+  out += std::to_string(twoFiftySixths / 256);
+  out += '-';
+  out += static_cast<char>('0' + thirtySeconds / 10);
+  out += static_cast<char>('0' + thirtySeconds % 10);
+  out += eighths == 4 ? '+' : static_cast<char>('0' + eighths);
+}
+
+#endif
@@ -0,0 +1,361 @@
+#ifndef BOND_LOGGER_HPP
+#define BOND_LOGGER_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+#include "SpscQueue.hpp"
+
+// Log statements below BOND_LOG_LEVEL compile away, arguments included. The build
+// sets it from the BOND_LOG_LEVEL cache variable; a bare compile defaults to DEBUG.
+#define BOND_LOG_DEBUG 0
+#define BOND_LOG_INFO 1
+#define BOND_LOG_WARN 2
+#define BOND_LOG_ERROR 3
+
+#ifndef BOND_LOG_LEVEL
+#define BOND_LOG_LEVEL BOND_LOG_DEBUG
+#endif
+
+// LOG_INFO("Processed ", count, " trades for ", productId);
+//
+// Arguments are written one after another with operator<<, followed by a newline.
+#define BOND_LOG(threshold, level, ...)                        \
+  do {                                                         \
+    if constexpr ((threshold) >= BOND_LOG_LEVEL) {             \
+      Logger::Instance().Log(level, __VA_ARGS__);              \
+    }                                                          \
+  } while (0)
+
+#define LOG_DEBUG(...) BOND_LOG(BOND_LOG_DEBUG, LogLevel::DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) BOND_LOG(BOND_LOG_INFO, LogLevel::INFO, __VA_ARGS__)
+#define LOG_WARN(...) BOND_LOG(BOND_LOG_WARN, LogLevel::WARN, __VA_ARGS__)
+#define LOG_ERROR(...) BOND_LOG(BOND_LOG_ERROR, LogLevel::ERROR, __VA_ARGS__)
+
+// ------------- Declaration: LogLevel -------------
+
+enum class LogLevel { DEBUG, INFO, WARN, ERROR };
+
+// ------------- Declaration: LogText -------------
+
+// A string argument, copied inline into the log record so the caller's string
+// may change or go away before the record is written. Longer text is cut short.
+struct LogText {
+  static constexpr std::size_t CAPACITY = 47;
+
+  explicit LogText(std::string_view text);
+
+  std::uint8_t length;
+  char text[CAPACITY];
+};
+
+std::ostream &operator<<(std::ostream &output, const LogText &text);
+
+// ------------- Declaration: LogChars -------------
+
+// A character array argument, e.g. a string literal, copied whole into the log
+// record, so literals are never cut short. Text ends at the first NUL.
+template <std::size_t N>
+struct LogChars {
+  explicit LogChars(const char (&chars)[N]);
+
+  char text[N];
+};
+
+template <std::size_t N>
+std::ostream &operator<<(std::ostream &output, const LogChars<N> &chars);
+
+// ------------- Declaration: LogArgument -------------
+
+// How a log argument is carried to the writer thread: by value when trivially
+// copyable, character arrays as LogChars, and std::string, std::string_view and
+// character pointers as LogText. Nothing is read from the caller's memory later.
+template <typename T>
+struct LogArgument {
+  static_assert(std::is_trivially_copyable<T>::value && std::is_trivially_destructible<T>::value,
+                "Log arguments must be trivially copyable values or strings");
+  using Type = T;
+  static const T &Capture(const T &value) { return value; }
+};
+
+template <>
+struct LogArgument<std::string> {
+  using Type = LogText;
+  static LogText Capture(std::string_view value) { return LogText(value); }
+};
+
+template <>
+struct LogArgument<std::string_view> {
+  using Type = LogText;
+  static LogText Capture(std::string_view value) { return LogText(value); }
+};
+
+template <>
+struct LogArgument<const char *> {
+  using Type = LogText;
+  static LogText Capture(const char *value) { return LogText(value != nullptr ? value : "(null)"); }
+};
+
+template <>
+struct LogArgument<char *> : LogArgument<const char *> {};
+
+template <std::size_t N>
+struct LogArgument<char[N]> {
+  using Type = LogChars<N>;
+  static LogChars<N> Capture(const char (&value)[N]) { return LogChars<N>(value); }
+};
+
+// ------------- Declaration: Logger -------------
+
+// Process-wide asynchronous logger. A logging thread copies its raw arguments
+// into a queue of its own and returns; one writer thread formats the records
+// and writes them to stdout, flushing whenever it runs out of work. Records
+// from one thread keep their order. A full queue makes the logging thread wait.
+// A thread's queue goes back to a free list when the thread exits, so
+// MAX_THREADS bounds the threads logging at once, not over the process's life.
+// Logging only wakes the writer once it is parking; a record logged just as it
+// parks is written within PARK_TIMEOUT.
+class Logger {
+public:
+  static Logger &Instance();
+  ~Logger();
+  Logger(const Logger &) = delete;
+  Logger &operator=(const Logger &) = delete;
+
+  template <typename... Args>
+  void Log(LogLevel level, const Args &...args);
+
+  // Block until everything logged so far has been written and flushed.
+  void Flush();
+
+private:
+  static constexpr std::size_t PAYLOAD_BYTES = 240;
+  static constexpr std::size_t QUEUE_CAPACITY = 4096;  // records per logging thread
+  static constexpr std::size_t MAX_THREADS = 64;
+  static constexpr std::chrono::milliseconds PARK_TIMEOUT{10};
+
+  struct Record {
+    LogLevel level;
+    void (*format)(const unsigned char *payload, std::ostream &output);
+    alignas(std::max_align_t) unsigned char payload[PAYLOAD_BYTES];
+  };
+
+  using RecordQueue = SpscQueue<Record>;
+
+  // A logging thread's claim on a queue, given back when the thread exits.
+  struct ThreadQueue {
+    Logger *logger = nullptr;
+    RecordQueue *queue = nullptr;
+    ~ThreadQueue();
+  };
+
+  Logger();
+
+  RecordQueue &threadQueue();
+  RecordQueue &registerThread();
+  void releaseQueue(RecordQueue *queue);
+  void run();
+  bool pending() const;
+
+  template <typename Captured>
+  static void formatRecord(const unsigned char *payload, std::ostream &output);
+
+  std::ostream &output;
+
+  std::mutex registration;
+  std::vector<std::unique_ptr<RecordQueue>> ownedQueues;
+  std::vector<RecordQueue *> freeQueues;
+  std::array<std::atomic<RecordQueue *>, MAX_THREADS> queues;
+  std::atomic<std::size_t> queueCount;
+
+  Parker parker;
+  alignas(64) std::atomic<bool> unflushed;
+  std::atomic<bool> running;
+  std::thread writer;
+};
+
+// ------------- Definition: LogText -------------
+
+LogText::LogText(std::string_view text) {
+  length = static_cast<std::uint8_t>(std::min(text.size(), CAPACITY));
+  std::memcpy(this->text, text.data(), length);
+  if (text.size() > CAPACITY) {
+    std::memcpy(this->text + CAPACITY - 3, "...", 3);
+  }
+}
+
+std::ostream &operator<<(std::ostream &output, const LogText &text) {
+  return output.write(text.text, text.length);
+}
+
+// ------------- Definition: LogChars -------------
+
+template <std::size_t N>
+LogChars<N>::LogChars(const char (&chars)[N]) {
+  std::memcpy(text, chars, N);
+}
+
+template <std::size_t N>
+std::ostream &operator<<(std::ostream &output, const LogChars<N> &chars) {
+  return output.write(chars.text, static_cast<std::streamsize>(strnlen(chars.text, N)));
+}
+
+// ------------- Definition: Logger -------------
+
+Logger &Logger::Instance() {
+  static Logger logger;
+  return logger;
+}
+
+Logger::Logger() : output(std::cout), queueCount(0), unflushed(false), running(true) {
+  for (auto &queue : queues) {
+    queue.store(nullptr, std::memory_order_relaxed);
+  }
+  writer = std::thread(&Logger::run, this);
+}
+
+Logger::~Logger() {
+  running.store(false, std::memory_order_release);
+  parker.Unpark();
+  writer.join();
+}
+
+template <typename... Args>
+void Logger::Log(LogLevel level, const Args &...args) {
+  using Captured = std::tuple<typename LogArgument<std::remove_cv_t<Args>>::Type...>;
+  static_assert(sizeof(Captured) <= PAYLOAD_BYTES, "Too many log arguments for one record");
+  static_assert(alignof(Captured) <= alignof(std::max_align_t), "Log argument alignment too large");
+
+  auto produce = [&](std::optional<Record> &slot) {
+    if (!slot) {
+      slot.emplace();
+    }
+    slot->level = level;
+    slot->format = &formatRecord<Captured>;
+    new (slot->payload) Captured(LogArgument<std::remove_cv_t<Args>>::Capture(args)...);
+  };
+  RecordQueue &queue = threadQueue();
+  while (!queue.TryProduce(produce)) {
+    parker.Unpark();
+    std::this_thread::yield();
+  }
+  parker.UnparkIfParked();
+}
+
+void Logger::Flush() {
+  while (pending() || unflushed.load(std::memory_order_acquire)) {
+    parker.Unpark();
+    std::this_thread::yield();
+  }
+}
+
+Logger::ThreadQueue::~ThreadQueue() {
+  if (queue != nullptr) {
+    logger->releaseQueue(queue);
+  }
+}
+
+Logger::RecordQueue &Logger::threadQueue() {
+  thread_local ThreadQueue claim;
+  if (claim.queue == nullptr) {
+    claim.queue = &registerThread();
+    claim.logger = this;
+  }
+  return *claim.queue;
+}
+
+Logger::RecordQueue &Logger::registerThread() {
+  std::lock_guard<std::mutex> lock(registration);
+  if (!freeQueues.empty()) {
+    // The previous owner has exited, so this thread becomes the queue's only producer.
+    // Records it left are still drained by the writer, ahead of the new ones.
+    RecordQueue *queue = freeQueues.back();
+    freeQueues.pop_back();
+    return *queue;
+  }
+  std::size_t index = queueCount.load(std::memory_order_relaxed);
+  if (index == MAX_THREADS) {
+    throw std::runtime_error("Too many logging threads");
+  }
+  ownedQueues.push_back(std::make_unique<RecordQueue>(QUEUE_CAPACITY));
+  queues[index].store(ownedQueues.back().get(), std::memory_order_relaxed);
+  queueCount.store(index + 1, std::memory_order_release);
+  return *ownedQueues.back();
+}
+
+void Logger::releaseQueue(RecordQueue *queue) {
+  std::lock_guard<std::mutex> lock(registration);
+  freeQueues.push_back(queue);
+}
+
+void Logger::run() {
+  auto write = [this](Record &record) {
+    // Set before the record is released, so Flush() never sees an empty queue
+    // while the record's text is still unflushed.
+    unflushed.store(true, std::memory_order_relaxed);
+    if (record.level == LogLevel::WARN) {
+      output << "WARN: ";
+    } else if (record.level == LogLevel::ERROR) {
+      output << "ERROR: ";
+    }
+    record.format(record.payload, output);
+    output << '\n';
+  };
+  while (true) {
+    bool stopping = !running.load(std::memory_order_acquire);
+    bool wrote = false;
+    std::size_t count = queueCount.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i < count; ++i) {
+      RecordQueue &queue = *queues[i].load(std::memory_order_relaxed);
+      while (queue.TryConsume(write)) {
+        wrote = true;
+      }
+    }
+    if (wrote) {
+      continue;
+    }
+    if (unflushed.load(std::memory_order_relaxed)) {
+      output.flush();
+      unflushed.store(false, std::memory_order_release);
+    }
+    if (stopping) {
+      // Everything logged before shutdown has now been written.
+      return;
+    }
+    parker.Park([this]() { return pending() || !running.load(std::memory_order_acquire); }, PARK_TIMEOUT);
+  }
+}
+
+bool Logger::pending() const {
+  std::size_t count = queueCount.load(std::memory_order_acquire);
+  for (std::size_t i = 0; i < count; ++i) {
+    if (queues[i].load(std::memory_order_relaxed)->Size() > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename Captured>
+void Logger::formatRecord(const unsigned char *payload, std::ostream &output) {
+  const Captured &arguments = *std::launder(reinterpret_cast<const Captured *>(payload));
+  std::apply([&output](const auto &...argument) { (output << ... << argument); }, arguments);
+}
+
+#endif
@@ -0,0 +1,320 @@
+#ifndef BOND_MULTICAST_RING_HPP
+#define BOND_MULTICAST_RING_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+#include "../base/soa.hpp"
+#include "Recycle.hpp"
+#include "ServiceStats.hpp"
+#include "SpscQueue.hpp"
+
+// ------------- Declaration: SlowConsumerPolicy -------------
+
+// What a multicast ring does when a consumer falls a full ring behind:
+// BACKPRESSURE makes the producer wait for it; DROP lets the producer lap it,
+// and the consumer skips ahead past the events it lost.
+enum class SlowConsumerPolicy { BACKPRESSURE, DROP };
+
+struct MulticastConsumerOptions {
+  SlowConsumerPolicy policy = SlowConsumerPolicy::BACKPRESSURE;
+  WaitStrategy waitStrategy = WaitStrategy::PARK;
+  int cpu = -1;  // pin the consumer thread to this CPU, or -1 to leave it to the scheduler
+};
+
+struct MulticastConsumerStats {
+  std::uint64_t processed = 0;
+  std::uint64_t dropped = 0;  // events lapped before the consumer reached them
+  std::uint64_t lag = 0;      // events published but not yet processed
+};
+
+// ------------- Declaration: MulticastRing -------------
+
+// Single-producer, multi-consumer sequenced ring in the style of the LMAX
+// Disruptor. The producer copies each event into the next slot once; every
+// consumer runs on a thread of its own, tracks its own sequence and hands the
+// slot to its listener in place. A consumer never waits for another one.
+//
+// The ring is itself a ServiceListener, so it can be added to the producing
+// service in place of the listeners it fans out to. Add every consumer before
+// the first event. ProcessAdd/ProcessUpdate must always come from one thread.
+// An exception thrown by a consumer's listener is rethrown to the producer on
+// its next event or Drain(), and that consumer drops the events after it.
+template <typename T>
+class MulticastRing : public ServiceListener<T> {
+public:
+  // Capacity is rounded up to a power of two.
+  explicit MulticastRing(std::size_t capacity);
+  ~MulticastRing();
+  MulticastRing(const MulticastRing &) = delete;
+  MulticastRing &operator=(const MulticastRing &) = delete;
+
+  // Returns the consumer's index for GetStats().
+  std::size_t AddConsumer(ServiceListener<T> *listener, MulticastConsumerOptions options = MulticastConsumerOptions());
+
+  void ProcessAdd(T &data) override;
+  void ProcessRemove(T &data) override;
+  void ProcessUpdate(T &data) override;
+
+  // Block until every consumer has processed or dropped everything published so far.
+  void Drain();
+
+  MulticastConsumerStats GetStats(std::size_t consumer) const;
+  std::size_t ConsumerCount() const;
+
+private:
+  enum class EventType { ADD, REMOVE, UPDATE };
+
+  struct Entry {
+    EventType type = EventType::ADD;
+    std::optional<T> data;
+  };
+
+  static constexpr std::uint64_t NOT_READING = std::numeric_limits<std::uint64_t>::max();
+  static constexpr std::chrono::milliseconds PARK_TIMEOUT{100};
+
+  struct Consumer {
+    ServiceListener<T> *listener;
+    MulticastConsumerOptions options;
+    // Everything before sequence has been processed or dropped.
+    alignas(64) std::atomic<std::uint64_t> sequence{0};
+    // Sequence being handed to the listener, for DROP consumers.
+    std::atomic<std::uint64_t> reading{NOT_READING};
+    std::atomic<std::uint64_t> dropped{0};
+    std::atomic<std::uint64_t> processed{0};
+    // Set by the consumer thread once its listener has thrown.
+    std::exception_ptr error;
+    std::atomic<bool> failed{false};
+    Parker parker;
+    std::thread thread;
+  };
+
+  void publish(EventType type, T &data);
+  void run(Consumer &consumer);
+  void wait(Consumer &consumer);
+  void checkError() const;
+
+  std::size_t capacity;
+  std::unique_ptr<Entry[]> entries;
+  std::vector<std::unique_ptr<Consumer>> consumers;
+
+  // Sequences claimed by the producer; the slot of claimed - 1 may be mid-write.
+  alignas(64) std::atomic<std::uint64_t> claimed;
+  // Sequences fully written and visible to consumers.
+  alignas(64) std::atomic<std::uint64_t> published;
+  std::atomic<bool> running;
+};
+
+// ------------- Definition: MulticastRing -------------
+
+template <typename T>
+MulticastRing<T>::MulticastRing(std::size_t capacity) : capacity(1), claimed(0), published(0), running(true) {
+  while (this->capacity < std::max<std::size_t>(capacity, 2)) {
+    this->capacity <<= 1;
+  }
+  entries.reset(new Entry[this->capacity]);
+}
+
+template <typename T>
+MulticastRing<T>::~MulticastRing() {
+  running.store(false, std::memory_order_release);
+  for (auto &consumer : consumers) {
+    consumer->parker.Unpark();
+    consumer->thread.join();
+  }
+}
+
+template <typename T>
+std::size_t MulticastRing<T>::AddConsumer(ServiceListener<T> *listener, MulticastConsumerOptions options) {
+  if (claimed.load(std::memory_order_relaxed) != 0) {
+    throw std::runtime_error("Consumers must be added before the first event");
+  }
+  consumers.push_back(std::make_unique<Consumer>());
+  Consumer &consumer = *consumers.back();
+  consumer.listener = listener;
+  consumer.options = options;
+  consumer.thread = std::thread(&MulticastRing::run, this, std::ref(consumer));
+  if (options.cpu >= 0) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(options.cpu, &cpus);
+    if (pthread_setaffinity_np(consumer.thread.native_handle(), sizeof(cpus), &cpus) != 0) {
+      throw std::runtime_error("Unable to pin ring consumer to CPU " + std::to_string(options.cpu));
+    }
+  }
+  return consumers.size() - 1;
+}
+
+template <typename T>
+void MulticastRing<T>::ProcessAdd(T &data) {
+  publish(EventType::ADD, data);
+}
+
+template <typename T>
+void MulticastRing<T>::ProcessRemove(T &data) {
+  publish(EventType::REMOVE, data);
+}
+
+template <typename T>
+void MulticastRing<T>::ProcessUpdate(T &data) {
+  publish(EventType::UPDATE, data);
+}
+
+template <typename T>
+void MulticastRing<T>::publish(EventType type, T &data) {
+  checkError();
+  std::uint64_t sequence = claimed.load(std::memory_order_relaxed);
+  claimed.store(sequence + 1, std::memory_order_seq_cst);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  // The slot last held sequence - capacity; wait until no consumer still needs it.
+  if (sequence >= capacity) {
+    std::uint64_t previous = sequence - capacity;
+    for (auto &consumer : consumers) {
+      if (consumer->options.policy == SlowConsumerPolicy::BACKPRESSURE) {
+        while (consumer->sequence.load(std::memory_order_acquire) <= previous) {
+          consumer->parker.Unpark();
+          std::this_thread::yield();
+        }
+      } else {
+        // A lapped consumer skips the slot unless it was already inside it,
+        // in which case the producer waits for that one event to finish.
+        while (consumer->reading.load(std::memory_order_acquire) == previous) {
+          std::this_thread::yield();
+        }
+      }
+    }
+  }
+
+  Entry &entry = entries[sequence & (capacity - 1)];
+  entry.type = type;
+  recycleInto(entry.data, data);
+  published.store(sequence + 1, std::memory_order_release);
+
+  for (auto &consumer : consumers) {
+    if (consumer->options.waitStrategy == WaitStrategy::PARK) {
+      consumer->parker.Unpark();
+    }
+  }
+}
+
+template <typename T>
+void MulticastRing<T>::run(Consumer &consumer) {
+  std::uint64_t next = 0;
+  while (true) {
+    bool stopping = !running.load(std::memory_order_acquire);
+    if (next == published.load(std::memory_order_acquire)) {
+      if (stopping) {
+        // Everything published before shutdown has now been handled.
+        return;
+      }
+      wait(consumer);
+      continue;
+    }
+
+    if (consumer.options.policy == SlowConsumerPolicy::DROP) {
+      consumer.reading.store(next, std::memory_order_seq_cst);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      std::uint64_t claim = claimed.load(std::memory_order_relaxed);
+      if (claim > next + capacity) {
+        // Lapped: the slot already holds, or is being given, a newer event.
+        std::uint64_t oldest = claim - capacity;
+        consumer.dropped.fetch_add(oldest - next, std::memory_order_relaxed);
+        consumer.reading.store(NOT_READING, std::memory_order_release);
+        next = oldest;
+        consumer.sequence.store(next, std::memory_order_release);
+        continue;
+      }
+    }
+
+    Entry &entry = entries[next & (capacity - 1)];
+    if (!consumer.failed.load(std::memory_order_relaxed)) {
+      try {
+        switch (entry.type) {
+          case EventType::ADD: dispatchAdd(consumer.listener, *entry.data); break;
+          case EventType::REMOVE: dispatchRemove(consumer.listener, *entry.data); break;
+          case EventType::UPDATE: dispatchUpdate(consumer.listener, *entry.data); break;
+        }
+      } catch (...) {
+        consumer.error = std::current_exception();
+        consumer.failed.store(true, std::memory_order_release);
+      }
+    }
+    next++;
+    consumer.processed.fetch_add(1, std::memory_order_relaxed);
+    consumer.sequence.store(next, std::memory_order_release);
+    if (consumer.options.policy == SlowConsumerPolicy::DROP) {
+      consumer.reading.store(NOT_READING, std::memory_order_release);
+    }
+  }
+}
+
+template <typename T>
+void MulticastRing<T>::wait(Consumer &consumer) {
+  switch (consumer.options.waitStrategy) {
+    case WaitStrategy::BUSY_SPIN:
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#endif
+      break;
+    case WaitStrategy::YIELD:
+      std::this_thread::yield();
+      break;
+    case WaitStrategy::PARK: {
+      std::uint64_t next = consumer.sequence.load(std::memory_order_relaxed);
+      consumer.parker.Park([this, next]() {
+        return published.load(std::memory_order_acquire) != next || !running.load(std::memory_order_acquire);
+      }, PARK_TIMEOUT);
+      break;
+    }
+  }
+}
+
+template <typename T>
+void MulticastRing<T>::Drain() {
+  std::uint64_t target = published.load(std::memory_order_relaxed);
+  for (auto &consumer : consumers) {
+    while (consumer->sequence.load(std::memory_order_acquire) < target) {
+      consumer->parker.Unpark();
+      std::this_thread::yield();
+    }
+  }
+  checkError();
+}
+
+template <typename T>
+void MulticastRing<T>::checkError() const {
+  for (const auto &consumer : consumers) {
+    if (consumer->failed.load(std::memory_order_acquire)) {
+      std::rethrow_exception(consumer->error);
+    }
+  }
+}
+
+template <typename T>
+MulticastConsumerStats MulticastRing<T>::GetStats(std::size_t consumer) const {
+  const Consumer &state = *consumers.at(consumer);
+  MulticastConsumerStats stats;
+  stats.processed = state.processed.load(std::memory_order_relaxed);
+  stats.dropped = state.dropped.load(std::memory_order_relaxed);
+  stats.lag = published.load(std::memory_order_acquire) - state.sequence.load(std::memory_order_acquire);
+  return stats;
+}
+
+template <typename T>
+std::size_t MulticastRing<T>::ConsumerCount() const {
+  return consumers.size();
+}
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef BOND_RECORD_WRITER_HPP
+#define BOND_RECORD_WRITER_HPP
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include "../base/ticks.hpp"
+#include "Clock.hpp"
+
+// ------------- Declaration: RecordWriter -------------
+
+// Appends comma-separated fields to a caller-provided buffer without allocating.
+// Numbers print the way an ostream with default flags prints them, so records
+// stay byte-compatible with the iostream formatting they replace.
+class RecordWriter {
+public:
+  RecordWriter(char *buffer, std::size_t capacity);
+
+  // Append the current UTC time as a field.
+  RecordWriter &Timestamp();
+
+  RecordWriter &Field(std::string_view value);
+  RecordWriter &Field(const char *value);
+  RecordWriter &Field(double value);
+  RecordWriter &Field(Ticks value);
+  RecordWriter &Field(bool value);
+
+  // Integers and enums print as their numeric value.
+  template <typename N, typename std::enable_if<std::is_integral<N>::value || std::is_enum<N>::value, int>::type = 0>
+  RecordWriter &Field(N value);
+
+  // Append raw text with no separator.
+  RecordWriter &Append(std::string_view text);
+
+  std::string_view View() const;
+
+private:
+  char *separate(std::size_t reserve);
+  void advance(std::to_chars_result result);
+
+  char *begin;
+  char *position;
+  char *end;
+  bool hasFields;
+};
+
+// ------------- Definition: RecordWriter -------------
+
+RecordWriter::RecordWriter(char *buffer, std::size_t capacity)
+    : begin(buffer), position(buffer), end(buffer + capacity), hasFields(false) {}
+
+RecordWriter &RecordWriter::Timestamp() {
+  thread_local TimestampFormatter formatter;
+  char *out = separate(TimestampFormatter::MAX_LENGTH);
+  position = out + formatter.FormatNow(out);
+  return *this;
+}
+
+RecordWriter &RecordWriter::Field(std::string_view value) {
+  char *out = separate(value.size());
+  std::memcpy(out, value.data(), value.size());
+  position = out + value.size();
+  return *this;
+}
+
+RecordWriter &RecordWriter::Field(const char *value) {
+  return Field(std::string_view(value));
+}
+
+RecordWriter &RecordWriter::Field(double value) {
+  // ostream's default is %g with a precision of 6.
+  char *out = separate(0);
+  advance(std::to_chars(out, end, value, std::chars_format::general, 6));
+  return *this;
+}
+
+RecordWriter &RecordWriter::Field(Ticks value) {
+  return Field(value.ToDouble());
+}
+
+RecordWriter &RecordWriter::Field(bool value) {
+  return Field(value ? 1 : 0);
+}
+
+template <typename N, typename std::enable_if<std::is_integral<N>::value || std::is_enum<N>::value, int>::type>
+RecordWriter &RecordWriter::Field(N value) {
+  char *out = separate(0);
+  if constexpr (std::is_enum<N>::value) {
+    advance(std::to_chars(out, end, static_cast<typename std::underlying_type<N>::type>(value)));
+  } else {
+    advance(std::to_chars(out, end, value));
+  }
+  return *this;
+}
+
+RecordWriter &RecordWriter::Append(std::string_view text) {
+  if (static_cast<std::size_t>(end - position) < text.size()) {
+    throw std::length_error("Record exceeds its buffer");
+  }
+  std::memcpy(position, text.data(), text.size());
+  position += text.size();
+  hasFields = true;
+  return *this;
+}
+
+std::string_view RecordWriter::View() const {
+  return std::string_view(begin, static_cast<std::size_t>(position - begin));
+}
+
+char *RecordWriter::separate(std::size_t reserve) {
+  std::size_t needed = reserve + (hasFields ? 1 : 0);
+  if (static_cast<std::size_t>(end - position) < needed) {
+    throw std::length_error("Record exceeds its buffer");
+  }
+  if (hasFields) {
+    *position++ = ',';
+  }
+  hasFields = true;
+  return position;
+}
+
+void RecordWriter::advance(std::to_chars_result result) {
+  if (result.ec != std::errc()) {
+    throw std::length_error("Record exceeds its buffer");
+  }
+  position = result.ptr;
+}
+
+#endif
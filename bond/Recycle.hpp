@@ -0,0 +1,23 @@
+#ifndef BOND_RECYCLE_HPP
+#define BOND_RECYCLE_HPP
+
+#include <optional>
+#include <type_traits>
+
+// Put value in slot. A value already there is copied over when V allows it, so
+// strings, vectors and maps it owns keep their heap storage instead of
+// reallocating on every event. Returns whether the slot was empty.
+template <typename V>
+bool recycleInto(std::optional<V> &slot, const V &value) {
+  if constexpr (std::is_copy_assignable<V>::value) {
+    if (slot) {
+      *slot = value;
+      return false;
+    }
+  }
+  bool added = !slot.has_value();
+  slot.emplace(value);
+  return added;
+}
+
+#endif
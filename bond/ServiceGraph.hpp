@@ -0,0 +1,243 @@
+#ifndef BOND_SERVICE_GRAPH_HPP
+#define BOND_SERVICE_GRAPH_HPP
+
+#include "BondPricingService.hpp"
+#include "BondAlgoStreamingService.hpp"
+#include "BondStreamingService.hpp"
+#include "BondInquiryService.hpp"
+#include "BondTradeBookingService.hpp"
+#include "BondPositionService.hpp"
+#include "BondRiskService.hpp"
+#include "BondMarketDataService.hpp"
+#include "BondAlgoExecutionService.hpp"
+#include "BondExecutionService.hpp"
+#include "GUIService.hpp"
+#include "StateSnapshot.hpp"
+#include "StaticPipeline.hpp"
+#include "AsyncServiceListener.hpp"
+#include "MulticastRing.hpp"
+#include "Logger.hpp"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+// The services, listeners and connectors of the trading system, wired once for
+// main.cpp and the benchmark harnesses alike. Booked trades flow to positions,
+// then risk, and to the snapshotter; market data flows to algo execution,
+// execution and trade booking, then on down the same position and risk chain.
+// Both chains are fixed at compile time so the calls along them can be inlined.
+
+// ------------- Declaration: ServiceGraphOptions -------------
+
+struct ServiceGraphOptions {
+  std::string inputDirectory = "input";  // holds inquiries.txt, prices.txt, trades.txt and marketdata.txt
+  std::string snapshotPath = "output/state.snapshot";
+  PersistenceMode persistenceMode = PersistenceMode::TEXT;
+  ConflationPolicy conflationPolicy;
+  std::size_t tradesPerSnapshot = 10000;
+  // Runs history persistence and GUI output on threads of their own.
+  std::optional<WaitStrategy> asyncTail;
+  // Fans prices out to the GUI and algo streaming through a multicast ring of this many slots; 0 for none.
+  std::size_t priceRingSlots = 0;
+};
+
+// ------------- Declaration: ServiceGraph -------------
+
+// Entry points of a wired graph. The connectors read their files, or take text
+// lines through parse(); the pipelines take decoded events as the connectors
+// hand them on.
+struct ServiceGraph {
+  BondInquiryService *inquiryService;
+  BondInquirySubscriber *inquiries;
+  BondPricingService *pricingService;
+  BondPricesConnector *prices;
+  BondTradeBookingService *tradeBookingService;
+  BondTradesConnector *trades;
+  BondMarketDataService *marketDataService;
+  BondMarketDataConnector *marketData;
+  Service<std::string, OrderBook<Bond>> *marketDataPipeline;
+  BondStateSnapshotter *snapshotter;
+  BondPriceStreamsHistoricalDataService *streamingHistory;
+  BondPositionHistoricalDataService *positionHistory;
+  BondRiskHistoricalDataService *riskHistory;
+
+  // Asynchronous stages, when the options ask for them; otherwise null.
+  MulticastRing<Price<Bond>> *priceRing;
+  AsyncServiceListener<Price<Bond>> *asyncGui;
+  AsyncServiceListener<PriceStream<Bond>> *asyncStreamingHistory;
+  AsyncServiceListener<Position<Bond>> *asyncPositionHistory;
+  AsyncServiceListener<PV01<Bond>> *asyncRiskHistory;
+  AsyncServiceListener<ExecutionOrder<Bond>> *asyncExecutionHistory;
+
+  // Block until the asynchronous stages have handled everything so far, logging their queue stats.
+  void Drain() const;
+};
+
+// Build the graph and call run(graph) while it lives. Output goes to output/ in
+// the current directory, which must exist.
+template <typename F>
+void withServiceGraph(const ServiceGraphOptions &options, F &&run);
+
+// The listener itself, or with a wait strategy an asynchronous adapter around it.
+template <typename V>
+ServiceListener<V> *tailListener(ServiceListener<V> *listener, std::unique_ptr<AsyncServiceListener<V>> &async,
+                                 const std::optional<WaitStrategy> &waitStrategy);
+
+// ------------- Definition: ServiceGraph -------------
+
+template <typename V>
+void drainTail(const std::string &name, AsyncServiceListener<V> *async) {
+  if (async) {
+    async->Drain();
+    AsyncListenerStats stats = async->GetStats();
+    LOG_INFO(name, " queue: events = ", stats.enqueued, ", max depth = ", stats.maxDepth,
+             ", full stalls = ", stats.fullStalls);
+  }
+}
+
+void ServiceGraph::Drain() const {
+  if (priceRing) {
+    priceRing->Drain();
+    const char *consumers[] = {"GUI", "algo streaming"};
+    for (std::size_t i = 0; i < priceRing->ConsumerCount(); ++i) {
+      MulticastConsumerStats stats = priceRing->GetStats(i);
+      LOG_INFO("Price ring, ", consumers[i], ": processed = ", stats.processed, ", dropped = ", stats.dropped);
+    }
+  }
+  drainTail("GUI", asyncGui);
+  drainTail("Streaming history", asyncStreamingHistory);
+  drainTail("Position history", asyncPositionHistory);
+  drainTail("Risk history", asyncRiskHistory);
+  drainTail("Execution history", asyncExecutionHistory);
+}
+
+template <typename V>
+ServiceListener<V> *tailListener(ServiceListener<V> *listener, std::unique_ptr<AsyncServiceListener<V>> &async,
+                                 const std::optional<WaitStrategy> &waitStrategy) {
+  if (!waitStrategy) {
+    return listener;
+  }
+  AsyncListenerOptions options;
+  options.waitStrategy = *waitStrategy;
+  async = std::make_unique<AsyncServiceListener<V>>(listener, options);
+  return async.get();
+}
+
+template <typename F>
+void withServiceGraph(const ServiceGraphOptions &options, F &&run) {
+  const std::string input = options.inputDirectory + "/";
+
+// ------------- Inquiry -------------
+
+  BondInquiryService inquiryService;
+  BondInquiryServiceListener inquiryServiceListener(&inquiryService);
+  inquiryService.AddListener(&inquiryServiceListener);
+  BondInquirySubscriber inquirySubscriber(input + "inquiries.txt", &inquiryService);
+
+// ------------- Price -------------
+
+  BondPricingService pricingService;
+  GUIService guiService(300);
+  BondAlgoStreamingService algoStreamingService;
+  BondStreamingService streamingService;
+  BondPriceStreamsHistoricalDataService historicalDataService(options.persistenceMode, options.conflationPolicy);
+
+  BondPriceServiceListener guiServiceListener(&guiService);
+  BondPricesServiceListener algoStreamingServiceListener(&algoStreamingService);
+  BondAlgoStreamServiceListener streamingServiceListener(&streamingService);
+  BondPriceStreamsServiceListener historicalDataServiceListener(&historicalDataService);
+  std::unique_ptr<AsyncServiceListener<Price<Bond>>> asyncGuiListener;
+  std::unique_ptr<AsyncServiceListener<PriceStream<Bond>>> asyncHistoricalDataListener;
+
+  ServiceListener<Price<Bond>> *guiTail =
+      tailListener<Price<Bond>>(&guiServiceListener, asyncGuiListener, options.asyncTail);
+  std::unique_ptr<MulticastRing<Price<Bond>>> priceRing;
+  if (options.priceRingSlots > 0) {
+    // The GUI is throttled anyway, so it may lose prices rather than hold up algo streaming.
+    priceRing = std::make_unique<MulticastRing<Price<Bond>>>(options.priceRingSlots);
+    MulticastConsumerOptions guiOptions;
+    guiOptions.policy = SlowConsumerPolicy::DROP;
+    guiOptions.waitStrategy = options.asyncTail.value_or(WaitStrategy::PARK);
+    MulticastConsumerOptions streamingOptions;
+    streamingOptions.waitStrategy = guiOptions.waitStrategy;
+    priceRing->AddConsumer(guiTail, guiOptions);
+    priceRing->AddConsumer(&algoStreamingServiceListener, streamingOptions);
+    pricingService.AddListener(priceRing.get());
+  } else {
+    pricingService.AddListener(guiTail);
+    pricingService.AddListener(&algoStreamingServiceListener);
+  }
+  algoStreamingService.AddListener(&streamingServiceListener);
+  streamingService.AddListener(
+      tailListener<PriceStream<Bond>>(&historicalDataServiceListener, asyncHistoricalDataListener, options.asyncTail));
+
+  BondPricesConnector pricesConnector(input + "prices.txt", &pricingService);
+
+// -------------- Trade -------------
+
+  BondTradeBookingService tradeBookingService;
+  BondPositionService positionService;
+  BondRiskService riskService;
+  BondPositionHistoricalDataService positionHistoricalDataService(options.persistenceMode, options.conflationPolicy);
+  BondRiskHistoricalDataService riskHistoricalDataService(options.persistenceMode, options.conflationPolicy);
+
+  BondTradesServiceListener tradeListener(&positionService);
+  BondPositionServiceListener positionListener(&positionHistoricalDataService);
+  BondPositionRiskServiceListener positionListenerFromRisk(&riskService);
+  BondRiskServiceListener riskListener(&riskHistoricalDataService);
+  BondStateSnapshotter snapshotter(options.snapshotPath, &tradeBookingService, &positionService, &riskService,
+                                   options.tradesPerSnapshot);
+  std::unique_ptr<AsyncServiceListener<Position<Bond>>> asyncPositionListener;
+  std::unique_ptr<AsyncServiceListener<PV01<Bond>>> asyncRiskListener;
+  auto positionTail = tailListener<Position<Bond>>(&positionListener, asyncPositionListener, options.asyncTail);
+  auto riskTail = tailListener<PV01<Bond>>(&riskListener, asyncRiskListener, options.asyncTail);
+
+  auto positionStage = listenerStage(&tradeListener,
+                                     directListener(positionTail),
+                                     listenerStage(&positionListenerFromRisk, directListener(riskTail)));
+  auto tradePipeline = staticPipeline<Trade<Bond>>(&tradeBookingService, positionStage, directListener(&snapshotter));
+
+  BondTradesConnector tradesConnector(input + "trades.txt", &tradePipeline);
+  snapshotter.SetTradesConnector(&tradesConnector);
+
+// -------------- MarketData -------------
+
+  BondMarketDataService marketDataService;
+  BondAlgoExecutionService algoExecutionService;
+  BondExecutionService executionService;
+  BondExecutionHistoricalDataService executionHistoricalDataService(options.persistenceMode);
+
+  BondMarketDataServiceListener marketDataListener(&algoExecutionService);
+  BondAlgoExecutionServiceListener algoExecutionListener(&executionService);
+  BondExecutionOrderServiceListener executionListener(&executionHistoricalDataService);
+  BondExecutionServiceListener executionListenerFromTrade(&tradeBookingService);
+  std::unique_ptr<AsyncServiceListener<ExecutionOrder<Bond>>> asyncExecutionListener;
+  auto executionTail =
+      tailListener<ExecutionOrder<Bond>>(&executionListener, asyncExecutionListener, options.asyncTail);
+
+  auto marketDataPipeline = staticPipeline<OrderBook<Bond>>(
+      &marketDataService,
+      listenerStage(&marketDataListener,
+                    listenerStage(&algoExecutionListener,
+                                  directListener(executionTail),
+                                  listenerStage(&executionListenerFromTrade,
+                                                positionStage,
+                                                directListener(&snapshotter)))));
+
+  BondMarketDataConnector marketDataConnector(input + "marketdata.txt", &marketDataPipeline);
+  // Executions book trades too, so the snapshot records where market data left off.
+  snapshotter.SetMarketData(&marketDataConnector, &marketDataService, &algoExecutionService,
+                            &executionListenerFromTrade);
+
+  ServiceGraph graph{&inquiryService, &inquirySubscriber, &pricingService, &pricesConnector,
+                     &tradeBookingService, &tradesConnector, &marketDataService, &marketDataConnector,
+                     &marketDataPipeline, &snapshotter, &historicalDataService, &positionHistoricalDataService,
+                     &riskHistoricalDataService, priceRing.get(), asyncGuiListener.get(),
+                     asyncHistoricalDataListener.get(), asyncPositionListener.get(), asyncRiskListener.get(),
+                     asyncExecutionListener.get()};
+  run(graph);
+}
+
+#endif
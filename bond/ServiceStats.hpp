@@ -0,0 +1,521 @@
+#ifndef BOND_SERVICE_STATS_HPP
+#define BOND_SERVICE_STATS_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+#include <cxxabi.h>
+#include "../base/soa.hpp"
+#include "Clock.hpp"
+#include "Logger.hpp"
+
+// Every OnMessage() a connector makes and every listener call a service makes
+// is timed and counted under a stage named after the receiving object's type.
+// Times are inclusive: a stage's latency covers everything it calls downstream.
+//
+// Building with BOND_SERVICE_STATS=0 compiles the timing away; otherwise it can
+// be switched off at run time with ServiceStats::SetEnabled(false), which leaves
+// one flag check per call.
+
+#ifndef BOND_SERVICE_STATS
+#define BOND_SERVICE_STATS 1
+#endif
+
+enum class StageEvent { MESSAGE, ADD, UPDATE, REMOVE };
+
+// ------------- Declaration: LatencyHistogram -------------
+
+// Log-linear buckets in the style of HdrHistogram: exact below 32ns, then 32
+// buckets per power of two, so a value is reported within about 3%.
+class LatencyHistogram {
+public:
+  static constexpr int SUB_BUCKET_BITS = 5;
+  static constexpr std::uint64_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+  static constexpr int MAX_BITS = 40;  // about 18 minutes; longer times land in the last bucket
+  static constexpr std::size_t BUCKETS = (MAX_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+  static std::size_t BucketOf(std::uint64_t nanos);
+
+  // Highest value that falls in the bucket.
+  static std::uint64_t HighestIn(std::size_t bucket);
+};
+
+// ------------- Declaration: NamedStage -------------
+
+// Implemented by wrappers that should be reported under the name of what they wrap.
+class NamedStage {
+public:
+  virtual std::string StageName() const = 0;
+};
+
+// ------------- Declaration: StageSnapshot -------------
+
+struct StageSnapshot {
+  std::string name;
+  std::array<std::uint64_t, 4> events{};  // indexed by StageEvent
+  std::uint64_t maxNanos = 0;
+  std::vector<std::uint64_t> buckets;
+
+  std::uint64_t Count() const;
+
+  // Latency at or below which the given fraction of calls completed.
+  std::uint64_t Percentile(double fraction) const;
+};
+
+// ------------- Declaration: ServiceStats -------------
+
+// Process-wide stage registry. Each thread records into counters of its own,
+// one cache-line-aligned block per stage, so recording never contends with
+// another thread. Snapshot() sums the blocks of every thread.
+class ServiceStats {
+public:
+  static ServiceStats &Instance();
+  ServiceStats(const ServiceStats &) = delete;
+  ServiceStats &operator=(const ServiceStats &) = delete;
+
+  // Whether calls are timed; checked before any other work.
+  static bool Enabled();
+  static void SetEnabled(bool enabled);
+
+  // Stage of a service or listener, resolved into its slot on the first call.
+  template <typename T>
+  std::size_t StageOf(const T &object, StageSlot &slot);
+
+  // The object's NamedStage name, or else its demangled dynamic type.
+  template <typename T>
+  static std::string NameOf(const T &object);
+
+  void Record(std::size_t stage, StageEvent event, std::uint64_t ticks);
+
+  std::vector<StageSnapshot> Snapshot() const;
+
+  // Table of counts and p50/p99/p99.9/max latencies per stage.
+  void Write(std::ostream &output) const;
+
+private:
+  static constexpr std::size_t MAX_STAGES = 128;
+
+  struct alignas(64) StageCounters {
+    std::array<std::atomic<std::uint64_t>, 4> events{};
+    std::atomic<std::uint64_t> maxNanos{0};
+    std::array<std::atomic<std::uint64_t>, LatencyHistogram::BUCKETS> buckets{};
+  };
+
+  struct ThreadCounters {
+    ThreadCounters();
+    ~ThreadCounters();
+    std::array<std::atomic<StageCounters *>, MAX_STAGES> stages;
+  };
+
+  // Hands a thread's counters back to ServiceStats when the thread exits.
+  struct ThreadCountersOwner {
+    ~ThreadCountersOwner();
+    ThreadCounters *counters = nullptr;
+  };
+
+  ServiceStats() = default;
+
+  static std::string demangle(const char *name);
+
+  std::size_t registerStage(const std::string &name);
+  ThreadCounters &threadCounters();
+  StageCounters &counters(std::size_t stage);
+  static StageCounters &countersIn(ThreadCounters &thread, std::size_t stage);
+
+  // Folds an exiting thread's counts into retired and frees its counters.
+  void retire(ThreadCounters *thread);
+
+  static inline std::atomic<bool> enabled{true};
+
+  mutable std::mutex mutex;
+  std::vector<std::string> names;
+  std::unordered_map<std::string, std::size_t> stagesByName;
+  std::vector<std::unique_ptr<ThreadCounters>> threads;
+  ThreadCounters retired;
+};
+
+// Time one call under the stage of object, resolved once into slot.
+template <typename T, typename F>
+void timeStage(const T &object, StageSlot &slot, StageEvent event, F &&call);
+
+// Connector to service, and service to listener, with timing.
+template <typename S, typename V>
+void dispatchMessage(S *service, V &data);
+template <typename V>
+void dispatchAdd(ServiceListener<V> *listener, V &data);
+template <typename V>
+void dispatchUpdate(ServiceListener<V> *listener, V &data);
+template <typename V>
+void dispatchRemove(ServiceListener<V> *listener, V &data);
+
+// ------------- Declaration: StatsWriter -------------
+
+// Rewrites a stats file from ServiceStats every interval, and once more when destroyed.
+class StatsWriter {
+public:
+  StatsWriter(std::string path, std::chrono::milliseconds interval);
+  ~StatsWriter();
+  StatsWriter(const StatsWriter &) = delete;
+  StatsWriter &operator=(const StatsWriter &) = delete;
+
+  // Throws if the file cannot be written.
+  void Write();
+
+private:
+  void run();
+  void writeLogged();
+
+  std::string path;
+  std::chrono::milliseconds interval;
+  std::mutex mutex;
+  std::condition_variable wake;
+  bool stopping;
+  std::thread writer;
+};
+
+// ------------- Definition: LatencyHistogram -------------
+
+std::size_t LatencyHistogram::BucketOf(std::uint64_t nanos) {
+  if (nanos < SUB_BUCKETS) {
+    return static_cast<std::size_t>(nanos);
+  }
+  int magnitude = std::min(63 - __builtin_clzll(nanos), MAX_BITS - 1);
+  std::uint64_t subBucket = std::min(nanos >> (magnitude - SUB_BUCKET_BITS), 2 * SUB_BUCKETS - 1) - SUB_BUCKETS;
+  return static_cast<std::size_t>((magnitude - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + subBucket);
+}
+
+std::uint64_t LatencyHistogram::HighestIn(std::size_t bucket) {
+  if (bucket < SUB_BUCKETS) {
+    return bucket;
+  }
+  int magnitude = static_cast<int>(bucket / SUB_BUCKETS) + SUB_BUCKET_BITS - 1;
+  std::uint64_t subBucket = bucket % SUB_BUCKETS + SUB_BUCKETS;
+  return ((subBucket + 1) << (magnitude - SUB_BUCKET_BITS)) - 1;
+}
+
+// ------------- Definition: StageSnapshot -------------
+
+std::uint64_t StageSnapshot::Count() const {
+  std::uint64_t count = 0;
+  for (std::uint64_t calls : events) {
+    count += calls;
+  }
+  return count;
+}
+
+std::uint64_t StageSnapshot::Percentile(double fraction) const {
+  std::uint64_t count = Count();
+  if (count == 0) {
+    return 0;
+  }
+  std::uint64_t rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(fraction * count + 0.5));
+  std::uint64_t seen = 0;
+  for (std::size_t bucket = 0; bucket < buckets.size(); ++bucket) {
+    seen += buckets[bucket];
+    if (seen >= rank) {
+      return std::min(LatencyHistogram::HighestIn(bucket), maxNanos);
+    }
+  }
+  return maxNanos;
+}
+
+// ------------- Definition: ServiceStats -------------
+
+ServiceStats &ServiceStats::Instance() {
+  static ServiceStats stats;
+  return stats;
+}
+
+ServiceStats::ThreadCounters::ThreadCounters() {
+  for (auto &stage : stages) {
+    stage.store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+ServiceStats::ThreadCounters::~ThreadCounters() {
+  for (auto &stage : stages) {
+    delete stage.load(std::memory_order_relaxed);
+  }
+}
+
+ServiceStats::ThreadCountersOwner::~ThreadCountersOwner() {
+  if (counters != nullptr) {
+    ServiceStats::Instance().retire(counters);
+  }
+}
+
+bool ServiceStats::Enabled() {
+  return enabled.load(std::memory_order_relaxed);
+}
+
+void ServiceStats::SetEnabled(bool enabled) {
+  ServiceStats::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+template <typename T>
+std::size_t ServiceStats::StageOf(const T &object, StageSlot &slot) {
+  std::size_t stage = slot.id.load(std::memory_order_relaxed);
+  if (stage == StageSlot::UNRESOLVED) {
+    // Racing threads resolve the same name to the same stage.
+    stage = registerStage(NameOf(object));
+    slot.id.store(stage, std::memory_order_relaxed);
+  }
+  return stage;
+}
+
+void ServiceStats::Record(std::size_t stage, StageEvent event, std::uint64_t ticks) {
+  // Only this thread writes its counters, so plain load and store suffice.
+  StageCounters &stageCounters = counters(stage);
+  std::uint64_t nanos = static_cast<std::uint64_t>(Clock::TicksToNanos(ticks));
+  auto &calls = stageCounters.events[static_cast<std::size_t>(event)];
+  calls.store(calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  auto &bucket = stageCounters.buckets[LatencyHistogram::BucketOf(nanos)];
+  bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  if (nanos > stageCounters.maxNanos.load(std::memory_order_relaxed)) {
+    stageCounters.maxNanos.store(nanos, std::memory_order_relaxed);
+  }
+}
+
+std::vector<StageSnapshot> ServiceStats::Snapshot() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::vector<StageSnapshot> snapshots(names.size());
+  for (std::size_t stage = 0; stage < names.size(); ++stage) {
+    StageSnapshot &snapshot = snapshots[stage];
+    snapshot.name = names[stage];
+    snapshot.buckets.assign(LatencyHistogram::BUCKETS, 0);
+    auto add = [&snapshot](const StageCounters *stageCounters) {
+      if (stageCounters == nullptr) {
+        return;
+      }
+      for (std::size_t event = 0; event < snapshot.events.size(); ++event) {
+        snapshot.events[event] += stageCounters->events[event].load(std::memory_order_relaxed);
+      }
+      for (std::size_t bucket = 0; bucket < LatencyHistogram::BUCKETS; ++bucket) {
+        snapshot.buckets[bucket] += stageCounters->buckets[bucket].load(std::memory_order_relaxed);
+      }
+      snapshot.maxNanos = std::max(snapshot.maxNanos, stageCounters->maxNanos.load(std::memory_order_relaxed));
+    };
+    add(retired.stages[stage].load(std::memory_order_relaxed));
+    for (const auto &thread : threads) {
+      add(thread->stages[stage].load(std::memory_order_acquire));
+    }
+  }
+  return snapshots;
+}
+
+void ServiceStats::Write(std::ostream &output) const {
+  std::vector<StageSnapshot> snapshots = Snapshot();
+  std::size_t width = 5;
+  for (const StageSnapshot &snapshot : snapshots) {
+    width = std::max(width, snapshot.name.size());
+  }
+  output << "# Calls per stage and their latency in nanoseconds, including everything called downstream\n";
+  output << std::left << std::setw(static_cast<int>(width)) << "stage" << std::right
+         << std::setw(11) << "messages" << std::setw(11) << "adds" << std::setw(11) << "updates"
+         << std::setw(9) << "removes" << std::setw(12) << "add/update"
+         << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10) << "p99.9" << std::setw(12) << "max"
+         << '\n';
+  for (const StageSnapshot &snapshot : snapshots) {
+    std::uint64_t adds = snapshot.events[static_cast<std::size_t>(StageEvent::ADD)];
+    std::uint64_t updates = snapshot.events[static_cast<std::size_t>(StageEvent::UPDATE)];
+    output << std::left << std::setw(static_cast<int>(width)) << snapshot.name << std::right
+           << std::setw(11) << snapshot.events[static_cast<std::size_t>(StageEvent::MESSAGE)]
+           << std::setw(11) << adds << std::setw(11) << updates
+           << std::setw(9) << snapshot.events[static_cast<std::size_t>(StageEvent::REMOVE)];
+    if (updates > 0) {
+      output << std::setw(12) << std::fixed << std::setprecision(4)
+             << static_cast<double>(adds) / static_cast<double>(updates);
+    } else {
+      output << std::setw(12) << "-";
+    }
+    output << std::setw(10) << snapshot.Percentile(0.50) << std::setw(10) << snapshot.Percentile(0.99)
+           << std::setw(10) << snapshot.Percentile(0.999) << std::setw(12) << snapshot.maxNanos << '\n';
+  }
+}
+
+template <typename T>
+std::string ServiceStats::NameOf(const T &object) {
+  if constexpr (std::is_polymorphic<T>::value) {
+    if (const NamedStage *named = dynamic_cast<const NamedStage *>(&object)) {
+      return named->StageName();
+    }
+  }
+  return demangle(typeid(object).name());
+}
+
+std::string ServiceStats::demangle(const char *name) {
+  int status = 0;
+  char *demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+  if (demangled == nullptr) {
+    return name;
+  }
+  std::string result(demangled);
+  std::free(demangled);
+  return result;
+}
+
+std::size_t ServiceStats::registerStage(const std::string &name) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto found = stagesByName.find(name);
+  if (found != stagesByName.end()) {
+    return found->second;
+  }
+  if (names.size() == MAX_STAGES) {
+    throw std::runtime_error("Too many service stats stages");
+  }
+  names.push_back(name);
+  stagesByName.emplace(name, names.size() - 1);
+  return names.size() - 1;
+}
+
+ServiceStats::ThreadCounters &ServiceStats::threadCounters() {
+  thread_local ThreadCountersOwner owner;
+  if (owner.counters == nullptr) {
+    std::lock_guard<std::mutex> lock(mutex);
+    threads.push_back(std::make_unique<ThreadCounters>());
+    owner.counters = threads.back().get();
+  }
+  return *owner.counters;
+}
+
+ServiceStats::StageCounters &ServiceStats::counters(std::size_t stage) {
+  return countersIn(threadCounters(), stage);
+}
+
+ServiceStats::StageCounters &ServiceStats::countersIn(ThreadCounters &thread, std::size_t stage) {
+  std::atomic<StageCounters *> &slot = thread.stages[stage];
+  StageCounters *stageCounters = slot.load(std::memory_order_relaxed);
+  if (stageCounters == nullptr) {
+    stageCounters = new StageCounters();
+    slot.store(stageCounters, std::memory_order_release);
+  }
+  return *stageCounters;
+}
+
+void ServiceStats::retire(ThreadCounters *thread) {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (std::size_t stage = 0; stage < MAX_STAGES; ++stage) {
+    const StageCounters *from = thread->stages[stage].load(std::memory_order_relaxed);
+    if (from == nullptr) {
+      continue;
+    }
+    // Snapshot() reads retired under the mutex too, so nothing races these adds.
+    StageCounters &to = countersIn(retired, stage);
+    for (std::size_t event = 0; event < to.events.size(); ++event) {
+      to.events[event].fetch_add(from->events[event].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    for (std::size_t bucket = 0; bucket < LatencyHistogram::BUCKETS; ++bucket) {
+      to.buckets[bucket].fetch_add(from->buckets[bucket].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    to.maxNanos.store(std::max(to.maxNanos.load(std::memory_order_relaxed),
+                               from->maxNanos.load(std::memory_order_relaxed)),
+                      std::memory_order_relaxed);
+  }
+  threads.erase(std::find_if(threads.begin(), threads.end(),
+                             [thread](const std::unique_ptr<ThreadCounters> &owned) { return owned.get() == thread; }));
+}
+
+template <typename T, typename F>
+void timeStage(const T &object, StageSlot &slot, StageEvent event, F &&call) {
+  if constexpr (BOND_SERVICE_STATS != 0) {
+    if (ServiceStats::Enabled()) {
+      ServiceStats &stats = ServiceStats::Instance();
+      std::size_t stage = stats.StageOf(object, slot);
+      std::uint64_t start = Clock::Ticks();
+      call();
+      stats.Record(stage, event, Clock::Ticks() - start);
+      return;
+    }
+  }
+  call();
+}
+
+template <typename S, typename V>
+void dispatchMessage(S *service, V &data) {
+  timeStage(*service, service->statsStage, StageEvent::MESSAGE, [service, &data]() { service->OnMessage(data); });
+}
+
+template <typename V>
+void dispatchAdd(ServiceListener<V> *listener, V &data) {
+  timeStage(*listener, listener->statsStage, StageEvent::ADD, [listener, &data]() { listener->ProcessAdd(data); });
+}
+
+template <typename V>
+void dispatchUpdate(ServiceListener<V> *listener, V &data) {
+  timeStage(*listener, listener->statsStage, StageEvent::UPDATE,
+            [listener, &data]() { listener->ProcessUpdate(data); });
+}
+
+template <typename V>
+void dispatchRemove(ServiceListener<V> *listener, V &data) {
+  timeStage(*listener, listener->statsStage, StageEvent::REMOVE,
+            [listener, &data]() { listener->ProcessRemove(data); });
+}
+
+// ------------- Definition: StatsWriter -------------
+
+StatsWriter::StatsWriter(std::string path, std::chrono::milliseconds interval)
+    : path(std::move(path)), interval(interval), stopping(false) {
+  writer = std::thread(&StatsWriter::run, this);
+}
+
+StatsWriter::~StatsWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_one();
+  writer.join();
+  writeLogged();
+}
+
+void StatsWriter::Write() {
+  // Written aside and renamed over the old file, so readers never see half a table.
+  std::string partial = path + ".tmp";
+  {
+    std::ofstream file(partial, std::ios::trunc);
+    if (!file) {
+      throw std::runtime_error("Unable to write " + partial);
+    }
+    ServiceStats::Instance().Write(file);
+  }
+  if (std::rename(partial.c_str(), path.c_str()) != 0) {
+    throw std::runtime_error("Unable to replace " + path);
+  }
+}
+
+void StatsWriter::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!wake.wait_for(lock, interval, [this]() { return stopping; })) {
+    lock.unlock();
+    writeLogged();
+    lock.lock();
+  }
+}
+
+void StatsWriter::writeLogged() {
+  try {
+    Write();
+  } catch (const std::exception &error) {
+    LOG_ERROR("Stats not written: ", std::string(error.what()));
+  }
+}
+
+#endif
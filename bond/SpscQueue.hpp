@@ -0,0 +1,188 @@
+#ifndef BOND_SPSC_QUEUE_HPP
+#define BOND_SPSC_QUEUE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// ------------- Declaration: SpscQueue -------------
+
+// Bounded lock-free queue for exactly one producer and one consumer thread.
+// Each side keeps its index and a cached copy of the other side's index on its
+// own cache line, so a push or pop touches shared lines only when its cache is stale.
+template <typename T>
+class SpscQueue {
+public:
+  // Capacity is rounded up to a power of two.
+  explicit SpscQueue(std::size_t capacity);
+  SpscQueue(const SpscQueue &) = delete;
+  SpscQueue &operator=(const SpscQueue &) = delete;
+
+  // Producer side. Returns false, leaving value untouched, while the queue is full.
+  bool TryPush(T &&value);
+
+  // Producer side. Hands the next free slot, which may still hold an item consumed
+  // earlier, to produce to fill in place. Returns false while the queue is full.
+  template <typename F>
+  bool TryProduce(F &&produce);
+
+  // Consumer side. Hands the oldest item to consume in place, then removes it. The
+  // item itself stays in its slot until the producer reuses it.
+  // Returns false while the queue is empty.
+  template <typename F>
+  bool TryConsume(F &&consume);
+
+  // Items queued and not yet popped. Exact on either side's thread, a snapshot elsewhere.
+  std::size_t Size() const;
+  std::size_t Capacity() const;
+
+private:
+  std::size_t capacity;
+  std::unique_ptr<std::optional<T>[]> slots;
+
+  alignas(64) std::atomic<std::uint64_t> head;
+  std::uint64_t cachedTail;  // producer's view of tail
+  alignas(64) std::atomic<std::uint64_t> tail;
+  std::uint64_t cachedHead;  // consumer's view of head
+};
+
+// ------------- Declaration: WaitStrategy -------------
+
+// How a consumer waits for work: BUSY_SPIN burns its core for the lowest wake-up
+// latency and needs a core to itself, YIELD gives the core to other runnable
+// threads between polls, and PARK sleeps in the kernel until the producer signals.
+enum class WaitStrategy { BUSY_SPIN, YIELD, PARK };
+
+// ------------- Declaration: Parker -------------
+
+// Futex-backed sleep for one consumer, woken by one producer. The consumer
+// announces it is about to sleep, re-checks for work, then parks; the producer
+// publishes work and then checks for a sleeper, so no wake-up is lost.
+class Parker {
+public:
+  Parker();
+
+  // Consumer side: sleep unless ready() turns true after announcing, or until timeout.
+  template <typename Ready>
+  void Park(Ready ready, std::chrono::nanoseconds timeout);
+
+  // Producer side, after publishing work.
+  void Unpark();
+
+  // Producer side, for hot paths: skips the fence and the wake unless the consumer
+  // has announced it is parking. A consumer announcing at that very moment can
+  // miss the work and sleep until its timeout.
+  void UnparkIfParked();
+
+private:
+  static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t), "futex word must be 32 bits");
+
+  alignas(64) std::atomic<std::uint32_t> sleeping;
+};
+
+// ------------- Definition: SpscQueue -------------
+
+template <typename T>
+SpscQueue<T>::SpscQueue(std::size_t capacity)
+    : capacity(1), head(0), cachedTail(0), tail(0), cachedHead(0) {
+  while (this->capacity < std::max<std::size_t>(capacity, 2)) {
+    this->capacity <<= 1;
+  }
+  slots.reset(new std::optional<T>[this->capacity]);
+}
+
+template <typename T>
+bool SpscQueue<T>::TryPush(T &&value) {
+  std::uint64_t position = head.load(std::memory_order_relaxed);
+  if (position - cachedTail == capacity) {
+    cachedTail = tail.load(std::memory_order_acquire);
+    if (position - cachedTail == capacity) {
+      return false;
+    }
+  }
+  slots[position & (capacity - 1)].emplace(std::move(value));
+  head.store(position + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+template <typename F>
+bool SpscQueue<T>::TryProduce(F &&produce) {
+  std::uint64_t position = head.load(std::memory_order_relaxed);
+  if (position - cachedTail == capacity) {
+    cachedTail = tail.load(std::memory_order_acquire);
+    if (position - cachedTail == capacity) {
+      return false;
+    }
+  }
+  produce(slots[position & (capacity - 1)]);
+  head.store(position + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+template <typename F>
+bool SpscQueue<T>::TryConsume(F &&consume) {
+  std::uint64_t position = tail.load(std::memory_order_relaxed);
+  if (position == cachedHead) {
+    cachedHead = head.load(std::memory_order_acquire);
+    if (position == cachedHead) {
+      return false;
+    }
+  }
+  consume(*slots[position & (capacity - 1)]);
+  tail.store(position + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+std::size_t SpscQueue<T>::Size() const {
+  std::uint64_t consumed = tail.load(std::memory_order_acquire);
+  return static_cast<std::size_t>(head.load(std::memory_order_acquire) - consumed);
+}
+
+template <typename T>
+std::size_t SpscQueue<T>::Capacity() const {
+  return capacity;
+}
+
+// ------------- Definition: Parker -------------
+
+Parker::Parker() : sleeping(0) {}
+
+template <typename Ready>
+void Parker::Park(Ready ready, std::chrono::nanoseconds timeout) {
+  sleeping.store(1, std::memory_order_seq_cst);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!ready()) {
+    timespec wait{static_cast<time_t>(timeout.count() / 1000000000), static_cast<long>(timeout.count() % 1000000000)};
+    // Returns at once if Unpark() already cleared the word.
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&sleeping), FUTEX_WAIT_PRIVATE, 1, &wait, nullptr, 0);
+  }
+  sleeping.store(0, std::memory_order_relaxed);
+}
+
+void Parker::UnparkIfParked() {
+  if (sleeping.load(std::memory_order_relaxed) != 0) {
+    Unpark();
+  }
+}
+
+void Parker::Unpark() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (sleeping.load(std::memory_order_relaxed) != 0) {
+    sleeping.store(0, std::memory_order_relaxed);
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&sleeping), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+  }
+}
+
+#endif
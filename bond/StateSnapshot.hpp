@@ -0,0 +1,359 @@
+#ifndef BOND_STATE_SNAPSHOT_HPP
+#define BOND_STATE_SNAPSHOT_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "BondProductService.hpp"
+#include "BondTradeBookingService.hpp"
+#include "BondPositionService.hpp"
+#include "BondRiskService.hpp"
+#include "BondMarketDataService.hpp"
+#include "BondAlgoExecutionService.hpp"
+
+// Snapshots of the position, risk and market data services are laid out as
+//
+//   SnapshotHeader | positionCount SnapshotPosition | riskCount SnapshotRisk | bookCount SnapshotBook
+//
+// with one SnapshotPosition per product and book. Market data executions book
+// trades too, so the snapshot also records how far the market data file was
+// read, the stored order books deltas apply to, where algo execution's side
+// and order number had got to, and which book the next execution goes to. Fields are written in host byte order.
+
+// ------------- Declaration: Snapshot records -------------
+
+constexpr char SNAPSHOT_MAGIC[8] = {'B', 'T', 'S', 'S', 'N', 'A', 'P', '\0'};
+constexpr std::uint32_t SNAPSHOT_VERSION = 2;
+
+struct SnapshotHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t reserved;
+  std::uint64_t positionCount;
+  std::uint64_t riskCount;
+  std::uint64_t tradeIdHighWater;
+  std::uint64_t tradesOffset;  // bytes of the trades file already applied
+  std::uint64_t marketDataOffset;  // bytes of the market data file already applied
+  std::uint64_t bookCount;
+  std::int64_t algoOrderNumber;
+  std::int64_t algoSideCursor;
+  std::int64_t executionBookCursor;
+};
+
+struct SnapshotPosition {
+  char productId[16];  // NUL padded
+  char book[16];       // NUL padded
+  std::int64_t quantity;
+};
+
+struct SnapshotRisk {
+  char productId[16];  // NUL padded
+  double pv01;
+  std::int64_t quantity;
+};
+
+struct SnapshotBook {
+  char productId[16];  // NUL padded
+  std::uint64_t depths[2];  // bid, offer
+  std::int64_t prices[2][DEFAULT_BOOK_DEPTH];  // ticks
+  std::int64_t quantities[2][DEFAULT_BOOK_DEPTH];
+};
+
+struct StateSnapshot {
+  std::uint64_t tradeIdHighWater = 0;
+  std::uint64_t tradesOffset = 0;
+  std::uint64_t marketDataOffset = 0;
+  std::int64_t algoOrderNumber = 1;
+  std::int64_t algoSideCursor = 0;
+  std::int64_t executionBookCursor = 0;
+  std::vector<SnapshotPosition> positions;
+  std::vector<SnapshotRisk> risks;
+  std::vector<SnapshotBook> books;
+};
+
+// Write through a temporary file and rename it over the target, so a crash never leaves a torn snapshot.
+void saveSnapshot(const std::string &filePath, const StateSnapshot &snapshot);
+
+// Read a snapshot; returns false if the file does not exist.
+bool loadSnapshot(const std::string &filePath, StateSnapshot &snapshot);
+
+// ------------- Declaration: BondStateSnapshotter -------------
+
+// Snapshots the position and risk services together with the trade id high-water
+// mark and how far the trades file has been read, and, once SetMarketData() is
+// called, the market data state and how far its file has been read. Listens on
+// trade booking to snapshot every tradesPerSnapshot trades; register it after
+// the position listener so each snapshot includes the trade that triggered it.
+class BondStateSnapshotter : public ServiceListener<Trade<Bond>> {
+public:
+  BondStateSnapshotter(const std::string &filePath, BondTradeBookingService *tradeBookingService,
+                       BondPositionService *positionService, BondRiskService *riskService,
+                       std::size_t tradesPerSnapshot);
+
+  // The connector whose offset is recorded; without one the restored offset is kept.
+  void SetTradesConnector(const BondTradesConnector *connector);
+
+  // The market data connector and services whose state is recorded. Without them
+  // the restored market data state is kept.
+  void SetMarketData(const BondMarketDataConnector *connector, BondMarketDataService *marketDataService,
+                     BondAlgoExecutionService *algoExecutionService, BondExecutionServiceListener *executionListener);
+
+  // Restore the position, risk and trade booking services from the snapshot if
+  // there is one. Returns the trades file offset to resume reading from, or 0
+  // without a snapshot.
+  std::size_t Restore();
+
+  // After Restore(), restore the services given to SetMarketData(). Returns the
+  // market data file offset to resume reading from, or 0 without a snapshot.
+  std::size_t RestoreMarketData();
+
+  void Save();
+
+  void ProcessAdd(Trade<Bond> &data) override;
+  void ProcessRemove(Trade<Bond> &data) override;
+  void ProcessUpdate(Trade<Bond> &data) override;
+
+private:
+  std::string filePath;
+  BondTradeBookingService *tradeBookingService;
+  BondPositionService *positionService;
+  BondRiskService *riskService;
+  const BondTradesConnector *tradesConnector;
+  const BondMarketDataConnector *marketDataConnector;
+  BondMarketDataService *marketDataService;
+  BondAlgoExecutionService *algoExecutionService;
+  BondExecutionServiceListener *executionListener;
+  std::size_t tradesPerSnapshot;
+  std::size_t tradesSinceSnapshot;
+  std::uint64_t tradesOffset;
+  StateSnapshot restored;  // market data state kept until it is restored or re-read
+};
+
+// ------------- Definition: Snapshot records -------------
+
+void copySnapshotId(const std::string &value, char (&field)[16]) {
+  if (value.size() >= sizeof(field)) {
+    throw std::runtime_error("Identifier too long for snapshot: " + value);
+  }
+  std::memset(field, 0, sizeof(field));
+  std::memcpy(field, value.data(), value.size());
+}
+
+std::string snapshotId(const char (&field)[16]) {
+  return std::string(field, strnlen(field, sizeof(field)));
+}
+
+void saveSnapshot(const std::string &filePath, const StateSnapshot &snapshot) {
+  SnapshotHeader header{};
+  std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+  header.version = SNAPSHOT_VERSION;
+  header.positionCount = snapshot.positions.size();
+  header.riskCount = snapshot.risks.size();
+  header.tradeIdHighWater = snapshot.tradeIdHighWater;
+  header.tradesOffset = snapshot.tradesOffset;
+  header.marketDataOffset = snapshot.marketDataOffset;
+  header.bookCount = snapshot.books.size();
+  header.algoOrderNumber = snapshot.algoOrderNumber;
+  header.algoSideCursor = snapshot.algoSideCursor;
+  header.executionBookCursor = snapshot.executionBookCursor;
+
+  std::string temporaryPath = filePath + ".tmp";
+  {
+    std::ofstream out(temporaryPath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(snapshot.positions.data()),
+              static_cast<std::streamsize>(snapshot.positions.size() * sizeof(SnapshotPosition)));
+    out.write(reinterpret_cast<const char *>(snapshot.risks.data()),
+              static_cast<std::streamsize>(snapshot.risks.size() * sizeof(SnapshotRisk)));
+    out.write(reinterpret_cast<const char *>(snapshot.books.data()),
+              static_cast<std::streamsize>(snapshot.books.size() * sizeof(SnapshotBook)));
+    out.close();
+    if (!out) {
+      throw std::runtime_error("Unable to write snapshot: " + temporaryPath);
+    }
+  }
+  if (std::rename(temporaryPath.c_str(), filePath.c_str()) != 0) {
+    throw std::runtime_error("Unable to replace snapshot: " + filePath);
+  }
+}
+
+bool loadSnapshot(const std::string &filePath, StateSnapshot &snapshot) {
+  std::ifstream in(filePath, std::ios_base::in | std::ios_base::binary);
+  if (!in) {
+    return false;
+  }
+  SnapshotHeader header{};
+  in.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!in || std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+      header.version != SNAPSHOT_VERSION) {
+    throw std::runtime_error("Not a snapshot: " + filePath);
+  }
+  snapshot.tradeIdHighWater = header.tradeIdHighWater;
+  snapshot.tradesOffset = header.tradesOffset;
+  snapshot.marketDataOffset = header.marketDataOffset;
+  snapshot.algoOrderNumber = header.algoOrderNumber;
+  snapshot.algoSideCursor = header.algoSideCursor;
+  snapshot.executionBookCursor = header.executionBookCursor;
+  snapshot.positions.resize(header.positionCount);
+  snapshot.risks.resize(header.riskCount);
+  snapshot.books.resize(header.bookCount);
+  in.read(reinterpret_cast<char *>(snapshot.positions.data()),
+          static_cast<std::streamsize>(header.positionCount * sizeof(SnapshotPosition)));
+  in.read(reinterpret_cast<char *>(snapshot.risks.data()),
+          static_cast<std::streamsize>(header.riskCount * sizeof(SnapshotRisk)));
+  in.read(reinterpret_cast<char *>(snapshot.books.data()),
+          static_cast<std::streamsize>(header.bookCount * sizeof(SnapshotBook)));
+  if (!in) {
+    throw std::runtime_error("Truncated snapshot: " + filePath);
+  }
+  return true;
+}
+
+// ------------- Definition: BondStateSnapshotter -------------
+
+BondStateSnapshotter::BondStateSnapshotter(const std::string &filePath,
+                                           BondTradeBookingService *tradeBookingService,
+                                           BondPositionService *positionService, BondRiskService *riskService,
+                                           std::size_t tradesPerSnapshot)
+    : filePath(filePath), tradeBookingService(tradeBookingService), positionService(positionService),
+      riskService(riskService), tradesConnector(nullptr), marketDataConnector(nullptr), marketDataService(nullptr),
+      algoExecutionService(nullptr), executionListener(nullptr), tradesPerSnapshot(tradesPerSnapshot), tradesSinceSnapshot(0), tradesOffset(0) {}
+
+void BondStateSnapshotter::SetTradesConnector(const BondTradesConnector *connector) {
+  tradesConnector = connector;
+}
+
+void BondStateSnapshotter::SetMarketData(const BondMarketDataConnector *connector,
+                                         BondMarketDataService *marketDataService,
+                                         BondAlgoExecutionService *algoExecutionService,
+                                         BondExecutionServiceListener *executionListener) {
+  marketDataConnector = connector;
+  this->marketDataService = marketDataService;
+  this->algoExecutionService = algoExecutionService;
+  this->executionListener = executionListener;
+}
+
+std::size_t BondStateSnapshotter::Restore() {
+  StateSnapshot snapshot;
+  if (!loadSnapshot(filePath, snapshot)) {
+    return 0;
+  }
+  auto productService = BondProductService::GetInstance();
+
+  std::unordered_map<std::string, Position<Bond>> positions;
+  for (const auto &entry : snapshot.positions) {
+    std::string productId = snapshotId(entry.productId);
+    auto position = positions.try_emplace(productId, productService->GetData(productId)).first;
+    position->second.SetPosition(snapshotId(entry.book), entry.quantity);
+  }
+  for (const auto &position : positions) {
+    positionService->RestorePosition(position.second);
+  }
+  for (const auto &entry : snapshot.risks) {
+    const Bond &bond = productService->GetData(snapshotId(entry.productId));
+    riskService->RestoreRisk(PV01<Bond>(bond, entry.pv01, entry.quantity));
+  }
+
+  tradeBookingService->SetTradeIdHighWater(snapshot.tradeIdHighWater);
+  tradesOffset = snapshot.tradesOffset;
+  restored.marketDataOffset = snapshot.marketDataOffset;
+  restored.algoOrderNumber = snapshot.algoOrderNumber;
+  restored.algoSideCursor = snapshot.algoSideCursor;
+  restored.executionBookCursor = snapshot.executionBookCursor;
+  restored.books = std::move(snapshot.books);
+  return tradesOffset;
+}
+
+std::size_t BondStateSnapshotter::RestoreMarketData() {
+  if (marketDataService == nullptr || algoExecutionService == nullptr || executionListener == nullptr) {
+    throw std::runtime_error("No market data services to restore");
+  }
+  auto productService = BondProductService::GetInstance();
+  for (const auto &entry : restored.books) {
+    OrderBook<Bond> book(productService->GetData(snapshotId(entry.productId)));
+    for (PricingSide side : {PricingSide::BID, PricingSide::OFFER}) {
+      for (std::uint64_t level = 0; level < entry.depths[side]; ++level) {
+        book.AddLevel(side, Ticks(entry.prices[side][level]), entry.quantities[side][level]);
+      }
+    }
+    marketDataService->RestoreBook(book);
+  }
+  algoExecutionService->RestoreState(static_cast<int>(restored.algoSideCursor), restored.algoOrderNumber);
+  executionListener->RestoreBookCursor(static_cast<int>(restored.executionBookCursor));
+  return restored.marketDataOffset;
+}
+
+void BondStateSnapshotter::Save() {
+  StateSnapshot snapshot;
+  snapshot.tradeIdHighWater = tradeBookingService->GetTradeIdHighWater();
+  if (tradesConnector != nullptr) {
+    tradesOffset = std::max<std::uint64_t>(tradesOffset, tradesConnector->GetOffset());
+  }
+  snapshot.tradesOffset = tradesOffset;
+  if (marketDataService != nullptr && algoExecutionService != nullptr && executionListener != nullptr) {
+    if (marketDataConnector != nullptr) {
+      restored.marketDataOffset = std::max<std::uint64_t>(restored.marketDataOffset, marketDataConnector->GetOffset());
+    }
+    restored.algoOrderNumber = algoExecutionService->GetOrderNumber();
+    restored.algoSideCursor = algoExecutionService->GetSideCursor();
+    restored.executionBookCursor = executionListener->GetBookCursor();
+    restored.books.clear();
+    marketDataService->GetBooks().ForEach([this](const OrderBook<Bond> &book) {
+      SnapshotBook entry{};
+      copySnapshotId(book.GetProduct().GetProductId(), entry.productId);
+      for (PricingSide side : {PricingSide::BID, PricingSide::OFFER}) {
+        entry.depths[side] = book.GetDepth(side);
+        for (std::size_t level = 0; level < book.GetDepth(side); ++level) {
+          entry.prices[side][level] = book.GetPrices(side)[level].Count();
+          entry.quantities[side][level] = book.GetQuantities(side)[level];
+        }
+      }
+      restored.books.push_back(entry);
+    });
+  }
+  snapshot.marketDataOffset = restored.marketDataOffset;
+  snapshot.algoOrderNumber = restored.algoOrderNumber;
+  snapshot.algoSideCursor = restored.algoSideCursor;
+  snapshot.executionBookCursor = restored.executionBookCursor;
+  snapshot.books = restored.books;
+
+  positionService->GetPositions().ForEach([&snapshot](const Position<Bond> &position) {
+    for (const auto &book : position.GetPositions()) {
+      SnapshotPosition entry{};
+      copySnapshotId(position.GetProduct().GetProductId(), entry.productId);
+      copySnapshotId(book.first, entry.book);
+      entry.quantity = book.second;
+      snapshot.positions.push_back(entry);
+    }
+  });
+  riskService->GetRisks().ForEach([&snapshot](const PV01<Bond> &risk) {
+    SnapshotRisk entry{};
+    copySnapshotId(risk.GetProduct().GetProductId(), entry.productId);
+    entry.pv01 = risk.GetPV01();
+    entry.quantity = risk.GetQuantity();
+    snapshot.risks.push_back(entry);
+  });
+
+  saveSnapshot(filePath, snapshot);
+  tradesSinceSnapshot = 0;
+}
+
+void BondStateSnapshotter::ProcessAdd(Trade<Bond> &data) {
+  if (tradesPerSnapshot > 0 && ++tradesSinceSnapshot >= tradesPerSnapshot) {
+    Save();
+  }
+}
+
+void BondStateSnapshotter::ProcessRemove(Trade<Bond> &data) {
+  // NO-OP: Trades are never removed in this project.
+}
+
+void BondStateSnapshotter::ProcessUpdate(Trade<Bond> &data) {
+  // NO-OP: Trades are never updated in this project.
+}
+
+#endif
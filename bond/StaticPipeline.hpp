@@ -0,0 +1,234 @@
+#ifndef BOND_STATIC_PIPELINE_HPP
+#define BOND_STATIC_PIPELINE_HPP
+
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "../base/soa.hpp"
+#include "ServiceStats.hpp"
+
+// A static pipeline wires services together at compile time, e.g.
+//
+//   auto pipeline = staticPipeline<Trade<Bond>>(&tradeBookingService,
+//       listenerStage(&tradeListener,
+//           directListener(&positionListener),
+//           listenerStage(&positionListenerFromRisk, directListener(&riskListener))));
+//
+// Every hop is a direct call on a concrete type, so the compiler can inline the
+// whole chain. Services notify listeners added with AddListener() as well, so
+// plugins and tests keep working alongside a static graph. Each hop is timed in
+// ServiceStats like a dynamic listener call, its stage resolved once per hop;
+// build with BOND_SERVICE_STATS=0 to leave the chain with nothing but the calls.
+
+// ------------- Declaration: StaticListeners -------------
+
+// Listeners fixed at compile time, notified in order.
+template <typename... Ls>
+class StaticListeners {
+public:
+  explicit StaticListeners(Ls... listeners);
+
+  template <typename V>
+  void ProcessAdd(V &data);
+  template <typename V>
+  void ProcessUpdate(V &data);
+
+private:
+  std::tuple<Ls...> listeners;
+};
+
+using NoListeners = StaticListeners<>;
+
+// ------------- Declaration: DirectListener -------------
+
+// Puts an ordinary ServiceListener in a StaticListeners list. The calls are
+// qualified with L, so they bypass the vtable, unless L is an abstract
+// interface chosen at run time, e.g. ServiceListener<V> itself.
+template <typename L>
+class DirectListener {
+public:
+  explicit DirectListener(L *listener);
+
+  template <typename V>
+  void ProcessAdd(V &data);
+  template <typename V>
+  void ProcessUpdate(V &data);
+
+private:
+  L *listener;
+  StageSlot stage;
+};
+
+// ------------- Declaration: ListenerStage -------------
+
+// A listener that feeds another service, together with that service's own
+// static listeners. L provides ProcessAdd(V &, Next &) and ProcessUpdate(V &, Next &).
+template <typename L, typename Next>
+class ListenerStage {
+public:
+  ListenerStage(L *listener, Next next);
+
+  template <typename V>
+  void ProcessAdd(V &data);
+  template <typename V>
+  void ProcessUpdate(V &data);
+
+private:
+  L *listener;
+  StageSlot stage;
+  Next next;
+};
+
+// ------------- Declaration: StaticPipeline -------------
+
+// The head of a static graph. Give it to a connector in place of the service S,
+// which then notifies Next on every message. S provides OnMessage(V &, Next &).
+// Its messages are counted in ServiceStats under the name of S.
+template <typename V, typename S, typename Next>
+class StaticPipeline : public Service<std::string, V>, public NamedStage {
+public:
+  StaticPipeline(S *service, Next next);
+
+  V &GetData(std::string key) override;
+  void OnMessage(V &data) override;
+  std::string StageName() const override;
+
+private:
+  S *service;
+  Next next;
+};
+
+template <typename L>
+DirectListener<L> directListener(L *listener);
+
+template <typename L, typename... Ls>
+ListenerStage<L, StaticListeners<Ls...>> listenerStage(L *listener, Ls... next);
+
+template <typename V, typename S, typename... Ls>
+StaticPipeline<V, S, StaticListeners<Ls...>> staticPipeline(S *service, Ls... next);
+
+// Notify a service's AddListener() listeners, then its static ones.
+template <typename V, typename Next>
+void notifyAdd(const std::vector<ServiceListener<V> *> &listeners, Next &next, V &data);
+template <typename V, typename Next>
+void notifyUpdate(const std::vector<ServiceListener<V> *> &listeners, Next &next, V &data);
+
+// ------------- Definition: StaticListeners -------------
+
+template <typename... Ls>
+StaticListeners<Ls...>::StaticListeners(Ls... listeners) : listeners(std::move(listeners)...) {}
+
+template <typename... Ls>
+template <typename V>
+void StaticListeners<Ls...>::ProcessAdd(V &data) {
+  std::apply([&data](auto &...listener) { (listener.ProcessAdd(data), ...); }, listeners);
+}
+
+template <typename... Ls>
+template <typename V>
+void StaticListeners<Ls...>::ProcessUpdate(V &data) {
+  std::apply([&data](auto &...listener) { (listener.ProcessUpdate(data), ...); }, listeners);
+}
+
+// ------------- Definition: DirectListener -------------
+
+template <typename L>
+DirectListener<L>::DirectListener(L *listener) : listener(listener) {}
+
+template <typename L>
+template <typename V>
+void DirectListener<L>::ProcessAdd(V &data) {
+  timeStage(*listener, stage, StageEvent::ADD, [this, &data]() {
+    if constexpr (std::is_abstract<L>::value) {
+      listener->ProcessAdd(data);
+    } else {
+      listener->L::ProcessAdd(data);
+    }
+  });
+}
+
+template <typename L>
+template <typename V>
+void DirectListener<L>::ProcessUpdate(V &data) {
+  timeStage(*listener, stage, StageEvent::UPDATE, [this, &data]() {
+    if constexpr (std::is_abstract<L>::value) {
+      listener->ProcessUpdate(data);
+    } else {
+      listener->L::ProcessUpdate(data);
+    }
+  });
+}
+
+// ------------- Definition: ListenerStage -------------
+
+template <typename L, typename Next>
+ListenerStage<L, Next>::ListenerStage(L *listener, Next next) : listener(listener), next(std::move(next)) {}
+
+template <typename L, typename Next>
+template <typename V>
+void ListenerStage<L, Next>::ProcessAdd(V &data) {
+  timeStage(*listener, stage, StageEvent::ADD, [this, &data]() { listener->ProcessAdd(data, next); });
+}
+
+template <typename L, typename Next>
+template <typename V>
+void ListenerStage<L, Next>::ProcessUpdate(V &data) {
+  timeStage(*listener, stage, StageEvent::UPDATE, [this, &data]() { listener->ProcessUpdate(data, next); });
+}
+
+// ------------- Definition: StaticPipeline -------------
+
+template <typename V, typename S, typename Next>
+StaticPipeline<V, S, Next>::StaticPipeline(S *service, Next next) : service(service), next(std::move(next)) {}
+
+template <typename V, typename S, typename Next>
+V &StaticPipeline<V, S, Next>::GetData(std::string key) {
+  return service->GetData(std::move(key));
+}
+
+template <typename V, typename S, typename Next>
+void StaticPipeline<V, S, Next>::OnMessage(V &data) {
+  service->OnMessage(data, next);
+}
+
+template <typename V, typename S, typename Next>
+std::string StaticPipeline<V, S, Next>::StageName() const {
+  return ServiceStats::NameOf(*service);
+}
+
+// ------------- Definition: builders -------------
+
+template <typename L>
+DirectListener<L> directListener(L *listener) {
+  return DirectListener<L>(listener);
+}
+
+template <typename L, typename... Ls>
+ListenerStage<L, StaticListeners<Ls...>> listenerStage(L *listener, Ls... next) {
+  return ListenerStage<L, StaticListeners<Ls...>>(listener, StaticListeners<Ls...>(std::move(next)...));
+}
+
+template <typename V, typename S, typename... Ls>
+StaticPipeline<V, S, StaticListeners<Ls...>> staticPipeline(S *service, Ls... next) {
+  return StaticPipeline<V, S, StaticListeners<Ls...>>(service, StaticListeners<Ls...>(std::move(next)...));
+}
+
+template <typename V, typename Next>
+void notifyAdd(const std::vector<ServiceListener<V> *> &listeners, Next &next, V &data) {
+  for (auto listener : listeners) {
+    dispatchAdd(listener, data);
+  }
+  next.ProcessAdd(data);
+}
+
+template <typename V, typename Next>
+void notifyUpdate(const std::vector<ServiceListener<V> *> &listeners, Next &next, V &data) {
+  for (auto listener : listeners) {
+    dispatchUpdate(listener, data);
+  }
+  next.ProcessUpdate(data);
+}
+
+#endif
@@ -0,0 +1,279 @@
+#ifndef BOND_TRACE_HPP
+#define BOND_TRACE_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../base/soa.hpp"
+#include "Clock.hpp"
+
+// ------------- Declaration: TraceHop -------------
+
+// Hops of the market data to risk chain, in the order a traced event passes them.
+enum class TraceHop : std::uint8_t {
+  INGEST,              // market data line read
+  ALGO_EXECUTION,      // BondAlgoExecutionService::Execute
+  EXECUTION,           // BondExecutionService::ExecuteOrder
+  EXECUTION_LISTENER,  // BondExecutionServiceListener::ProcessAdd
+  TRADE_BOOKING,       // BondTradeBookingService::BookTrade
+  POSITION,            // BondPositionService::AddTrade
+  RISK,                // BondRiskService::AddPosition
+  RISK_PUBLISHED,      // risk handed to every listener
+};
+
+constexpr std::size_t TRACE_HOPS = 8;
+
+const char *traceHopName(TraceHop hop);
+
+struct TraceStamp {
+  std::uint64_t id;
+  std::uint64_t ticks;
+  TraceHop hop;
+};
+
+// ------------- Declaration: Tracer -------------
+
+// Tick-to-trade tracing, off until Enable(). Then Begin() gives every event read
+// from market data a new chain id, and each Stamp() on an event of that chain
+// appends the id, the hop and a Clock::Ticks() reading to a buffer owned by the
+// calling thread. A full buffer overwrites its oldest stamps.
+class Tracer {
+public:
+  static Tracer &Instance();
+  Tracer(const Tracer &) = delete;
+  Tracer &operator=(const Tracer &) = delete;
+
+  // Start tracing with room for the given number of stamps on each thread.
+  void Enable(std::size_t stampsPerThread);
+  bool Enabled() const;
+
+  // Context for an event being read now, stamped as INGEST; untraced while disabled.
+  TraceContext Begin();
+
+  // Record that a traced event reached hop. Does nothing for untraced events.
+  void Stamp(const TraceContext &trace, TraceHop hop);
+
+  // Every stamp still held, across threads. Call once the traced threads are quiet.
+  std::vector<TraceStamp> Collect() const;
+
+  // Stamps lost to full buffers.
+  std::uint64_t GetOverwritten() const;
+
+private:
+  struct Buffer {
+    explicit Buffer(std::size_t capacity);
+    std::unique_ptr<TraceStamp[]> stamps;
+    std::size_t capacity;
+    std::atomic<std::uint64_t> written;
+  };
+
+  Tracer();
+
+  Buffer &threadBuffer();
+
+  std::atomic<bool> enabled;
+  std::size_t stampsPerThread;
+  std::atomic<std::uint64_t> nextId;
+  mutable std::mutex mutex;
+  std::vector<std::unique_ptr<Buffer>> buffers;
+};
+
+// ------------- Declaration: TraceExporter -------------
+
+// Writes the latency of each hop since the one before it and of each hop since
+// ingest, as percentiles over every traced chain that reached the hop.
+class TraceExporter {
+public:
+  explicit TraceExporter(std::string path);
+
+  // Throws if the file cannot be written.
+  void Write() const;
+
+private:
+  struct Distribution {
+    std::vector<double> nanos;
+    void WriteRow(std::ostream &output, const char *name);
+  };
+
+  std::string path;
+};
+
+// ------------- Definition: TraceHop -------------
+
+const char *traceHopName(TraceHop hop) {
+  static const char *NAMES[TRACE_HOPS] = {"ingest", "algo execution", "execution", "execution listener",
+                                          "trade booking", "position", "risk", "risk published"};
+  return NAMES[static_cast<std::size_t>(hop)];
+}
+
+// ------------- Definition: Tracer -------------
+
+Tracer &Tracer::Instance() {
+  static Tracer tracer;
+  return tracer;
+}
+
+Tracer::Tracer() : enabled(false), stampsPerThread(0), nextId(1) {}
+
+Tracer::Buffer::Buffer(std::size_t capacity) : stamps(new TraceStamp[capacity]), capacity(capacity), written(0) {}
+
+void Tracer::Enable(std::size_t stampsPerThread) {
+  if (stampsPerThread == 0) {
+    throw std::runtime_error("Trace buffers need room for at least one stamp");
+  }
+  this->stampsPerThread = stampsPerThread;
+  enabled.store(true, std::memory_order_release);
+}
+
+bool Tracer::Enabled() const {
+  return enabled.load(std::memory_order_acquire);
+}
+
+TraceContext Tracer::Begin() {
+  TraceContext trace;
+  if (enabled.load(std::memory_order_relaxed)) {
+    trace.ingestTicks = Clock::Ticks();
+    trace.id = nextId.fetch_add(1, std::memory_order_relaxed);
+    Buffer &buffer = threadBuffer();
+    std::uint64_t written = buffer.written.load(std::memory_order_relaxed);
+    buffer.stamps[written % buffer.capacity] = TraceStamp{trace.id, trace.ingestTicks, TraceHop::INGEST};
+    buffer.written.store(written + 1, std::memory_order_release);
+  }
+  return trace;
+}
+
+void Tracer::Stamp(const TraceContext &trace, TraceHop hop) {
+  if (trace.id == 0) {
+    return;
+  }
+  std::uint64_t ticks = Clock::Ticks();
+  Buffer &buffer = threadBuffer();
+  std::uint64_t written = buffer.written.load(std::memory_order_relaxed);
+  buffer.stamps[written % buffer.capacity] = TraceStamp{trace.id, ticks, hop};
+  buffer.written.store(written + 1, std::memory_order_release);
+}
+
+std::vector<TraceStamp> Tracer::Collect() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::vector<TraceStamp> stamps;
+  for (const auto &buffer : buffers) {
+    std::uint64_t written = buffer->written.load(std::memory_order_acquire);
+    std::uint64_t held = std::min<std::uint64_t>(written, buffer->capacity);
+    for (std::uint64_t i = written - held; i < written; ++i) {
+      stamps.push_back(buffer->stamps[i % buffer->capacity]);
+    }
+  }
+  return stamps;
+}
+
+std::uint64_t Tracer::GetOverwritten() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::uint64_t overwritten = 0;
+  for (const auto &buffer : buffers) {
+    std::uint64_t written = buffer->written.load(std::memory_order_acquire);
+    overwritten += written - std::min<std::uint64_t>(written, buffer->capacity);
+  }
+  return overwritten;
+}
+
+Tracer::Buffer &Tracer::threadBuffer() {
+  thread_local Buffer *buffer = nullptr;
+  if (buffer == nullptr) {
+    std::lock_guard<std::mutex> lock(mutex);
+    buffers.push_back(std::make_unique<Buffer>(stampsPerThread));
+    buffer = buffers.back().get();
+  }
+  return *buffer;
+}
+
+// ------------- Definition: TraceExporter -------------
+
+TraceExporter::TraceExporter(std::string path) : path(std::move(path)) {}
+
+void TraceExporter::Write() const {
+  const Tracer &tracer = Tracer::Instance();
+  std::vector<TraceStamp> stamps = tracer.Collect();
+  std::sort(stamps.begin(), stamps.end(), [](const TraceStamp &a, const TraceStamp &b) {
+    return a.id != b.id ? a.id < b.id : a.hop < b.hop;
+  });
+
+  std::array<Distribution, TRACE_HOPS> sincePrevious;
+  std::array<Distribution, TRACE_HOPS> sinceIngest;
+  std::uint64_t chains = 0;
+  std::uint64_t traded = 0;
+  for (std::size_t first = 0; first < stamps.size();) {
+    std::size_t last = first;
+    while (last < stamps.size() && stamps[last].id == stamps[first].id) {
+      last++;
+    }
+    chains++;
+    // A chain is one event per hop; its earliest stamp is the ingest unless that was overwritten.
+    const TraceStamp *previous = nullptr;
+    const TraceStamp *ingest = stamps[first].hop == TraceHop::INGEST ? &stamps[first] : nullptr;
+    for (std::size_t i = first; i < last; ++i) {
+      const TraceStamp &stamp = stamps[i];
+      std::size_t hop = static_cast<std::size_t>(stamp.hop);
+      if (previous != nullptr && previous->hop != stamp.hop) {
+        sincePrevious[hop].nanos.push_back(Clock::TicksToNanos(stamp.ticks - previous->ticks));
+      }
+      if (ingest != nullptr && stamp.hop != TraceHop::INGEST) {
+        sinceIngest[hop].nanos.push_back(Clock::TicksToNanos(stamp.ticks - ingest->ticks));
+      }
+      if (stamp.hop == TraceHop::TRADE_BOOKING) {
+        traded++;
+      }
+      previous = &stamp;
+    }
+    first = last;
+  }
+
+  std::string partial = path + ".tmp";
+  {
+    std::ofstream output(partial, std::ios::trunc);
+    if (!output) {
+      throw std::runtime_error("Unable to write " + partial);
+    }
+    output << "# Tick-to-trade trace: " << chains << " chains, " << traded << " reached a trade, "
+           << tracer.GetOverwritten() << " stamps overwritten\n";
+    output << "# Latency in nanoseconds since the previous hop of the same chain\n";
+    output << std::left << std::setw(20) << "hop" << std::right << std::setw(10) << "count" << std::setw(10) << "p50"
+           << std::setw(10) << "p90" << std::setw(10) << "p99" << std::setw(10) << "p99.9" << std::setw(12) << "max"
+           << '\n';
+    for (std::size_t hop = 1; hop < TRACE_HOPS; ++hop) {
+      sincePrevious[hop].WriteRow(output, traceHopName(static_cast<TraceHop>(hop)));
+    }
+    output << "# Latency in nanoseconds since ingest (end to end at risk published)\n";
+    for (std::size_t hop = 1; hop < TRACE_HOPS; ++hop) {
+      sinceIngest[hop].WriteRow(output, traceHopName(static_cast<TraceHop>(hop)));
+    }
+  }
+  if (std::rename(partial.c_str(), path.c_str()) != 0) {
+    throw std::runtime_error("Unable to replace " + path);
+  }
+}
+
+void TraceExporter::Distribution::WriteRow(std::ostream &output, const char *name) {
+  std::sort(nanos.begin(), nanos.end());
+  auto percentile = [this](double fraction) {
+    if (nanos.empty()) {
+      return std::uint64_t(0);
+    }
+    std::size_t rank = static_cast<std::size_t>(fraction * (nanos.size() - 1) + 0.5);
+    return static_cast<std::uint64_t>(nanos[rank]);
+  };
+  output << std::left << std::setw(20) << name << std::right << std::setw(10) << nanos.size()
+         << std::setw(10) << percentile(0.50) << std::setw(10) << percentile(0.90) << std::setw(10) << percentile(0.99)
+         << std::setw(10) << percentile(0.999) << std::setw(12) << percentile(1.0) << '\n';
+}
+
+#endif
@@ -78,10 +78,10 @@ def generate_marketdata(num_rows):
             row = product_id
             mid = random.randint(99 * 256, 101 * 256)
             for k in range(5):
-                row += f",{get_fractional_string(mid - spread / 2 - k)},{volumes[volume_index]}"
+                row += f",{get_fractional_string(mid - spread // 2 - k)},{volumes[volume_index]}"
                 volume_index = (volume_index + 1) % len(volumes)
             for k in range(5):
-                row += f",{get_fractional_string(mid + spread / 2 + k)},{volumes[volume_index]}"
+                row += f",{get_fractional_string(mid + spread // 2 + k)},{volumes[volume_index]}"
                 volume_index = (volume_index + 1) % len(volumes)
 
             row += "\n"
@@ -101,8 +101,8 @@ def get_random_fractional_price(low, high):
 
 
 def get_fractional_string(number):
-    quotient, remainder = number / 256, number % 256
-    first = remainder / 8
+    quotient, remainder = number // 256, number % 256
+    first = remainder // 8
     second = remainder % 8
     return f"{quotient}-{f'{first}' if first > 9 else f'0{first}'}{'+' if second == 4 else second}"
 
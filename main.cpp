@@ -1,18 +1,102 @@
-#include "bond/BondPricingService.hpp"
-#include "bond/BondAlgoStreamingService.hpp"
-#include "bond/BondStreamingService.hpp"
-#include "bond/BondInquiryService.hpp"
-#include "bond/BondTradeBookingService.hpp"
-#include "bond/BondPositionService.hpp"
-#include "bond/BondRiskService.hpp"
-#include "bond/BondMarketDataService.hpp"
-#include "bond/BondAlgoExecutionService.hpp"
-#include "bond/BondExecutionService.hpp"
-#include "bond/GUIService.hpp"
-
-int main()
+#include "bond/ServiceGraph.hpp"
+#include "bond/Logger.hpp"
+#include "bond/ServiceStats.hpp"
+#include "bond/Trace.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <thread>
+
+// Value following a "--name value" pair on the command line, or nullptr.
+const char *findOption(int argc, char *argv[], const char *name) {
+  for (int i = 1; i + 1 < argc; ++i) {
+    if (std::strcmp(argv[i], name) == 0) {
+      return argv[i + 1];
+    }
+  }
+  return nullptr;
+}
+
+// Historical services persist as CSV text unless "--persistence text|journal|both" says otherwise.
+PersistenceMode parsePersistenceMode(int argc, char *argv[]) {
+  const char *value = findOption(argc, argv, "--persistence");
+  if (value == nullptr) return PersistenceMode::TEXT;
+  std::string mode(value);
+  if (mode == "text") return PersistenceMode::TEXT;
+  if (mode == "journal") return PersistenceMode::JOURNAL;
+  if (mode == "both") return PersistenceMode::BOTH;
+  throw std::runtime_error("Unknown persistence mode: " + mode);
+}
+
+// Position, risk and price stream history is conflated with "--conflate-events N" and/or "--conflate-ms N".
+ConflationPolicy parseConflationPolicy(int argc, char *argv[]) {
+  ConflationPolicy policy;
+  if (const char *events = findOption(argc, argv, "--conflate-events")) {
+    policy.maxEvents = static_cast<std::size_t>(parseLong(events));
+  }
+  if (const char *interval = findOption(argc, argv, "--conflate-ms")) {
+    policy.interval = std::chrono::milliseconds(parseLong(interval));
+  }
+  return policy;
+}
+
+bool hasFlag(int argc, char *argv[], const char *name) {
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// "--async-tail spin|yield|park" runs history persistence and GUI output on threads of their own.
+std::optional<WaitStrategy> parseAsyncTail(int argc, char *argv[]) {
+  const char *value = findOption(argc, argv, "--async-tail");
+  if (value == nullptr) return std::nullopt;
+  std::string strategy(value);
+  if (strategy == "spin") return WaitStrategy::BUSY_SPIN;
+  if (strategy == "yield") return WaitStrategy::YIELD;
+  if (strategy == "park") return WaitStrategy::PARK;
+  throw std::runtime_error("Unknown wait strategy: " + strategy);
+}
+
+void printConflationStats(const std::string &name, const ConflationStats &stats) {
+  LOG_INFO(name, " conflation: updates = ", stats.updates, ", conflated = ", stats.conflated,
+           ", written = ", stats.written, ", flushes = ", stats.flushes);
+}
+
+int main(int argc, char *argv[])
 {
   auto productService = BondProductService::GetInstance();
+  const PersistenceMode persistenceMode = parsePersistenceMode(argc, argv);
+  const ConflationPolicy conflationPolicy = parseConflationPolicy(argc, argv);
+
+  // "--warm-start" restores positions, risk and market data state from the last snapshot and
+  // reads only the newer trades and market data.
+  const bool warmStart = hasFlag(argc, argv, "--warm-start");
+  const char *snapshotTradesOption = findOption(argc, argv, "--snapshot-trades");
+  const std::size_t tradesPerSnapshot = snapshotTradesOption ? parseLong(snapshotTradesOption) : 10000;
+  const std::size_t ingestionThreads = std::max(1u, std::thread::hardware_concurrency());
+  const std::optional<WaitStrategy> asyncTail = parseAsyncTail(argc, argv);
+  // "--price-ring N" fans prices out to the GUI and algo streaming through an N-slot multicast ring.
+  const char *priceRingOption = findOption(argc, argv, "--price-ring");
+  // Per-stage counts and latencies go to output/stats.txt every "--stats-ms N" (default 1000) and at exit;
+  // "--stats-ms 0" stops timing calls altogether.
+  const char *statsIntervalOption = findOption(argc, argv, "--stats-ms");
+  const long statsIntervalMillis = statsIntervalOption ? parseLong(statsIntervalOption) : 1000;
+  std::optional<StatsWriter> statsWriter;
+  if (statsIntervalMillis > 0) {
+    statsWriter.emplace("output/stats.txt", std::chrono::milliseconds(statsIntervalMillis));
+  } else {
+    ServiceStats::SetEnabled(false);
+  }
+  // "--trace N" follows every market data line to risk, keeping the last N hop stamps per thread.
+  const char *traceOption = findOption(argc, argv, "--trace");
+  if (traceOption) {
+    Tracer::Instance().Enable(parseLong(traceOption));
+  }
 
   Bond T2("91282CME8", CUSIP, "T", 4., date(2026, Nov, 30), 0.019063);
   Bond T3("91282CMB4", CUSIP, "T", 4., date(2027, Dec, 15), 0.028002);
@@ -30,82 +114,50 @@ int main()
   productService->Add(T20);
   productService->Add(T30);
 
-// ------------- Inquiry -------------
-
-  BondInquiryService inquiryService;
-  BondInquiryServiceListener inquiryServiceListener(&inquiryService);
-  inquiryService.AddListener(&inquiryServiceListener);
-
-  std::cout << "Processing inquiries.txt" << std::endl;
-  BondInquirySubscriber inquirySubscriber("input/inquiries.txt", &inquiryService);
-  inquiryService.Subscribe(&inquirySubscriber);
-  std::cout << "Processing inquiries.txt done\n" << std::endl;
-
-// ------------- Price -------------
-
-  BondPricingService pricingService;
-  GUIService guiService(300);
-  BondAlgoStreamingService algoStreamingService;
-  BondStreamingService streamingService;
-  BondPriceStreamsHistoricalDataService historicalDataService;
-
-  BondPriceServiceListener guiServiceListener(&guiService);
-  BondPricesServiceListener algoStreamingServiceListener(&algoStreamingService);
-  BondAlgoStreamServiceListener streamingServiceListener(&streamingService);
-  BondPriceStreamsServiceListener historicalDataServiceListener(&historicalDataService);
-
-  pricingService.AddListener(&guiServiceListener);
-  pricingService.AddListener(&algoStreamingServiceListener);
-  algoStreamingService.AddListener(&streamingServiceListener);
-  streamingService.AddListener(&historicalDataServiceListener);
-
-  std::cout << "Processing prices.txt" << std::endl;
-  BondPricesConnector pricesConnector("input/prices.txt", &pricingService);
-  pricingService.Subscribe(&pricesConnector);
-  std::cout << "Processing prices.txt done\n" << std::endl;
-
-// -------------- Trade -------------
-
-  BondTradeBookingService tradeBookingService;
-  BondPositionService positionService;
-  BondRiskService riskService;
-  BondPositionHistoricalDataService positionHistoricalDataService;
-  BondRiskHistoricalDataService riskHistoricalDataService;
-
-  BondTradesServiceListener tradeListener(&positionService);
-  BondPositionServiceListener positionListener(&positionHistoricalDataService);
-  BondPositionRiskServiceListener positionListenerFromRisk(&riskService);
-  BondRiskServiceListener riskListener(&riskHistoricalDataService);
-
-  tradeBookingService.AddListener(&tradeListener);
-  positionService.AddListener(&positionListener);
-  positionService.AddListener(&positionListenerFromRisk);
-  riskService.AddListener(&riskListener);
-
-  std::cout << "Processing trades.txt" << std::endl;
-  BondTradesConnector tradesSubscriber("input/trades.txt", &tradeBookingService);
-  tradeBookingService.Subscribe(&tradesSubscriber);
-  std::cout << "Processing trades.txt done\n" << std::endl;
-
-// -------------- MarketData -------------
-
-  BondMarketDataService marketDataService;
-  BondAlgoExecutionService algoExecutionService;
-  BondExecutionService executionService;
-  BondExecutionHistoricalDataService executionHistoricalDataService;
-
-  BondMarketDataServiceListener marketDataListener(&algoExecutionService);
-  BondAlgoExecutionServiceListener algoExecutionListener(&executionService);
-  BondExecutionOrderServiceListener executionListener(&executionHistoricalDataService);
-  BondExecutionServiceListener executionListenerFromTrade(&tradeBookingService); // Assuming tradeBookingService exists
-
-  marketDataService.AddListener(&marketDataListener);
-  algoExecutionService.AddListener(&algoExecutionListener);
-  executionService.AddListener(&executionListener);
-  executionService.AddListener(&executionListenerFromTrade);
-
-  std::cout << "Processing marketdata.txt" << std::endl;
-  BondMarketDataConnector marketdataSubscriber("input/marketdata.txt", &marketDataService);
-  marketDataService.Subscribe(&marketdataSubscriber);
-  std::cout << "Processing marketdata.txt done\n" << std::endl;
+  ServiceGraphOptions options;
+  options.persistenceMode = persistenceMode;
+  options.conflationPolicy = conflationPolicy;
+  options.tradesPerSnapshot = tradesPerSnapshot;
+  options.asyncTail = asyncTail;
+  options.priceRingSlots = priceRingOption ? parseLong(priceRingOption) : 0;
+
+  withServiceGraph(options, [&](const ServiceGraph &graph) {
+    if (warmStart) {
+      // Executions book trades too, so market data resumes where the snapshot left it as well.
+      graph.trades->SetStartOffset(graph.snapshotter->Restore());
+      graph.marketData->SetStartOffset(graph.snapshotter->RestoreMarketData());
+    }
+
+    LOG_INFO("Processing inquiries.txt");
+    graph.inquiryService->Subscribe(graph.inquiries);
+    LOG_INFO("Processing inquiries.txt done\n");
+
+    LOG_INFO("Processing prices.txt");
+    graph.pricingService->Subscribe(graph.prices, ingestionThreads);
+    LOG_INFO("Processing prices.txt done\n");
+
+    LOG_INFO("Processing trades.txt");
+    graph.tradeBookingService->Subscribe(graph.trades);
+    LOG_INFO("Processing trades.txt done\n");
+
+    LOG_INFO("Processing marketdata.txt");
+    graph.marketDataService->Subscribe(graph.marketData, ingestionThreads);
+    LOG_INFO("Processing marketdata.txt done\n");
+
+    graph.snapshotter->Save();
+    graph.Drain();
+
+    if (Tracer::Instance().Enabled()) {
+      TraceExporter("output/trace.txt").Write();
+    }
+
+    if (conflationPolicy.Enabled()) {
+      graph.streamingHistory->Flush();
+      graph.positionHistory->Flush();
+      graph.riskHistory->Flush();
+      printConflationStats("Streaming", graph.streamingHistory->GetConflationStats());
+      printConflationStats("Position", graph.positionHistory->GetConflationStats());
+      printConflationStats("Risk", graph.riskHistory->GetConflationStats());
+    }
+  });
 }
@@ -0,0 +1,85 @@
+#include "../base/ticks.hpp"
+#include "../bond/BinaryInputFormat.hpp"
+#include "../bond/IOFileConnector.hpp"
+
+#include <iostream>
+#include <string>
+
+// Converts the CSV order book and price inputs into the pre-parsed binary format
+// that InputFileConnector detects from the file header.
+//
+//   bond_input_converter marketdata input/marketdata.txt input/marketdata.bin
+//   bond_input_converter prices input/prices.txt input/prices.bin
+
+template <typename F>
+void forEachLine(const std::string &filePath, F &&handle) {
+  MappedFile file(filePath);
+  FieldSpans fields;
+  std::string_view remaining(file.data(), file.size());
+  while (!remaining.empty()) {
+    std::size_t end = remaining.find('\n');
+    end = end == std::string_view::npos ? remaining.size() : end;
+    std::string_view line = remaining.substr(0, end);
+    if (!line.empty()) {
+      fields.split(line, ',');
+      handle(fields);
+    }
+    remaining.remove_prefix(std::min(end + 1, remaining.size()));
+  }
+}
+
+void convertMarketData(const std::string &input, const std::string &output) {
+  BinaryInputWriter writer(output, BinaryRecordType::ORDER_BOOK, sizeof(BinaryOrderBookRecord));
+  forEachLine(input, [&writer](const FieldSpans &fields) {
+    if (fields.size() < 1 + 4 * BINARY_BOOK_DEPTH) {
+      throw std::runtime_error("Order book line has too few fields: " + std::string(fields[0]));
+    }
+    BinaryOrderBookRecord record{};
+    record.productIndex = writer.Intern(fields[0]);
+    for (std::size_t i = 0; i < BINARY_BOOK_DEPTH; ++i) {
+      record.bidPrices[i] = Ticks::FromFractional(fields[1 + 2 * i]).Count();
+      record.bidQuantities[i] = parseLong(fields[2 + 2 * i]);
+      record.offerPrices[i] = Ticks::FromFractional(fields[11 + 2 * i]).Count();
+      record.offerQuantities[i] = parseLong(fields[12 + 2 * i]);
+    }
+    writer.Append(&record);
+  });
+  writer.Close();
+}
+
+void convertPrices(const std::string &input, const std::string &output) {
+  BinaryInputWriter writer(output, BinaryRecordType::PRICE, sizeof(BinaryPriceRecord));
+  forEachLine(input, [&writer](const FieldSpans &fields) {
+    if (fields.size() < 3) {
+      throw std::runtime_error("Price line has too few fields: " + std::string(fields[0]));
+    }
+    BinaryPriceRecord record{};
+    record.productIndex = writer.Intern(fields[0]);
+    record.mid = Ticks::FromFractional(fields[1]).Count();
+    record.bidOfferSpread = Ticks::FromFractional(fields[2]).Count();
+    writer.Append(&record);
+  });
+  writer.Close();
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 4) {
+    std::cerr << "usage: " << argv[0] << " <marketdata|prices> <input.txt> <output.bin>" << std::endl;
+    return 2;
+  }
+  std::string kind = argv[1];
+  try {
+    if (kind == "marketdata") {
+      convertMarketData(argv[2], argv[3]);
+    } else if (kind == "prices") {
+      convertPrices(argv[2], argv[3]);
+    } else {
+      std::cerr << "unknown input kind: " << kind << std::endl;
+      return 2;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
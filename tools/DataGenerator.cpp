@@ -0,0 +1,81 @@
+#include "../bond/InputGenerator.hpp"
+#include "../bond/IOFileConnector.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// Writes prices.txt, marketdata.txt, trades.txt and inquiries.txt in the formats of
+// data_generator.py, generating each file on every core.
+//
+//   bond_data_generator [--products 7] [--rows 1000] [--trades 10] [--inquiries 10]
+//                       [--order product|round-robin] [--seed 1] [--threads N] [--dir input]
+//                       [--book snapshot|delta]
+//
+// --rows, --trades and --inquiries count lines per product. Only the first seven
+// products are registered by bond_trading_system; larger universes are for bond_end_to_end.
+// "--book delta" writes marketdata.txt as one snapshot per product followed by level deltas.
+
+int main(int argc, char *argv[]) {
+  std::size_t products = 7, rows = 1000, trades = 10, inquiries = 10;
+  std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+  std::uint64_t seed = 1;
+  InputOrder order = InputOrder::BY_PRODUCT;
+  InputKind books = InputKind::MARKET_DATA;
+  std::string directory = "input";
+  try {
+    for (int i = 1; i < argc; i += 2) {
+      if (i + 1 >= argc) {
+        throw std::runtime_error(std::string("Missing value for ") + argv[i]);
+      }
+      std::string option = argv[i], value = argv[i + 1];
+      if (option == "--products") {
+        products = parseLong(value);
+      } else if (option == "--rows") {
+        rows = parseLong(value);
+      } else if (option == "--trades") {
+        trades = parseLong(value);
+      } else if (option == "--inquiries") {
+        inquiries = parseLong(value);
+      } else if (option == "--order" && (value == "product" || value == "round-robin")) {
+        order = value == "product" ? InputOrder::BY_PRODUCT : InputOrder::ROUND_ROBIN;
+      } else if (option == "--seed") {
+        seed = parseLong(value);
+      } else if (option == "--threads") {
+        threads = parseLong(value);
+      } else if (option == "--book" && (value == "snapshot" || value == "delta")) {
+        books = value == "snapshot" ? InputKind::MARKET_DATA : InputKind::MARKET_DATA_DELTAS;
+      } else if (option == "--dir") {
+        directory = value;
+      } else {
+        std::cerr << "Unknown option: " << option << " " << value << std::endl;
+        return 2;
+      }
+    }
+
+    InputGenerator generator(products, seed);
+    std::filesystem::create_directories(directory);
+    const std::pair<InputKind, std::size_t> files[] = {
+        {InputKind::PRICES, rows}, {books, rows},
+        {InputKind::TRADES, trades}, {InputKind::INQUIRIES, inquiries}};
+    for (const auto &[kind, rowsPerProduct] : files) {
+      auto start = std::chrono::steady_clock::now();
+      std::string text = generator.Generate(kind, rowsPerProduct, order, threads);
+      std::string path = (std::filesystem::path(directory) / inputFileName(kind)).string();
+      std::ofstream output(path, std::ios::binary | std::ios::trunc);
+      if (!output.write(text.data(), static_cast<std::streamsize>(text.size()))) {
+        throw std::runtime_error("Unable to write " + path);
+      }
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      std::cout << path << ": " << products * rowsPerProduct << " lines in " << elapsed.count() << " s" << std::endl;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
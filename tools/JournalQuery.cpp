@@ -0,0 +1,99 @@
+#include "../bond/BondPricingService.hpp"
+#include "../bond/BondStreamingService.hpp"
+#include "../bond/BondPositionService.hpp"
+#include "../bond/BondRiskService.hpp"
+#include "../bond/BondAlgoExecutionService.hpp"
+#include "../bond/HistoricalJournal.hpp"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <iostream>
+#include <string>
+
+// Answers queries against the journals written with "--persistence journal|both".
+//
+//   bond_journal_query risk output/risk.journal latest
+//   bond_journal_query risk output/risk.journal range 91282CME8 "2024-12-22 16:00:00" "2024-12-22 17:00:00"
+//   bond_journal_query positions output/positions.journal range "2024-12-22 16:00:00" "2024-12-22 17:00:00"
+
+std::int64_t parseTime(const std::string &text) {
+  boost::posix_time::ptime epoch(boost::gregorian::date(1970, 1, 1));
+  return (boost::posix_time::time_from_string(text) - epoch).total_microseconds();
+}
+
+void print(const PositionJournalRecord &record) {
+  std::cout << record.aggregatePosition;
+}
+
+void print(const RiskJournalRecord &record) {
+  std::cout << record.quantity << ',' << record.pv01;
+}
+
+void print(const PriceStreamJournalRecord &record) {
+  std::cout << Ticks(record.bidPrice) << ',' << record.bidVisibleQuantity << ',' << record.bidHiddenQuantity << ','
+            << Ticks(record.offerPrice) << ',' << record.offerVisibleQuantity << ',' << record.offerHiddenQuantity;
+}
+
+void print(const ExecutionJournalRecord &record) {
+  std::cout << record.side << ',' << record.orderId << ',' << record.orderType << ',' << record.price << ','
+            << record.visibleQuantity << ',' << record.hiddenQuantity << ',' << record.parentOrderId << ','
+            << record.isChildOrder;
+}
+
+template <typename R>
+void printFrame(const HistoricalJournalReader<R> &reader, const JournalFrame<R> &frame) {
+  static TimestampFormatter formatter;
+  char timestamp[TimestampFormatter::MAX_LENGTH];
+  std::cout << std::string_view(timestamp, formatter.Format(frame.timestamp, timestamp)) << ','
+            << reader.GetKey(frame) << ',';
+  print(frame.payload);
+  std::cout << '\n';
+}
+
+template <typename R>
+int query(const std::string &filePath, int argc, char *argv[]) {
+  HistoricalJournalReader<R> reader(filePath);
+  std::string command = argv[0];
+  if (command == "latest" && argc == 1) {
+    for (const auto &key : reader.GetKeys()) {
+      printFrame(reader, *reader.Latest(key));
+    }
+  } else if (command == "range" && argc == 4) {
+    for (const auto *frame : reader.Range(argv[1], parseTime(argv[2]), parseTime(argv[3]))) {
+      printFrame(reader, *frame);
+    }
+  } else if (command == "range" && argc == 3) {
+    for (const auto *frame : reader.Range(parseTime(argv[1]), parseTime(argv[2]))) {
+      printFrame(reader, *frame);
+    }
+  } else {
+    std::cerr << "unknown query: " << command << std::endl;
+    return 2;
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 4) {
+    std::cerr << "usage: " << argv[0] << " <positions|risk|streaming|execution> <journal> "
+              << "<latest | range [key] <from> <to>>" << std::endl;
+    return 2;
+  }
+  std::string kind = argv[1];
+  std::string filePath = argv[2];
+  try {
+    if (kind == "positions") {
+      return query<PositionJournalRecord>(filePath, argc - 3, argv + 3);
+    } else if (kind == "risk") {
+      return query<RiskJournalRecord>(filePath, argc - 3, argv + 3);
+    } else if (kind == "streaming") {
+      return query<PriceStreamJournalRecord>(filePath, argc - 3, argv + 3);
+    } else if (kind == "execution") {
+      return query<ExecutionJournalRecord>(filePath, argc - 3, argv + 3);
+    }
+    std::cerr << "unknown journal kind: " << kind << std::endl;
+    return 2;
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}